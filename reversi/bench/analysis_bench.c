@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/tt.h"
+#include "../include/suite.h"
+#include "../include/util.h"
+
+#define SUITE "../suites/midgame.txt"
+#define DEPTH 8
+
+/*
+ * Scores every move of the suite positions three ways, each from an empty
+ * transposition table: one search of the child per move, the analysis of
+ * all moves, and the analysis with an exact score for the best move only.
+ * The analysis must give the same scores as the separate searches.
+ */
+
+static int separate(state_t state, int depth, move_t *moves, int *scores, size_t *nodes) {
+	state_t child;
+	bitboard_t b = state.board;
+	uint64_t bits = (state.player == BLACK_STONE) ? bb_mobility(b.black, b.white, b.size)
+		: bb_mobility(b.white, b.black, b.size);
+	int n = 0, square;
+
+	for (; bits; bits &= bits - 1) {
+		square = __builtin_ctzll(bits);
+		moves[n].row = square % state.board.size;
+		moves[n].column = square / state.board.size;
+		child.board = bb_move(moves[n], state);
+		child.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		tt_clear();
+		scores[n++] = -negamax_alphabeta_value(child, depth - 1, stability_heuristic);
+		*nodes += bb_search_nodes();
+	}
+	return n;
+}
+
+static void analyze(state_t state, int depth, int lines, analysis_t *a, size_t *nodes) {
+	tt_clear();
+	bb_analyze(state, depth, lines, 0, stability_heuristic, NULL, NULL, a);
+	*nodes += a->nodes;
+}
+
+int main(int argc, char *argv[]) {
+	static analysis_t all, best;
+	const char *filename = argc > 1 ? argv[1] : SUITE;
+	int depth = argc > 2 ? atoi(argv[2]) : DEPTH;
+	int scores[MAX_BOARD_SIZE * MAX_BOARD_SIZE], i, j, k, n, mismatches = 0, lines = 0;
+	move_t moves[MAX_BOARD_SIZE * MAX_BOARD_SIZE];
+	size_t nodes[3] = { 0 };
+	double elapsed[3] = { 0 }, start;
+	suite_t suite;
+
+	if (depth < 1 || suite_load(filename, &suite) != 0) {
+		fprintf(stderr, "analysis_bench: error: cannot load suite '%s'\n", filename);
+		return EXIT_FAILURE;
+	}
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < suite.count; i++) {
+		start = util_now();
+		n = separate(suite.positions[i].state, depth, moves, scores, &nodes[0]);
+		elapsed[0] += util_now() - start;
+		start = util_now();
+		analyze(suite.positions[i].state, depth, 0, &all, &nodes[1]);
+		elapsed[1] += util_now() - start;
+		start = util_now();
+		analyze(suite.positions[i].state, depth, 1, &best, &nodes[2]);
+		elapsed[2] += util_now() - start;
+		lines += n;
+		for (j = 0; j < n; j++) {
+			for (k = 0; k < all.num_lines; k++) {
+				if (all.lines[k].move.row == moves[j].row && all.lines[k].move.column == moves[j].column) {
+					mismatches += all.lines[k].score != scores[j];
+				}
+			}
+		}
+		mismatches += best.lines[0].score != all.lines[0].score;
+	}
+	printf("%d positions, %d moves, depth %d\n", suite.count, lines, depth);
+	printf("%-22s %10s %14s %10s\n", "", "time (s)", "nodes", "speedup");
+	printf("%-22s %10.3f %14zu %9.2fx\n", "separate searches", elapsed[0], nodes[0], 1.0);
+	printf("%-22s %10.3f %14zu %9.2fx\n", "analysis, all exact", elapsed[1], nodes[1], elapsed[0] / elapsed[1]);
+	printf("%-22s %10.3f %14zu %9.2fx\n", "analysis, best exact", elapsed[2], nodes[2], elapsed[0] / elapsed[2]);
+	printf("%d score mismatches\n", mismatches);
+	suite_free(&suite);
+	tt_free();
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/batch.h"
+#include "../include/util.h"
+
+#define POSITIONS 4096
+#define REPETITIONS 2000
+
+static const char *names[] = { "scalar", "avx2", "avx512" };
+
+/* positions from random games, with one legal move each for the flips */
+static void make_positions(batch_t *batch, uint8_t *squares) {
+	uint64_t own, opp, moves, tmp;
+	size_t i;
+	int ply, n;
+
+	srand(42);
+	while (batch->count < batch->capacity) {
+		state_t state;
+		state.board = bb_init(8);
+		state.player = BLACK_STONE;
+		own = state.board.black;
+		opp = state.board.white;
+		for (ply = 0; ply < 60 && batch->count < batch->capacity; ply++) {
+			moves = bb_mobility(own, opp, 8);
+			if (moves == 0) {
+				break;
+			}
+			for (n = rand() % __builtin_popcountll(moves); n > 0; n--) {
+				moves &= moves - 1;
+			}
+			i = batch->count++;
+			batch->own[i] = own;
+			batch->opp[i] = opp;
+			squares[i] = __builtin_ctzll(moves);
+			tmp = bb_flips(own, opp, squares[i], 8);
+			own |= tmp | (uint64_t) 1 << squares[i];
+			opp &= ~tmp;
+			tmp = own;
+			own = opp;
+			opp = tmp;
+		}
+	}
+}
+
+int main(void) {
+	batch_t batch;
+	uint8_t squares[POSITIONS];
+	uint64_t moves[POSITIONS], flips[POSITIONS], ref_moves[POSITIONS], ref_flips[POSITIONS];
+	int own[POSITIONS], opp[POSITIONS], values[POSITIONS], ref_values[POSITIONS];
+	double start, t[4], base[4];
+	int isa, best, r, k, ok;
+
+	if (batch_init(&batch, 8, POSITIONS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	make_positions(&batch, squares);
+	best = batch_isa();
+
+	printf("isa       mobility      flips      count       eval  (ns/board)\n");
+	for (isa = BATCH_SCALAR; isa <= best; isa++) {
+		batch_set_isa(isa);
+		start = util_now();
+		for (r = 0; r < REPETITIONS; r++)
+			batch_mobility(&batch, moves);
+		t[0] = util_now() - start;
+		start = util_now();
+		for (r = 0; r < REPETITIONS; r++)
+			batch_flips(&batch, squares, flips);
+		t[1] = util_now() - start;
+		start = util_now();
+		for (r = 0; r < REPETITIONS; r++)
+			batch_count(&batch, own, opp);
+		t[2] = util_now() - start;
+		start = util_now();
+		for (r = 0; r < REPETITIONS; r++)
+			batch_eval(&batch, values);
+		t[3] = util_now() - start;
+
+		if (isa == BATCH_SCALAR) {
+			memcpy(ref_moves, moves, sizeof(moves));
+			memcpy(ref_flips, flips, sizeof(flips));
+			memcpy(ref_values, values, sizeof(values));
+			memcpy(base, t, sizeof(t));
+		}
+		ok = memcmp(ref_moves, moves, sizeof(moves)) == 0 && memcmp(ref_flips, flips, sizeof(flips)) == 0
+			&& memcmp(ref_values, values, sizeof(values)) == 0;
+		printf("%-8s", names[isa]);
+		for (k = 0; k < 4; k++) {
+			printf("  %6.2f x%-4.1f", t[k] * 1e9 / REPETITIONS / POSITIONS, base[k] / t[k]);
+		}
+		printf("  %s\n", ok ? "" : "MISMATCH");
+	}
+	batch_free(&batch);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/tt.h"
+#include "../include/dfpn.h"
+#include "../include/util.h"
+
+#define POSITIONS 10
+
+static const int empties[] = { 10, 12, 14 };
+
+/* a random game stopped with the given number of empties, or fewer if it ended */
+static state_t make_position(int left) {
+	uint64_t own, opp, moves, flips, tmp;
+	char player = BLACK_STONE;
+	state_t state;
+	int n;
+
+	state.board = bb_init(8);
+	own = state.board.black;
+	opp = state.board.white;
+	while (64 - __builtin_popcountll(own | opp) > left) {
+		moves = bb_mobility(own, opp, 8);
+		if (moves == 0 && bb_mobility(opp, own, 8) == 0) {
+			break;
+		}
+		if (moves) {
+			for (n = rand() % __builtin_popcountll(moves); n > 0; n--) {
+				moves &= moves - 1;
+			}
+			flips = bb_flips(own, opp, __builtin_ctzll(moves), 8);
+			own |= flips | (moves & -moves);
+			opp &= ~flips;
+		}
+		tmp = own;
+		own = opp;
+		opp = tmp;
+		player = (player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	}
+	state.player = player;
+	state.board.black = (player == BLACK_STONE) ? own : opp;
+	state.board.white = (player == BLACK_STONE) ? opp : own;
+	return state;
+}
+
+int main(void) {
+	dfpn_t dfpn;
+	dfpn_result_t result;
+	state_t state;
+	size_t nodes, tree;
+	double start, solve, proof;
+	int i, k, score, expected, agree, counts[3];
+
+	if (tt_init(TT_DEFAULT_BITS) != 0 || dfpn_init(&dfpn, DFPN_MEMORY) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	srand(42);
+	printf("empties  alpha-beta (ms)  df-pn (ms)  nodes/pos  tree/pos   win draw loss  agree\n");
+	for (k = 0; k < (int) (sizeof(empties) / sizeof(empties[0])); k++) {
+		solve = proof = 0;
+		nodes = tree = 0;
+		agree = 0;
+		memset(counts, 0, sizeof(counts));
+		for (i = 0; i < POSITIONS; i++) {
+			state = make_position(empties[k]);
+			start = util_now();
+			ai_solve(state, &score);
+			solve += util_now() - start;
+			expected = (score > 0) - (score < 0);
+
+			dfpn_clear(&dfpn);
+			dfpn_solve(&dfpn, state, &result);
+			proof += result.elapsed;
+			nodes += result.nodes;
+			tree += result.tree;
+			agree += result.outcome == expected;
+			counts[expected + 1]++;
+		}
+		printf("%7d  %15.2f  %10.2f  %9zu  %8zu  %4d %4d %4d  %3d/%d%s\n", empties[k],
+			solve * 1e3 / POSITIONS, proof * 1e3 / POSITIONS, nodes / POSITIONS, tree / POSITIONS,
+			counts[2], counts[1], counts[0], agree, POSITIONS, agree == POSITIONS ? "" : "  MISMATCH");
+	}
+	dfpn_free(&dfpn);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/tt.h"
+#include "../include/ecache.h"
+#include "../include/util.h"
+
+#define POSITIONS 50
+#define DEPTH 6
+#define REPEAT 3
+
+typedef struct {
+	const char *name;
+	int (*heuristic) (state_t state);
+} evaluator_t;
+
+static const evaluator_t evaluators[] = {
+	{ "stability", stability_heuristic },
+	{ "coin parity", coin_parity_heuristic }
+};
+
+/* discs on the board for positions of each phase */
+static const int phase_discs[ECACHE_PHASES] = { 12, 26, 40, 52 };
+
+/* random games stopped at a number of discs, or earlier when they end */
+static void make_positions(state_t *states, int discs) {
+	uint64_t own, opp, moves, flips, tmp;
+	char player;
+	int i, n;
+
+	for (i = 0; i < POSITIONS; i++) {
+		do {
+			own = bb_init(8).black;
+			opp = bb_init(8).white;
+			player = BLACK_STONE;
+			while (__builtin_popcountll(own | opp) < discs) {
+				moves = bb_mobility(own, opp, 8);
+				if (moves == 0 && bb_mobility(opp, own, 8) == 0) {
+					break;
+				}
+				if (moves) {
+					for (n = rand() % __builtin_popcountll(moves); n > 0; n--) {
+						moves &= moves - 1;
+					}
+					flips = bb_flips(own, opp, __builtin_ctzll(moves), 8);
+					own |= flips | (moves & -moves);
+					opp &= ~flips;
+				}
+				tmp = own;
+				own = opp;
+				opp = tmp;
+				player = (player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+			}
+		} while (bb_mobility(own, opp, 8) == 0);
+		states[i].player = player;
+		states[i].board.size = 8;
+		states[i].board.black = (player == BLACK_STONE) ? own : opp;
+		states[i].board.white = (player == BLACK_STONE) ? opp : own;
+	}
+}
+
+/* best of REPEAT searches from an empty table and cache, with the cache on the given phases */
+static double run(state_t state, int (*heuristic) (state_t state), int phases, int *value) {
+	double start, elapsed, best = 0;
+	int r;
+
+	ecache_enable(phases);
+	for (r = 0; r < REPEAT; r++) {
+		tt_clear();
+		ecache_clear();
+		start = util_now();
+		*value = negamax_alphabeta_value(state, DEPTH, heuristic);
+		elapsed = util_now() - start;
+		best = (r == 0 || elapsed < best) ? elapsed : best;
+	}
+	return best;
+}
+
+static double rate(size_t hits, size_t probes) {
+	return probes ? 100.0 * hits / probes : 0;
+}
+
+int main(void) {
+	state_t states[POSITIONS];
+	ecache_stats_t stats;
+	int off, on, phase, e, i, same;
+	double t_off, t_on;
+
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	srand(42);
+	printf("negamax_alphabeta depth %d, %d positions per phase, best of %d, %d entries per thread\n",
+		DEPTH, POSITIONS, REPEAT, 1 << ECACHE_BITS);
+	printf("%-12s %5s %10s %10s %10s %10s %8s\n", "evaluator", "phase", "moves hit", "value hit",
+		"off (ms)", "on (ms)", "change");
+	for (phase = 0; phase < ECACHE_PHASES; phase++) {
+		make_positions(states, phase_discs[phase]);
+		for (e = 0; e < (int) (sizeof(evaluators) / sizeof(evaluators[0])); e++) {
+			t_off = t_on = 0;
+			ecache_reset_stats();
+			for (i = 0, same = 1; i < POSITIONS; i++) {
+				t_off += run(states[i], evaluators[e].heuristic, 0, &off);
+				t_on += run(states[i], evaluators[e].heuristic, ECACHE_ALL, &on);
+				same &= off == on;
+			}
+			ecache_stats(&stats);
+			printf("%-12s %5d %9.1f%% %9.1f%% %10.2f %10.2f %+7.1f%%%s\n", evaluators[e].name, phase,
+				rate(stats.hits[phase][0], stats.probes[phase][0]),
+				rate(stats.hits[phase][1], stats.probes[phase][1]),
+				t_off * 1e3 / POSITIONS, t_on * 1e3 / POSITIONS, 100 * (t_on - t_off) / t_off,
+				same ? "" : "  MISMATCH");
+		}
+	}
+	ecache_enable(ECACHE_DEFAULT);
+	return EXIT_SUCCESS;
+}
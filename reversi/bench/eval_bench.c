@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/tt.h"
+#include "../include/util.h"
+
+#define POSITIONS 200
+#define DEPTH 4
+
+static size_t leaves = 0;
+
+/* same evaluation, but not known to the search, so it goes through the pointer */
+static int coin_parity_plugin(state_t state) {
+	leaves++;
+	return coin_parity_heuristic(state);
+}
+
+/* midgame positions from random games */
+static void make_positions(state_t *states) {
+	uint64_t own, opp, moves, flips, tmp;
+	char player;
+	int i, ply, n;
+
+	srand(42);
+	for (i = 0; i < POSITIONS; i++) {
+		states[i].board = bb_init(8);
+		own = states[i].board.black;
+		opp = states[i].board.white;
+		player = BLACK_STONE;
+		for (ply = 0; ply < 16 + rand() % 20; ply++) {
+			moves = bb_mobility(own, opp, 8);
+			if (moves == 0) {
+				break;
+			}
+			for (n = rand() % __builtin_popcountll(moves); n > 0; n--) {
+				moves &= moves - 1;
+			}
+			flips = bb_flips(own, opp, __builtin_ctzll(moves), 8);
+			own |= flips | (moves & -moves);
+			opp &= ~flips;
+			tmp = own;
+			own = opp;
+			opp = tmp;
+			player = (player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		}
+		states[i].player = player;
+		states[i].board.black = (player == BLACK_STONE) ? own : opp;
+		states[i].board.white = (player == BLACK_STONE) ? opp : own;
+	}
+}
+
+static double run(const state_t *states, int (*heuristic) (state_t state), move_t *moves) {
+	double start, elapsed = 0;
+	int i;
+
+	for (i = 0; i < POSITIONS; i++) {
+		tt_clear();
+		start = util_now();
+		moves[i] = negamax_alphabeta(states[i], DEPTH, heuristic);
+		elapsed += util_now() - start;
+	}
+	return elapsed;
+}
+
+int main(void) {
+	state_t states[POSITIONS];
+	move_t fast[POSITIONS], slow[POSITIONS];
+	double inlined, plugin;
+	int i, same = 1;
+
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	make_positions(states);
+	plugin = run(states, coin_parity_plugin, slow);
+	inlined = run(states, coin_parity_heuristic, fast);
+	for (i = 0; i < POSITIONS; i++) {
+		same &= fast[i].row == slow[i].row && fast[i].column == slow[i].column;
+	}
+
+	printf("negamax_alphabeta depth %d, %d positions, %zu leaves\n", DEPTH, POSITIONS, leaves);
+	printf("function pointer  %8.1f ns/leaf\n", plugin * 1e9 / leaves);
+	printf("specialized       %8.1f ns/leaf  x%.2f  %s\n", inlined * 1e9 / leaves, plugin / inlined,
+		same ? "" : "MISMATCH");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,239 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../src/reversi.h"
+#include "../include/util.h"
+
+#define CONNECTIONS 16
+#define REQUESTS 4000
+#define RANDOM_PLIES 6
+#define MAX_MOVES 64
+
+/*
+ * Load generator for rvserve: every connection plays whole games, a few
+ * random moves and then the engine's own moves for both sides, and times
+ * each "go" from the request to the reply. A refused search ("error busy")
+ * is retried after a millisecond. A search stopped at its deadline still
+ * answers its best move so far, and counts as a timeout.
+ */
+
+typedef struct {
+	int id;
+	double *latencies;
+	size_t count;
+	size_t busy;
+	size_t timeouts;
+	size_t games;
+	int failed;
+} client_t;
+
+static const char *path;
+static int requests = REQUESTS;
+static const char *deadline = "";
+static size_t issued = 0;
+
+static void usage(void) {
+	printf("Usage: load_bench [-c CONNECTIONS] [-n REQUESTS] [-T MS] SOCKET\n"
+	"Play games against rvserve on SOCKET and report throughput and latency percentiles\n"
+	"\n\t -c\t connections, each playing one game after the other (default %d)\n"
+	"\t -n\t searches requested in all (default %d)\n"
+	"\t -T\t deadline sent with every search, in ms (default: the server's)\n",
+	CONNECTIONS, REQUESTS);
+}
+
+static int connect_server(void) {
+	struct sockaddr_un addr;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+		return -1;
+	}
+	return fd;
+}
+
+/* sends a command and reads its one line reply */
+static int ask(FILE *f, char *line, size_t length, const char *format, ...) {
+	va_list ap;
+
+	va_start(ap, format);
+	vfprintf(f, format, ap);
+	va_end(ap);
+	fputc('\n', f);
+	fflush(f);
+	if (fgets(line, length, f) == NULL) {
+		return -1;
+	}
+	line[strcspn(line, "\n")] = 0;
+	return 0;
+}
+
+static int moves(FILE *f, char names[MAX_MOVES][8]) {
+	char line[512], *p;
+	int n = 0;
+
+	if (ask(f, line, sizeof(line), "moves") != 0) {
+		return -1;
+	}
+	for (p = strtok(line + 5, " "); p && n < MAX_MOVES; p = strtok(NULL, " ")) {
+		strncpy(names[n++], p, 7);
+	}
+	return n;
+}
+
+static void *client(void *arg) {
+	client_t *c = arg;
+	char line[512], names[MAX_MOVES][8];
+	unsigned int seed = c->id + 1;
+	double start;
+	int fd, n, ply = 0;
+	FILE *f;
+
+	if ((fd = connect_server()) < 0 || (f = fdopen(fd, "r+")) == NULL) {
+		c->failed = 1;
+		return NULL;
+	}
+	c->latencies = malloc(requests * sizeof(double));
+	if (c->latencies == NULL || ask(f, line, sizeof(line), "new") != 0) {
+		c->failed = 1;
+		return NULL;
+	}
+	while (1) {
+		if ((n = moves(f, names)) < 0) {
+			c->failed = 1;
+			break;
+		}
+		if (n == 0) {
+			if (ask(f, line, sizeof(line), "play pass") != 0) {
+				c->failed = 1;
+				break;
+			}
+			if (strcmp(line, "ok") != 0) {
+				c->games++;
+				ply = 0;
+				ask(f, line, sizeof(line), "new");
+			}
+			continue;
+		}
+		if (ply++ < RANDOM_PLIES) {
+			ask(f, line, sizeof(line), "play %s", names[rand_r(&seed) % n]);
+			continue;
+		}
+		if (__atomic_fetch_add(&issued, 1, __ATOMIC_RELAXED) >= (size_t) requests) {
+			break;
+		}
+		start = util_now();
+		while (1) {
+			if (ask(f, line, sizeof(line), "go %s", deadline) != 0) {
+				c->failed = 1;
+				break;
+			}
+			if (strcmp(line, "error busy") != 0) {
+				break;
+			}
+			c->busy++;
+			nanosleep(&(struct timespec) { 0, 1000000 }, NULL);
+		}
+		if (c->failed) {
+			break;
+		}
+		c->latencies[c->count++] = util_now() - start;
+		if (strncmp(line, "move ", 5) != 0) {
+			c->failed = 1;
+			break;
+		}
+		c->timeouts += strstr(line, " stopped") != NULL;
+		line[strcspn(line + 5, " ") + 5] = 0;
+		ask(f, line, sizeof(line), "play %s", line + 5);
+	}
+	fclose(f);
+	return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[]) {
+	client_t *clients;
+	pthread_t *threads;
+	double *all, start, elapsed;
+	size_t total = 0, busy = 0, timeouts = 0, games = 0;
+	char line[512];
+	int opt, connections = CONNECTIONS, i, failed = 0, fd;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "c:n:T:")) != -1) {
+		switch (opt) {
+			case 'c':
+				connections = atoi(optarg);
+				break;
+			case 'n':
+				requests = atoi(optarg);
+				break;
+			case 'T':
+				deadline = optarg;
+				break;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || connections < 1 || requests < 1) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	path = argv[optind];
+	clients = calloc(connections, sizeof(client_t));
+	threads = calloc(connections, sizeof(pthread_t));
+	all = malloc(requests * sizeof(double));
+	if (clients == NULL || threads == NULL || all == NULL) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+
+	start = util_now();
+	for (i = 0; i < connections; i++) {
+		clients[i].id = i;
+		pthread_create(&threads[i], NULL, client, &clients[i]);
+	}
+	for (i = 0; i < connections; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	elapsed = util_now() - start;
+
+	for (i = 0; i < connections; i++) {
+		memcpy(all + total, clients[i].latencies, clients[i].count * sizeof(double));
+		total += clients[i].count;
+		busy += clients[i].busy;
+		timeouts += clients[i].timeouts;
+		games += clients[i].games;
+		failed += clients[i].failed;
+		free(clients[i].latencies);
+	}
+	if (failed) {
+		fprintf(stderr, "load_bench: error: %d of %d connections to '%s' failed\n", failed, connections, path);
+	}
+	if (total == 0) {
+		return EXIT_FAILURE;
+	}
+	qsort(all, total, sizeof(double), compare_doubles);
+	printf("%d connections, %zu searches in %.3f s: %.1f searches/s, %zu games\n", connections, total,
+		elapsed, total / elapsed, games);
+	printf("latency (ms): p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n", all[total / 2] * 1e3,
+		all[total * 90 / 100] * 1e3, all[total * 99 / 100] * 1e3, all[total - 1] * 1e3);
+	printf("%zu retries after 'busy', %zu timeouts\n", busy, timeouts);
+	if ((fd = connect_server()) >= 0 && (f = fdopen(fd, "r+")) != NULL) {
+		if (ask(f, line, sizeof(line), "stats") == 0) {
+			printf("server: %s\n", line);
+		}
+		fclose(f);
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
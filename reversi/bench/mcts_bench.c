@@ -0,0 +1,78 @@
+#include "../include/mcts.h"
+
+#define PLAYOUTS 200000
+#define MEMORY 256
+#define MAX_THREADS 32
+#define SEED 42
+
+/* a few opening moves in, so the root has some choice */
+static state_t position(void) {
+	state_t state;
+	move_t move;
+	int i;
+
+	state.board = bb_init(8);
+	state.player = BLACK_STONE;
+	for (i = 0; i < 6; i++) {
+		move = ai_search(state, 1);
+		state.board = bb_move(move, state);
+		state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	}
+	return state;
+}
+
+/* fingerprint of the root's child statistics */
+static uint64_t root_hash(const mcts_t *tree) {
+	const mcts_node_t *nodes = tree->arena[tree->current];
+	uint64_t h = nodes[1].visits;
+	uint32_t i;
+	for (i = nodes[1].children; i < nodes[1].children + nodes[1].num_children; i++) {
+		h = h * 1000003 ^ ((uint64_t) nodes[i].visits << 32 | nodes[i].wins);
+	}
+	return h;
+}
+
+static int run(state_t state, int threads, int deterministic, double *rate, uint64_t *hash) {
+	mcts_t tree;
+
+	if (mcts_init(&tree, MEMORY, SEED) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return -1;
+	}
+	mcts_set_threads(&tree, threads);
+	if (deterministic) {
+		mcts_set_deterministic(&tree, SEED);
+	}
+	mcts_search(&tree, state, PLAYOUTS);
+	*rate = tree.playouts / tree.elapsed;
+	*hash = root_hash(&tree);
+	mcts_free(&tree);
+	return 0;
+}
+
+int main(int argc, char *argv[]) {
+	state_t state = position();
+	int threads, max_threads = MAX_THREADS;
+	double rate, base = 0;
+	uint64_t hash, hash2;
+
+	if (argc > 1) {
+		max_threads = atoi(argv[1]);
+	}
+	printf("threads  playouts/s  speedup\n");
+	for (threads = 1; threads <= max_threads; threads *= 2) {
+		if (run(state, threads, 0, &rate, &hash) != 0) {
+			return EXIT_FAILURE;
+		}
+		if (threads == 1) {
+			base = rate;
+		}
+		printf("%7d  %10.0f  %7.2f\n", threads, rate, rate / base);
+	}
+
+	if (run(state, 8, 1, &rate, &hash) != 0 || run(state, 8, 1, &rate, &hash2) != 0) {
+		return EXIT_FAILURE;
+	}
+	printf("deterministic: %s\n", hash == hash2 ? "ok" : "MISMATCH");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,440 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <math.h>
+#include <time.h>
+#include "../include/record.h"
+#include "../include/util.h"
+
+#define MAX_POSITIONS 65536
+#define WARMUP 3
+#define REPETITIONS 20
+#define SAMPLE_SECONDS 0.002
+#define MAX_PRIMITIVES 32
+
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE "unknown"
+#endif
+
+/*
+ * Games played by the engine: 6 random moves, then depth 5 alpha-beta
+ * with the stability heuristic. One square per move, column letter then
+ * row digit; passes are implied.
+ */
+static const char *games[] = {
+	"e6f4g3g4g5c6c4f3e3g2e2e1h1h5f2f5d1c1h3d3c2d2c3c5b3a4a2b2b6b4d6b5g6f1a5a6a1h4a3f6h6b1g1h2b7d7a7a8e8d8c8f7e7c7f8g8b8g7h8h7",
+	"f5f6f7g5c4c5h4f8b5c3c2a5c6d7b7b2e7f4g4c1a1f3e2h5g6d1e3a8e1f1h6a3d3b4b1b3a4g3a2b6g1d6a6g7h8h7a7h3h2e6d2g2g8h1c7e8d8b8c8f2",
+	"d3e3f4c3e2f2g2g1d2e1f1g4h1c5d1c2b6f3e6d6c1c4d7b5b1a7g3d8c6f5a6a5a4a3h4b3g5h5f6g6h6b2h7h2c8g7h3e7e8f8h8c7f7b8b4a2a1g8a8b7",
+	"c4e3f6c5f3c3b3a3e2e6b5e1d1c1b2g6g7d3h6a1a2h8b1g4f2f1g2a6b4f5c2c6d2g3c7c8b6h7d6h5d8e8f4h2h1g1h3d7e7f7a4b8g5h4f8g8b7a5a7a8",
+	"f5d6c3f4f6c4c5c6f3c2b7g4c1b4h3g5a4e3e7b3f2f1g2c7c8b6d3a8h6b8a2d8b5a3d7a1a6b2b1a7d2e2g6a5e6d1e1g3g1h1h2e8f7h4h5g8f8g7h8h7",
+	"f5f6e6f4g4d6c4b3b4h3a2a4b5c2b2a6h4b1d2f3e2d1d7h5g3c6f2f1e1c3g7d3e3g2c5a1a3b6c1a5h1e8e7c7g1f8d8g6c8b8b7h2h6g5f7h8h7g8a7a8",
+	"f5f6c4c3f7b4a4e3c2c6f2e2d3b3e1f3g4g3h4h3h2d1a3h5h6f1b1d2g5f4e6a5a6g7c5b2e7f8g6b5a1e8c1a2b6h7h8g8g2g1h1a7d7d8c8d6a8c7b7b8",
+	"f5f6c4e3f2b4d3e2a4g1c2c3e1c1g3a5a6f4b3b2d6d7a1h2b1d1a2a3d2f3f1c5h4h3h1a7b5c6b6c7c8b7e6e8a8b8d8e7g2g4f7g5f8g7h5g6h6h8g8",
+	"f5f6f7f4c3c6f3g2f2e2f1g4h3h1d1f8c5d2e1b5b6h5e6c2c1e7d7b7a4d6g7g6g5e8c7g3a8d8h6d3c4a5e3h8g8h7a7a6b4h4g1h2c8b1b2a2a1a3b3b8",
+	"c4c3c2d6c6b6e6f6g7d3a6h8d2c5f4d1e1b1e2f2e3b2c1f5a1c7b3f3g4g2c8b4a4f7h1h3h5g3g1b7a8a7h2f1h4b8g5a5b5g6d7d8h7h6e7a2a3e8f8g8",
+	"f5d6c7f4c3g6g3f3e3g2g4h3h1b8h4f2h2d3e1h5h6b2c4g5f6b3a1e6c5b4a2g7c2b1a3h7c1c6a4b5f7g1f1d7c8b6a8e7a5e8d2a6a7d1e2b7h8g8d8f8",
+	"e6d6c6f6f4g4c3b2e3b6a1c4c5c2h4f3a7g3c1b5g6b7a6c7f5d3h3f2f1g2e2b4a8d2h2d1e1d7b8h1c8h5a3g1b3h6a4a5g5d8e8e7f8f7g8g7h7h8b1a2",
+	"e6d6c5f4f3b4c4f2g2d3c6b5d2d7f1h1a4d1e2a3a2f5e8c8f7b6g4h4b3c3c2b2e3f6d8g3h3h2a1g6a5f8g5b1c1e1g1h5h7h6a6h8g8b7c7a7g7e7b8a8",
+	"e6f6c4e3f2d6e7c3c5b5b6c6b4a4a6f4g5g1b2h6h4f8e8g6g7c2d2c1a3a5e2e1g2h8b3d1d3c7f7d8c8a1b1a2f1a7h1g8g4b7d7b8a8h2h3f5f3h7h5g3",
+	"d3e3f5c5e2f4b5e1f1g1f3e6d6g4g6f6g3f2h4a5d1c1b4d2c3b2b3g2c4c2a1h6d7g5h3h5b1a2h1h2a4a3a6c7c6f7g7e7h7b7a8a7d8e8b8b6c8h8f8g8",
+	"f5f6e6f4g7f7f3f2g8f8e7h8f1c4b4c3c2e8d7g3h3d6g4d8c7a4d3c1b3d2c5a3d1h4h5c6b5c8a5a6b7g5b6a8b1e1e3e2b8a1h7g6h6a7a2g1b2g2h1h2",
+	"c4c5f6e3e6b4a4c3e2g7b6e1h8a7d6a5f2g1f3g3g2d7d2h1f4d3d8f1b5d1c2c1h3f5a6a3h2g4c6b2a2a1g6c8f7h4b8b1e8e7b3c7h5g5f8h6b7a8h7g8",
+	"c4c5d6c3e6e7e8f6g5g6b4c6b7b6a7a6b5a5h6a8b3a4d3f8g8e2d7a3b2a1d8f7f5h5f4c7c8h7g7a2d2e1f1g1d1c1c2h8e3b1f3b8g4h3h4f2g2h1h2g3",
+	"d3c3f5e3e2f3b2d1g3e6f6c4d7a1b3b4c5f7a3a2d6a4e1f1f8c2f4h3f2g4d2d8c6g1h5g5h4h6c8b8b5a5g6g7g2h1h2g8a6c7e7e8c1b1h8h7a8a7b7b6",
+	"c4c5f6d3e2g7d6e3e6e7h8e1f1g1e8f2g2g3h2f4c3f3g4f5b4h1c6h3g5d1d2a4a3c1a5c2b2d7h4h5f7b3c8b7b5b6c7a1a8b8a7a6a2d8b1g8f8h7h6g6",
+	"f5d6c6b6b7b8a8f4f3e3c8g4h3f2f1g5c5d2h5h4c1e2a7c2d1f6b2e1h6a2a3a4c7c3g7c4b3h8d3h7e6h2e7a1b1g2f7g6h1g1g8f8e8d8d7b4b5a5a6g3",
+	"d3e3f6c2e2d6b1d2c1d1e1f1g1f3g4f2d7b2c3g7e6c6h8g2b6b7a1d8c4c5f4g3h1g6c7b3h2h4f5g5h7b5h3g8f8e7e8f7a2a3c8b8b4a4h6h5a5a6a8a7",
+	"d3e3f2c6e6d2c3f4d1b3g5f3b2c1b1b4b5a1g3e1b7b6a3f6c5h3g2f1h1g1h2a8h4c4e2a2g4a4a6g6h5e7c2a5a7c7h6d6d8f5h7f7e8g8b8c8d7g7f8h8",
+	"d3e3f5c3d2f6f7c1b2b4e2a1c2f2b1d6e1f4a5d1g3f1c7f3c5b3g2h3h2g4h4d7a3c4h5g5h6a2g6a4e7a6e6e8f8g8b5b6b7a7c6g7h8h7d8c8h1g1a8b8",
+};
+
+typedef struct {
+	state_t state;
+	move_t move;
+	int square;
+} position_t;
+
+typedef struct {
+	const char *name;
+	uint64_t (*pass) (void);
+	int per_square;
+} primitive_t;
+
+typedef struct {
+	char name[32];
+	double mean;
+	uint64_t checksum;
+} baseline_t;
+
+typedef struct {
+	double mean, stddev, min, max;
+	long loops;
+	uint64_t checksum;
+} result_t;
+
+static position_t corpus[MAX_POSITIONS];
+static int positions = 0;
+static long squares = 0;
+
+static void usage(void) {
+	printf("Usage: micro_bench [-r N] [-g GAMES] [-j JSON] [-c BASELINE]\n"
+	"Time the board primitives over every position of a corpus of games\n"
+	"\n\t -r N\t\t N timed repetitions (default %d) after %d warmup ones\n"
+	"\t -g GAMES\t read the corpus from a games file instead of the built-in one\n"
+	"\t -j JSON\t also write the results to JSON\n"
+	"\t -c BASELINE\t compare with the JSON of an earlier run, and fail when a checksum differs\n", REPETITIONS, WARMUP);
+}
+
+static uint64_t moves_of(state_t state) {
+	return (state.player == BLACK_STONE)
+		? bb_mobility(state.board.black, state.board.white, state.board.size)
+		: bb_mobility(state.board.white, state.board.black, state.board.size);
+}
+
+static void add_position(state_t state, int square) {
+	position_t *p = &corpus[positions++];
+
+	p->state = state;
+	p->square = square;
+	p->move.row = square % state.board.size;
+	p->move.column = square / state.board.size;
+	squares += state.board.size * state.board.size;
+}
+
+static int load_builtin(void) {
+	state_t state;
+	bitboard_t next;
+	const char *m;
+	int g, square;
+
+	for (g = 0; g < (int) (sizeof(games) / sizeof(games[0])); g++) {
+		state.board = bb_init(8);
+		state.player = BLACK_STONE;
+		for (m = games[g]; m[0] && m[1]; m += 2) {
+			square = (m[1] - '1') * 8 + (m[0] - 'a');
+			if (!(moves_of(state) >> square & 1)) {
+				state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+			}
+			if (positions == MAX_POSITIONS || !(moves_of(state) >> square & 1)) {
+				return -1;
+			}
+			add_position(state, square);
+			next = bb_move(corpus[positions - 1].move, state);
+			state.board = next;
+			state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		}
+	}
+	return 0;
+}
+
+static int load_games(const char *filename) {
+	static state_t states[RECORD_MAX_MOVES + 1];
+	record_file_t rf;
+	game_t game;
+	int i, res;
+
+	if (game_reader_open(&rf, filename) != 0) {
+		return -1;
+	}
+	while ((res = game_read(&rf, &game)) == 1 && positions < MAX_POSITIONS) {
+		if (game_replay(&game, states) != 0) {
+			res = -1;
+			break;
+		}
+		for (i = 0; i < game.num_moves && positions < MAX_POSITIONS; i++)
+			add_position(states[i], game.moves[i]);
+	}
+	record_close(&rf);
+	return res < 0 ? -1 : 0;
+}
+
+static uint64_t pass_get_bit(void) {
+	uint64_t sum = 0, bits;
+	int i, sq, n;
+
+	for (i = 0; i < positions; i++) {
+		bits = corpus[i].state.board.black;
+		n = corpus[i].state.board.size * corpus[i].state.board.size;
+		for (sq = 0; sq < n; sq++)
+			sum += get_bit(bits, sq) << (sq & 7);
+	}
+	return sum;
+}
+
+static uint64_t pass_bb_moves(void) {
+	uint64_t sum = 0;
+	bitboard_t b;
+	int i;
+
+	for (i = 0; i < positions; i++) {
+		b = bb_moves(corpus[i].state);
+		sum += b.black ^ b.white;
+	}
+	return sum;
+}
+
+static uint64_t pass_bb_move(void) {
+	uint64_t sum = 0;
+	bitboard_t b;
+	int i;
+
+	for (i = 0; i < positions; i++) {
+		b = bb_move(corpus[i].move, corpus[i].state);
+		sum += b.black ^ (b.white << 1);
+	}
+	return sum;
+}
+
+static uint64_t pass_bb_score(void) {
+	uint64_t sum = 0;
+	score_t s;
+	int i;
+
+	for (i = 0; i < positions; i++) {
+		s = bb_score(corpus[i].state.board);
+		sum += s.black * 64 + s.white;
+	}
+	return sum;
+}
+
+static uint64_t pass_count_valid_moves(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += count_valid_moves(corpus[i].state);
+	return sum;
+}
+
+static uint64_t pass_bb_mobility(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += moves_of(corpus[i].state);
+	return sum;
+}
+
+static uint64_t pass_bb_flips(void) {
+	uint64_t sum = 0;
+	const state_t *s;
+	int i;
+
+	for (i = 0; i < positions; i++) {
+		s = &corpus[i].state;
+		sum += (s->player == BLACK_STONE)
+			? bb_flips(s->board.black, s->board.white, corpus[i].square, s->board.size)
+			: bb_flips(s->board.white, s->board.black, corpus[i].square, s->board.size);
+	}
+	return sum;
+}
+
+static uint64_t pass_bb_stable(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += bb_stable(corpus[i].state.board.black, corpus[i].state.board.white, corpus[i].state.board.size);
+	return sum;
+}
+
+static uint64_t pass_score_heuristic(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += score_heuristic(corpus[i].state);
+	return sum;
+}
+
+static uint64_t pass_coin_parity_heuristic(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += coin_parity_heuristic(corpus[i].state);
+	return sum;
+}
+
+static uint64_t pass_stability_heuristic(void) {
+	uint64_t sum = 0;
+	int i;
+
+	for (i = 0; i < positions; i++)
+		sum += stability_heuristic(corpus[i].state);
+	return sum;
+}
+
+static const primitive_t primitives[] = {
+	{ "get_bit", pass_get_bit, 1 },
+	{ "bb_moves", pass_bb_moves, 0 },
+	{ "bb_move", pass_bb_move, 0 },
+	{ "bb_score", pass_bb_score, 0 },
+	{ "count_valid_moves", pass_count_valid_moves, 0 },
+	{ "bb_mobility", pass_bb_mobility, 0 },
+	{ "bb_flips", pass_bb_flips, 0 },
+	{ "bb_stable", pass_bb_stable, 0 },
+	{ "score_heuristic", pass_score_heuristic, 0 },
+	{ "coin_parity_heuristic", pass_coin_parity_heuristic, 0 },
+	{ "stability_heuristic", pass_stability_heuristic, 0 }
+};
+
+/*
+ * One sample is as many corpus passes as take SAMPLE_SECONDS, so the clock
+ * resolution does not matter; the doubling doubles as a first warmup.
+ */
+static result_t measure(const primitive_t *p, int repetitions) {
+	volatile uint64_t sink = 0;
+	double ops = p->per_square ? squares : positions, start, elapsed, ns, sum = 0, sq = 0;
+	result_t r;
+	long l;
+	int i;
+
+	r.checksum = p->pass();
+	for (r.loops = 1;; r.loops *= 2) {
+		start = util_now();
+		for (l = 0; l < r.loops; l++)
+			sink += p->pass();
+		if (util_now() - start >= SAMPLE_SECONDS) {
+			break;
+		}
+	}
+	for (i = 0; i < WARMUP; i++) {
+		for (l = 0; l < r.loops; l++)
+			sink += p->pass();
+	}
+	r.min = INFINITY;
+	r.max = 0;
+	for (i = 0; i < repetitions; i++) {
+		start = util_now();
+		for (l = 0; l < r.loops; l++)
+			sink += p->pass();
+		elapsed = util_now() - start;
+		ns = elapsed * 1e9 / (r.loops * ops);
+		sum += ns;
+		sq += ns * ns;
+		r.min = fmin(r.min, ns);
+		r.max = fmax(r.max, ns);
+	}
+	r.mean = sum / repetitions;
+	r.stddev = repetitions > 1 ? sqrt(fmax(0, (sq - sum * sum / repetitions) / (repetitions - 1))) : 0;
+	return r;
+}
+
+/* the results of an earlier run, one per line as write_json puts them */
+static int read_baseline(const char *filename, baseline_t *baseline) {
+	char line[512], *p;
+	FILE *f = fopen(filename, "r");
+	int n = 0;
+
+	if (f == NULL) {
+		return -1;
+	}
+	while (fgets(line, sizeof(line), f) && n < MAX_PRIMITIVES) {
+		if ((p = strstr(line, "{\"name\": \"")) == NULL) {
+			continue;
+		}
+		if (sscanf(p, "{\"name\": \"%31[^\"]\", \"ns_per_op\": %lf", baseline[n].name, &baseline[n].mean) == 2
+				&& (p = strstr(p, "\"checksum\": ")) && sscanf(p, "\"checksum\": %" SCNu64, &baseline[n].checksum) == 1) {
+			n++;
+		}
+	}
+	fclose(f);
+	return n;
+}
+
+static void write_json(FILE *f, const result_t *results, int n, int repetitions) {
+	int i;
+
+	fprintf(f, "{\n  \"benchmark\": \"micro_bench\",\n");
+#ifdef __OPTIMIZE__
+	fprintf(f, "  \"compiler\": \"gcc %s\",\n  \"optimized\": true,\n", __VERSION__);
+#else
+	fprintf(f, "  \"compiler\": \"gcc %s\",\n  \"optimized\": false,\n", __VERSION__);
+#endif
+	fprintf(f, "  \"profile\": \"%s\",\n", BUILD_PROFILE);
+	fprintf(f, "  \"positions\": %d,\n  \"repetitions\": %d,\n  \"warmup\": %d,\n  \"results\": [\n",
+		positions, repetitions, WARMUP);
+	for (i = 0; i < n; i++) {
+		fprintf(f, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"stddev_ns\": %.3f, \"min_ns\": %.3f, "
+			"\"max_ns\": %.3f, \"ops_per_s\": %.0f, \"loops\": %ld, \"checksum\": %" PRIu64 "}%s\n",
+			primitives[i].name, results[i].mean, results[i].stddev, results[i].min, results[i].max,
+			1e9 / results[i].mean, results[i].loops, results[i].checksum, i + 1 < n ? "," : "");
+	}
+	fprintf(f, "  ]\n}\n");
+}
+
+int main(int argc, char *argv[]) {
+	const int n = sizeof(primitives) / sizeof(primitives[0]);
+	result_t results[sizeof(primitives) / sizeof(primitives[0])];
+	baseline_t baseline[MAX_PRIMITIVES];
+	char *games_file = NULL, *json = NULL, *compare = NULL;
+	int opt, i, b, bases = 0, mismatches = 0, repetitions = REPETITIONS;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "r:g:j:c:h")) != -1) {
+		switch (opt) {
+		case 'r':
+			repetitions = atoi(optarg);
+			break;
+		case 'g':
+			games_file = optarg;
+			break;
+		case 'j':
+			json = optarg;
+			break;
+		case 'c':
+			compare = optarg;
+			break;
+		default:
+			usage();
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind < argc || repetitions < 1) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if ((games_file ? load_games(games_file) : load_builtin()) != 0 || positions == 0) {
+		fprintf(stderr, "micro_bench: error: cannot read the games of '%s'\n", games_file ? games_file : "corpus");
+		return EXIT_FAILURE;
+	}
+	if (compare && (bases = read_baseline(compare, baseline)) < 0) {
+		fprintf(stderr, "micro_bench: error: cannot read '%s'\n", compare);
+		return EXIT_FAILURE;
+	}
+
+	printf("%s build, %d positions, %d repetitions after %d warmup ones\n", BUILD_PROFILE, positions, repetitions,
+		WARMUP);
+	printf("%-22s %10s %8s %10s %12s", "primitive", "ns/op", "stddev", "min", "ops/s");
+	if (compare) {
+		printf(" %10s %8s", "base ns/op", "change");
+	}
+	printf("\n");
+	for (i = 0; i < n; i++) {
+		results[i] = measure(&primitives[i], repetitions);
+		printf("%-22s %10.2f %7.1f%% %10.2f %12.0f", primitives[i].name, results[i].mean,
+			100 * results[i].stddev / results[i].mean, results[i].min, 1e9 / results[i].mean);
+		for (b = 0; b < bases && strcmp(baseline[b].name, primitives[i].name) != 0; b++)
+			;
+		if (b < bases) {
+			mismatches += baseline[b].checksum != results[i].checksum;
+			printf(" %10.2f %+7.1f%%%s", baseline[b].mean, 100 * (results[i].mean - baseline[b].mean) / baseline[b].mean,
+				baseline[b].checksum == results[i].checksum ? "" : "  MISMATCH");
+		}
+		printf("\n");
+	}
+
+	if (json) {
+		if ((f = fopen(json, "w")) == NULL) {
+			fprintf(stderr, "micro_bench: error: cannot write '%s'\n", json);
+			return EXIT_FAILURE;
+		}
+		write_json(f, results, n, repetitions);
+		fclose(f);
+	}
+	if (mismatches) {
+		fprintf(stderr, "micro_bench: error: %d checksums differ from '%s'\n", mismatches, compare);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
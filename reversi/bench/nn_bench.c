@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/nn.h"
+#include "../include/util.h"
+
+#define POSITIONS 200
+#define ROUNDS 200
+#define DEPTH 4
+
+static size_t leaves = 0;
+
+/* full evaluation of every leaf, through the function pointer */
+static int nn_plugin(state_t state) {
+	leaves++;
+	if (state.player == BLACK_STONE) {
+		return nn_eval(state.board.black, state.board.white, state.board.size);
+	}
+	return nn_eval(state.board.white, state.board.black, state.board.size);
+}
+
+/* midgame positions from random games */
+static void make_positions(state_t *states) {
+	uint64_t own, opp, moves, flips, tmp;
+	char player;
+	int i, ply, n;
+
+	srand(42);
+	for (i = 0; i < POSITIONS; i++) {
+		states[i].board = bb_init(8);
+		own = states[i].board.black;
+		opp = states[i].board.white;
+		player = BLACK_STONE;
+		for (ply = 0; ply < 16 + rand() % 20; ply++) {
+			moves = bb_mobility(own, opp, 8);
+			if (moves == 0) {
+				break;
+			}
+			for (n = rand() % __builtin_popcountll(moves); n > 0; n--) {
+				moves &= moves - 1;
+			}
+			flips = bb_flips(own, opp, __builtin_ctzll(moves), 8);
+			own |= flips | (moves & -moves);
+			opp &= ~flips;
+			tmp = own;
+			own = opp;
+			opp = tmp;
+			player = (player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		}
+		states[i].player = player;
+		states[i].board.black = (player == BLACK_STONE) ? own : opp;
+		states[i].board.white = (player == BLACK_STONE) ? opp : own;
+	}
+}
+
+/* the timing does not depend on the weights, a random network will do */
+static void random_weights(void) {
+	static nn_weights_t w;
+	int i, k;
+
+	srand(7);
+	w.size = 8;
+	for (i = 0; i < NN_INPUTS; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			w.w1[i][k] = rand() % 41 - 20;
+	}
+	for (k = 0; k < NN_HIDDEN1; k++)
+		w.b1[k] = rand() % 64;
+	for (i = 0; i < NN_HIDDEN2; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			w.w2[i][k] = rand() % 61 - 30;
+		w.b2[i] = rand() % 4096;
+		w.w3[i] = rand() % 255 - 127;
+	}
+	w.b3 = 0;
+	nn_set(&w);
+}
+
+/* full evaluations per second, with a checksum of the values */
+static double full(const state_t *states, long *sum) {
+	double start = util_now();
+	int r, i;
+
+	*sum = 0;
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < POSITIONS; i++)
+			*sum += nn_heuristic(states[i]);
+	}
+	return (double) ROUNDS * POSITIONS / (util_now() - start);
+}
+
+/* a move applied to the accumulators and the output evaluated, per second */
+static double incremental(const state_t *states, long *sum) {
+	nn_acc_t acc[POSITIONS], next;
+	uint64_t own, opp, moves, flips;
+	double start;
+	int r, i, square, color;
+
+	for (i = 0; i < POSITIONS; i++)
+		nn_refresh(&acc[i], states[i].board.black, states[i].board.white);
+	*sum = 0;
+	start = util_now();
+	for (r = 0; r < ROUNDS; r++) {
+		for (i = 0; i < POSITIONS; i++) {
+			color = (states[i].player == WHITE_STONE);
+			own = color ? states[i].board.white : states[i].board.black;
+			opp = color ? states[i].board.black : states[i].board.white;
+			moves = bb_mobility(own, opp, 8);
+			if (moves == 0)
+				continue;
+			square = __builtin_ctzll(moves);
+			flips = bb_flips(own, opp, square, 8);
+			nn_update(&next, &acc[i], color, square, flips);
+			*sum += nn_output(&next, !color, bb_mobility(opp ^ flips, own | flips | (uint64_t) 1 << square, 8));
+		}
+	}
+	return (double) ROUNDS * POSITIONS / (util_now() - start);
+}
+
+static double search(const state_t *states, int (*heuristic) (state_t state), move_t *moves) {
+	double start, elapsed = 0;
+	int i;
+
+	for (i = 0; i < POSITIONS; i++) {
+		tt_clear();
+		start = util_now();
+		moves[i] = negamax_alphabeta(states[i], DEPTH, heuristic);
+		elapsed += util_now() - start;
+	}
+	return elapsed;
+}
+
+int main(void) {
+	state_t states[POSITIONS];
+	move_t slow[POSITIONS], fast[POSITIONS], other[POSITIONS];
+	double full_rate, incr_rate, plugin, inlined, stability;
+	long full_sum, incr_sum, full_ref = 0, incr_ref = 0;
+	int isa, i, same = 1;
+
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	make_positions(states);
+	random_weights();
+
+	printf("%-8s %16s %16s\n", "isa", "full (Meval/s)", "incr (Meval/s)");
+	for (isa = NN_SCALAR; isa <= NN_AVX2; isa++) {
+		if (nn_set_isa(isa) != isa)
+			continue;
+		full_rate = full(states, &full_sum);
+		incr_rate = incremental(states, &incr_sum);
+		if (isa == NN_SCALAR) {
+			full_ref = full_sum;
+			incr_ref = incr_sum;
+		}
+		printf("%-8s %16.3f %16.3f%s\n", isa == NN_SCALAR ? "scalar" : "avx2", full_rate * 1e-6, incr_rate * 1e-6,
+			full_sum == full_ref && incr_sum == incr_ref ? "" : "  MISMATCH");
+	}
+
+	nn_set_isa(NN_AVX2);
+	plugin = search(states, nn_plugin, slow);
+	inlined = search(states, nn_heuristic, fast);
+	stability = search(states, stability_heuristic, other);
+	for (i = 0; i < POSITIONS; i++) {
+		same &= fast[i].row == slow[i].row && fast[i].column == slow[i].column;
+	}
+	printf("\nnegamax_alphabeta depth %d, %d positions, %zu leaves\n", DEPTH, POSITIONS, leaves);
+	printf("network, full evaluation  %8.1f ns/leaf\n", plugin * 1e9 / leaves);
+	printf("network, incremental      %8.1f ns/leaf  x%.2f  %s\n", inlined * 1e9 / leaves, plugin / inlined,
+		same ? "" : "MISMATCH");
+	printf("search time per position  %8.2f ms with the network, %.2f ms with stability\n",
+		inlined * 1e3 / POSITIONS, stability * 1e3 / POSITIONS);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/board_io.h"
+#include "../include/util.h"
+
+#define DEFAULT_BOARDS 10000
+#define REPETITIONS 20
+
+/* random 8x8 positions in the text format, with a comment every board */
+static char *make_corpus(size_t boards, size_t *length) {
+	char *data, *p, cells[] = { BLACK_STONE, WHITE_STONE, EMPTY_STONE };
+	size_t i, row, col;
+
+	data = malloc(boards * 200);
+	if (data == NULL) {
+		return NULL;
+	}
+	p = data;
+	srand(42);
+	for (i = 0; i < boards; i++) {
+		p += sprintf(p, "# board %zu\n%c\n", i, (i & 1) ? WHITE_STONE : BLACK_STONE);
+		for (row = 0; row < 8; row++) {
+			for (col = 0; col < 8; col++) {
+				*p++ = cells[rand() % 3];
+				*p++ = col == 7 ? '\n' : ' ';
+			}
+		}
+	}
+	*length = p - data;
+	return data;
+}
+
+int main(int argc, char *argv[]) {
+	board_file_t file;
+	board_reader_t reader;
+	state_t state;
+	char *data;
+	size_t length, boards = 0;
+	double start, elapsed, best = 1e30, total = 0;
+	int i, res;
+
+	if (argc > 1) {
+		if (board_file_open(argv[1], &file) != 0) {
+			fprintf(stderr, "parse_bench: cannot open '%s'\n", argv[1]);
+			return EXIT_FAILURE;
+		}
+		data = file.data;
+		length = file.length;
+	} else {
+		data = make_corpus(DEFAULT_BOARDS, &length);
+		if (data == NULL) {
+			fprintf(stderr, "No memory available\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < REPETITIONS; i++) {
+		boards = 0;
+		board_reader_init(&reader, data, length);
+		start = util_now();
+		while ((res = board_read(&reader, &state)) == BOARD_OK) {
+			boards++;
+		}
+		elapsed = util_now() - start;
+		if (res == BOARD_ERROR) {
+			fprintf(stderr, "%s\n", reader.error);
+			return EXIT_FAILURE;
+		}
+		total += elapsed;
+		if (elapsed < best) {
+			best = elapsed;
+		}
+	}
+
+	printf("parse_bench: %zu boards, %zu bytes, %d repetitions\n", boards, length, REPETITIONS);
+	if (boards) {
+		printf("  best: %.1f ns/board, %.1f MB/s\n", best * 1e9 / boards, length / best / 1e6);
+		printf("  mean: %.1f ns/board\n", total / REPETITIONS * 1e9 / boards);
+	}
+	if (argc > 1) {
+		board_file_close(&file);
+	} else {
+		free(data);
+	}
+	return EXIT_SUCCESS;
+}
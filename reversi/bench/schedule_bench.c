@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/libreversi.h"
+#include "../include/schedule.h"
+#include "../src/reversi.h"
+#include "../include/util.h"
+
+#define CLOCK_SECONDS 10
+#define GAMES 4
+#define OPENING_MOVES 4
+
+/*
+ * Self-play games on a clock of CLOCK_SECONDS per player, after a few
+ * random moves, with the schedule of a file or calibrated first. Every
+ * move is planned by the schedule: per phase, the depth searched and the
+ * time taken against the predicted time, then the empties at which each
+ * side started solving and the clock left.
+ */
+
+static const char *phases[SCHEDULE_PHASES + 1] = { "opening", "early", "middle", "late", "solve" };
+
+typedef struct {
+	int moves;
+	int stopped;
+	long depths;
+	double planned;
+	double elapsed;
+	double worst;
+} row_t;
+
+static int random_move(reversi_t *ctx) {
+	int squares[REVERSI_MAX_SQUARES], n = reversi_moves(ctx, squares, REVERSI_MAX_SQUARES);
+	return reversi_play(ctx, n ? squares[rand() % n] : REVERSI_PASS);
+}
+
+int main(int argc, char *argv[]) {
+	double seconds = argc > 1 ? atof(argv[1]) : CLOCK_SECONDS, start, clock[2], left = 0, lowest = seconds;
+	int games = argc > 2 ? atoi(argv[2]) : GAMES;
+	reversi_settings_t settings;
+	reversi_result_t result;
+	row_t rows[SCHEDULE_PHASES + 1] = { { 0 } };
+	reversi_t *ctx;
+	uint64_t black, white;
+	char player;
+	int g, i, p, size, solve[2], solves = 0, solve_empties = 0, flagged = 0;
+
+	if (seconds <= 0 || games < 1) {
+		fprintf(stderr, "Usage: schedule_bench [SECONDS [GAMES [SCHEDULE]]]\n");
+		return EXIT_FAILURE;
+	}
+	if (argc > 3) {
+		if (reversi_load_schedule(argv[3]) != REVERSI_OK) {
+			fprintf(stderr, "schedule_bench: error: cannot load schedule '%s'\n", argv[3]);
+			return EXIT_FAILURE;
+		}
+	} else {
+		start = util_now();
+		reversi_calibrate(SCHEDULE_CALIBRATION);
+		printf("calibration: %.3f s\n", util_now() - start);
+	}
+	reversi_default_settings(&settings);
+	settings.evaluator = REVERSI_EVAL_STABILITY;
+	settings.clock_ms = (int) (seconds * 1000);
+	if (reversi_new(&ctx, 8, &settings) != REVERSI_OK) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	srand(42);
+	for (g = 0; g < games; g++) {
+		reversi_reset(ctx, 8);
+		for (i = 0; i < OPENING_MOVES; i++)
+			random_move(ctx);
+		solve[0] = solve[1] = 0;
+		while (!reversi_game_over(ctx)) {
+			reversi_position(ctx, &black, &white, &player, &size);
+			if (reversi_search(ctx, &result) != REVERSI_OK) {
+				fprintf(stderr, "schedule_bench: error: %s\n", reversi_error(ctx));
+				return EXIT_FAILURE;
+			}
+			if (result.square != REVERSI_PASS) {
+				p = (result.source == REVERSI_SOURCE_SOLVE) ? SCHEDULE_PHASES : probcut_phase(black | white, size);
+				if (p == SCHEDULE_PHASES && !solve[player != BLACK_STONE]) {
+					solve[player != BLACK_STONE] = 1;
+					solves++;
+					solve_empties += size * size - __builtin_popcountll(black | white);
+				}
+				rows[p].moves++;
+				rows[p].stopped += result.stopped;
+				rows[p].depths += result.depth;
+				rows[p].planned += result.planned;
+				rows[p].elapsed += result.elapsed;
+				if (result.elapsed - result.planned > rows[p].worst)
+					rows[p].worst = result.elapsed - result.planned;
+			}
+			reversi_play(ctx, result.square);
+		}
+		reversi_clock(ctx, &clock[0], &clock[1]);
+		for (i = 0; i < 2; i++) {
+			left += clock[i];
+			lowest = clock[i] < lowest ? clock[i] : lowest;
+			flagged += clock[i] < 0;
+		}
+	}
+	reversi_free(ctx);
+
+	printf("%d games, %.1f s per player\n", games, seconds);
+	printf("%-8s %6s %7s %12s %12s %8s %13s %8s\n", "phase", "moves", "depth", "planned (s)", "time (s)", "ratio",
+		"worst over (s)", "stopped");
+	for (p = 0; p <= SCHEDULE_PHASES; p++) {
+		if (rows[p].moves == 0)
+			continue;
+		printf("%-8s %6d %7.1f %12.4f %12.4f %8.2f %13.3f %8d\n", phases[p], rows[p].moves,
+			(double) rows[p].depths / rows[p].moves, rows[p].planned / rows[p].moves,
+			rows[p].elapsed / rows[p].moves, rows[p].planned > 0 ? rows[p].elapsed / rows[p].planned : 0,
+			rows[p].worst, rows[p].stopped);
+	}
+	printf("solve from %.1f empties on average (%d of %d sides)\n", solves ? (double) solve_empties / solves : 0,
+		solves, 2 * games);
+	printf("clock left: %.2f s on average, %.2f s at least, %d sides out of time\n", left / (2 * games), lowest,
+		flagged);
+	return flagged ? EXIT_FAILURE : EXIT_SUCCESS;
+}
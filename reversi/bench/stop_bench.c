@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <pthread.h>
+#include "../include/libreversi.h"
+#include "../src/reversi.h"
+#include "../include/util.h"
+
+#define MAX_POSITIONS 64
+#define TEXT_LENGTH 256
+#define ROUNDS 3
+#define MIN_DELAY_MS 5
+#define MAX_DELAY_MS 50
+
+/*
+ * Time to stop: a search without limits runs on a thread of its own and
+ * is stopped with reversi_stop() after a random delay. The latency is the
+ * time from the call to the return of reversi_search(), which must then
+ * answer its best move so far.
+ */
+
+typedef struct {
+	const char *name;
+	const char *suite;
+	int engine;
+	int endgame_empties;
+	int threads;
+} config_t;
+
+typedef struct {
+	reversi_t *ctx;
+	reversi_result_t result;
+	int res;
+	double end;
+} job_t;
+
+static const config_t configs[] = {
+	{ "alphabeta", "../suites/midgame.txt", REVERSI_ALPHABETA, 0, 1 },
+	{ "solve", "../suites/endgame.txt", REVERSI_ALPHABETA, REVERSI_MAX_SQUARES, 1 },
+	{ "mcts x2", "../suites/midgame.txt", REVERSI_MCTS, 0, 2 },
+};
+
+/* the boards of a suite, as the text of board files */
+static int load_boards(const char *filename, char boards[][TEXT_LENGTH]) {
+	char line[128];
+	size_t length = 0;
+	int n = 0;
+	FILE *f = fopen(filename, "r");
+
+	if (f == NULL) {
+		return -1;
+	}
+	while (n < MAX_POSITIONS) {
+		if (fgets(line, sizeof(line), f) && line[0] != '#' && line[0] != '\n') {
+			if (length + strlen(line) < TEXT_LENGTH) {
+				strcpy(boards[n] + length, line);
+				length += strlen(line);
+			}
+			continue;
+		}
+		if (length) {
+			n++;
+			length = 0;
+		}
+		if (feof(f)) {
+			break;
+		}
+	}
+	fclose(f);
+	return n;
+}
+
+static void *search(void *arg) {
+	job_t *job = arg;
+	job->res = reversi_search(job->ctx, &job->result);
+	job->end = util_now();
+	return NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+int main(void) {
+	static char boards[MAX_POSITIONS][TEXT_LENGTH];
+	double latencies[MAX_POSITIONS * ROUNDS], start, delay;
+	reversi_settings_t settings;
+	pthread_t thread;
+	job_t job;
+	size_t c;
+	int n, i, r, count, unstopped, failed = 0;
+	long depths;
+
+	srand(42);
+	printf("%-10s %7s %10s %10s %10s %10s %9s\n", "engine", "stops", "p50 (us)", "p99 (us)", "max (us)",
+		"depth", "finished");
+	for (c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+		if ((n = load_boards(configs[c].suite, boards)) <= 0) {
+			fprintf(stderr, "stop_bench: error: cannot read suite '%s'\n", configs[c].suite);
+			return EXIT_FAILURE;
+		}
+		reversi_default_settings(&settings);
+		settings.engine = configs[c].engine;
+		settings.evaluator = REVERSI_EVAL_STABILITY;
+		settings.depth = REVERSI_MAX_SQUARES;
+		settings.endgame_empties = configs[c].endgame_empties;
+		settings.playouts = 1 << 30;
+		settings.threads = configs[c].threads;
+		if (reversi_new(&job.ctx, 8, &settings) != REVERSI_OK) {
+			fprintf(stderr, "No memory available\n");
+			return EXIT_FAILURE;
+		}
+		count = unstopped = 0;
+		depths = 0;
+		for (i = 0; i < n; i++) {
+			for (r = 0; r < ROUNDS; r++) {
+				if (reversi_load(job.ctx, boards[i], strlen(boards[i])) != REVERSI_OK) {
+					fprintf(stderr, "stop_bench: error: %s\n", reversi_error(job.ctx));
+					return EXIT_FAILURE;
+				}
+				delay = (MIN_DELAY_MS + rand() % (MAX_DELAY_MS - MIN_DELAY_MS + 1)) * 1e-3;
+				pthread_create(&thread, NULL, search, &job);
+				nanosleep(&(struct timespec) { 0, (long) (delay * 1e9) }, NULL);
+				start = util_now();
+				reversi_stop(job.ctx);
+				pthread_join(thread, NULL);
+				if (job.res != REVERSI_OK || job.result.square == REVERSI_PASS) {
+					failed++;
+				} else if (!job.result.stopped) {
+					unstopped++;
+				} else {
+					latencies[count++] = job.end - start;
+					depths += job.result.depth;
+				}
+			}
+		}
+		reversi_free(job.ctx);
+		if (count == 0) {
+			continue;
+		}
+		qsort(latencies, count, sizeof(double), compare_doubles);
+		printf("%-10s %7d %10.1f %10.1f %10.1f %10.1f %9d\n", configs[c].name, count, latencies[count / 2] * 1e6,
+			latencies[count * 99 / 100] * 1e6, latencies[count - 1] * 1e6, (double) depths / count, unstopped);
+	}
+	if (failed) {
+		fprintf(stderr, "stop_bench: error: %d stopped searches without a move\n", failed);
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
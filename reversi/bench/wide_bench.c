@@ -0,0 +1,47 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/wide.h"
+#include "../include/util.h"
+
+#define SEARCH_DEPTH 6
+
+static const int perft_depths[] = { 0, 0, 0, 0, 8, 0, 6, 0, 6, 0, 5, 0, 5, 0, 5, 0, 5 };
+
+int main(void) {
+	wide_state_t state;
+	uint64_t narrow = 0, words;
+	double start, t_narrow = 0, t_words, t_search;
+	size_t size, nodes;
+	int depth, best;
+
+	printf("size  depth        perft  single word (Mn/s)  multi-word (Mn/s)  search depth %d (kn/s)\n",
+		SEARCH_DEPTH);
+	for (size = 4; size <= WIDE_MAX_SIZE; size += 2) {
+		depth = perft_depths[size];
+		state.board = wide_init(size);
+		state.player = BLACK_STONE;
+
+		if (size <= MAX_BOARD_SIZE) {
+			start = util_now();
+			narrow = wide_perft(state, depth);
+			t_narrow = util_now() - start;
+		}
+		start = util_now();
+		words = wide_perft_words(state, depth);
+		t_words = util_now() - start;
+
+		start = util_now();
+		best = wide_search(state, SEARCH_DEPTH, NULL, &nodes);
+		t_search = util_now() - start;
+
+		printf("%2zux%-2zu %5d %12llu  ", size, size, depth, (unsigned long long) words);
+		if (size <= MAX_BOARD_SIZE) {
+			printf("%18.2f", narrow / t_narrow * 1e-6);
+		} else {
+			printf("%18s", "-");
+		}
+		printf("  %17.2f  %10zu nodes %8.1f%s\n", words / t_words * 1e-6, nodes, nodes / t_search * 1e-3,
+			(size <= MAX_BOARD_SIZE && narrow != words) || best == WIDE_PASS ? "  MISMATCH" : "");
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,43 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "bitboard.h"
+
+#define BATCH_SCALAR 0
+#define BATCH_AVX2 1
+#define BATCH_AVX512 2
+
+/*
+ * A block of independent positions of the same board size, stored as
+ * structure of arrays: own[i] and opp[i] are the discs of the player to
+ * move and of the opponent in position i. The kernels below run 4 (AVX2)
+ * or 8 (AVX-512) positions per instruction and finish with a scalar loop;
+ * the instruction set is picked at run time from what the CPU supports.
+ */
+typedef struct {
+	size_t size;
+	size_t count;
+	size_t capacity;
+	uint64_t *own;
+	uint64_t *opp;
+} batch_t;
+
+int batch_init(batch_t *batch, size_t size, size_t capacity);
+
+void batch_free(batch_t *batch);
+
+int batch_add(batch_t *batch, state_t state);
+
+void batch_mobility(const batch_t *batch, uint64_t *moves);
+
+void batch_flips(const batch_t *batch, const uint8_t *squares, uint64_t *flips);
+
+void batch_count(const batch_t *batch, int *own, int *opp);
+
+void batch_eval(const batch_t *batch, int *values);
+
+int batch_isa(void);
+
+int batch_set_isa(int isa);
+
+#endif
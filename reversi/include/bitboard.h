@@ -4,11 +4,45 @@
 #include <limits.h>
 #include "../src/reversi.h"
 
+#define AI_DEPTH 2
+#define ANALYSIS_DEPTH 8
+#define ENDGAME_EMPTIES 10
+
+#define ENGINE_ALPHABETA 0
+#define ENGINE_MCTS 1
+#define SCORE_INF INT_MAX
+#define EDGE_CONFIGS 6561
+#define STABILITY_WEIGHT 10
+
 typedef struct {
 	int v;
 	move_t move;
 } algo_t;
 
+#define ANALYSIS_MAX_PV 24
+#define ANALYSIS_EXACT 0
+#define ANALYSIS_UPPER 2
+
+/* bound is ANALYSIS_UPPER when the move only failed to beat the lines-th best */
+typedef struct {
+	move_t move;
+	int score;
+	int bound;
+	int pv_length;
+	move_t pv[ANALYSIS_MAX_PV];
+} analysis_line_t;
+
+/* root moves best first after a completed depth; depth is the empties when solved */
+typedef struct {
+	int depth;
+	bool solved;
+	int num_lines;
+	size_t nodes;
+	analysis_line_t lines[MAX_BOARD_SIZE * MAX_BOARD_SIZE];
+} analysis_t;
+
+typedef void (*analysis_report_t) (const analysis_t *analysis, void *arg);
+
 bitboard_t bb_new(size_t size);
 
 bitboard_t bb_set(move_t move, state_t state);
@@ -19,12 +53,40 @@ void bb_print(bitboard_t board);
 
 score_t bb_score(bitboard_t board);
 
+int bb_empties(bitboard_t board);
+
 bitboard_t bb_move(move_t move, state_t state);
 
 bitboard_t bb_moves(state_t state);
 
+const uint64_t *bb_size_masks(size_t size);
+
+uint64_t bb_mobility(uint64_t own, uint64_t opp, size_t size);
+
+uint64_t bb_flips(uint64_t own, uint64_t opp, int pos, size_t size);
+
+uint64_t bb_stable(uint64_t own, uint64_t opp, size_t size);
+
+int bb_symmetry_square(int pos, size_t size, int sym);
+
+bitboard_t bb_symmetry(bitboard_t board, int sym);
+
 int score_heuristic (state_t state);
 
+int coin_parity_heuristic (state_t state);
+
+int stability_heuristic (state_t state);
+
+void bb_search_stop(int stop);
+
+void bb_search_flag(int *flag);
+
+int bb_search_stopped(void);
+
+int *bb_search_current_flag(void);
+
+size_t bb_search_nodes(void);
+
 move_t minimax(state_t state, int depth, int (*heuristic) (state_t state));
 
 move_t negamax(state_t state, int depth, int (*heuristic) (state_t state));
@@ -33,6 +95,21 @@ move_t minimax_alphabeta(state_t state, int depth, int (*heuristic) (state_t sta
 
 move_t negamax_alphabeta(state_t state, int depth, int (*heuristic) (state_t state));
 
+algo_t negamax_alphabeta_search(state_t state, int depth, int (*heuristic) (state_t state));
+
+int negamax_alphabeta_value(state_t state, int depth, int (*heuristic) (state_t state));
+
+algo_t bb_deepening_search(state_t state, int depth, int (*heuristic) (state_t state), int *reached);
+
+move_t ai_solve(state_t state, int *score);
+
+int bb_analyze(state_t state, int depth, int lines, int solve_empties, int (*heuristic) (state_t state),
+	analysis_report_t report, void *arg, analysis_t *result);
+
+move_t ai_search(state_t state, int depth);
+
+void ai_set_engine(int name);
+
 move_t ai_player(state_t state);
 
 uint8_t get_bit(uint64_t bits, int pos);
@@ -0,0 +1,37 @@
+#ifndef BOARD_IO_H
+#define BOARD_IO_H
+
+#include "bitboard.h"
+
+#define BOARD_ERROR -1
+#define BOARD_END 0
+#define BOARD_OK 1
+
+#define BOARD_SQUARE_NAME 16
+
+typedef struct {
+	char *data;
+	size_t length;
+} board_file_t;
+
+typedef struct {
+	const char *cur;
+	const char *end;
+	int line;
+	char error[128];
+} board_reader_t;
+
+int board_file_open(const char *filename, board_file_t *file);
+
+void board_file_close(board_file_t *file);
+
+void board_reader_init(board_reader_t *reader, const char *data, size_t length);
+
+int board_read(board_reader_t *reader, state_t *state);
+
+int board_write(FILE *f, state_t state);
+
+/* the row letter and the column number of a square, "pass" when it is negative */
+void board_square_name(int square, size_t size, char name[BOARD_SQUARE_NAME]);
+
+#endif
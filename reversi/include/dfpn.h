@@ -0,0 +1,75 @@
+#ifndef DFPN_H
+#define DFPN_H
+
+#include "bitboard.h"
+
+#define DFPN_INF 0x3fffffff
+#define DFPN_MEMORY 64
+#define DFPN_BUCKET 4
+#define DFPN_LEAF_EMPTIES 6
+#define DFPN_EPSILON 0.25
+#define DFPN_GC_LOAD 0.9
+#define DFPN_GC_KEEP 0.5
+
+#define DFPN_UNKNOWN 2
+#define DFPN_DISPROVEN 0
+#define DFPN_PROVEN 1
+
+#define DFPN_LOSS -1
+#define DFPN_DRAW 0
+#define DFPN_WIN 1
+
+/*
+ * Depth-first proof-number search. A proof answers one question: is the
+ * final disc difference of the side to move greater than a threshold?
+ * Proof and disproof numbers are kept in a transposition table of fixed
+ * size, in buckets of DFPN_BUCKET entries; a full bucket gives up its
+ * entry with the least work (nodes searched below it). When the table is
+ * DFPN_GC_LOAD full, the entries with the smallest work are collected so
+ * that about DFPN_GC_KEEP of them remain. Children get their thresholds
+ * with the 1 + epsilon trick, and positions with at most leaf_empties
+ * empty squares are solved directly.
+ */
+typedef struct {
+	uint64_t key;
+	uint32_t pn;
+	uint32_t dn;
+	uint32_t work;
+	uint32_t tree;
+	int8_t best;
+	uint8_t pad[7];
+} dfpn_entry_t;
+
+typedef struct {
+	dfpn_entry_t *table;
+	size_t buckets;
+	size_t used;
+	size_t max_nodes;
+	double epsilon;
+	int leaf_empties;
+	int aborted;
+	size_t nodes;
+	size_t collections;
+	size_t collected;
+} dfpn_t;
+
+typedef struct {
+	int outcome;
+	move_t move;
+	size_t tree;
+	size_t nodes;
+	size_t collections;
+	double elapsed;
+} dfpn_result_t;
+
+int dfpn_init(dfpn_t *dfpn, size_t megabytes);
+
+void dfpn_free(dfpn_t *dfpn);
+
+void dfpn_clear(dfpn_t *dfpn);
+
+int dfpn_prove(dfpn_t *dfpn, state_t state, int threshold, move_t *move, size_t *tree);
+
+int dfpn_solve(dfpn_t *dfpn, state_t state, dfpn_result_t *result);
+
+#endif
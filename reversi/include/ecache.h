@@ -0,0 +1,76 @@
+#ifndef ECACHE_H
+#define ECACHE_H
+
+#include "probcut.h"
+
+#define ECACHE_BITS 13
+#define ECACHE_PHASES PROBCUT_PHASES
+#define ECACHE_ALL ((1 << ECACHE_PHASES) - 1)
+#define ECACHE_DEFAULT (ECACHE_ALL & ~1)
+
+#define ECACHE_MOVES 1
+#define ECACHE_VALUE 2
+
+/*
+ * Per-thread, direct-mapped cache of search nodes by position key (the
+ * transposition table key): the mobility of the side to move, and the leaf
+ * value. 2^ECACHE_BITS entries of 24 bytes, 192 KB, to stay in L2. Moves
+ * never change for a key; values belong to one search, so a new search
+ * bumps the generation and older values no longer match. Each game phase
+ * (as in probcut_phase) can be switched off where the cache does not pay;
+ * the opening, with few transpositions, is off by default.
+ */
+typedef struct {
+	uint64_t key;
+	uint64_t moves;
+	int32_t value;
+	uint16_t generation;
+	uint16_t flags;
+} ecache_entry_t;
+
+typedef struct {
+	size_t probes[ECACHE_PHASES][2];
+	size_t hits[ECACHE_PHASES][2];
+} ecache_stats_t;
+
+typedef struct {
+	uint16_t generation;
+	ecache_stats_t stats;
+	ecache_entry_t entries[1 << ECACHE_BITS];
+} ecache_t;
+
+extern __thread ecache_t *ecache_local;
+
+ecache_t *ecache_create(void);
+
+void ecache_begin(void);
+
+void ecache_clear(void);
+
+void ecache_enable(int phases);
+
+int ecache_enabled(int phase);
+
+void ecache_stats(ecache_stats_t *stats);
+
+void ecache_reset_stats(void);
+
+static inline ecache_t *ecache_get(void) {
+	return ecache_local ? ecache_local : ecache_create();
+}
+
+/* the entry for key, which may hold another position; NULL without memory */
+static inline ecache_entry_t *ecache_slot(ecache_t *cache, uint64_t key) {
+	ecache_entry_t *e = &cache->entries[key & ((1 << ECACHE_BITS) - 1)];
+	if (e->key != key) {
+		e->key = key;
+		e->flags = 0;
+	}
+	return e;
+}
+
+static inline int ecache_has(const ecache_t *cache, const ecache_entry_t *e, int what) {
+	return (e->flags & what) && (what == ECACHE_MOVES || e->generation == cache->generation);
+}
+
+#endif
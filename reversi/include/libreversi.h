@@ -0,0 +1,203 @@
+#ifndef LIBREVERSI_H
+#define LIBREVERSI_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REVERSI_OK 0
+#define REVERSI_ERR_MEMORY -1
+#define REVERSI_ERR_ARGUMENT -2
+#define REVERSI_ERR_FILE -3
+#define REVERSI_ERR_FORMAT -4
+#define REVERSI_ERR_SIZE -5
+#define REVERSI_ERR_ILLEGAL -6
+#define REVERSI_ERR_GAME_OVER -7
+#define REVERSI_ERR_STOPPED -8
+
+#define REVERSI_PASS -1
+#define REVERSI_MAX_SQUARES 64
+
+#define REVERSI_ALPHABETA 0
+#define REVERSI_MCTS 1
+
+#define REVERSI_EVAL_AUTO 0
+#define REVERSI_EVAL_STABILITY 1
+#define REVERSI_EVAL_COIN_PARITY 2
+#define REVERSI_EVAL_SCORE 3
+#define REVERSI_EVAL_NETWORK 4
+
+#define REVERSI_SOURCE_SEARCH 0
+#define REVERSI_SOURCE_SOLVE 1
+#define REVERSI_SOURCE_DATABASE 2
+#define REVERSI_SOURCE_PONDER 3
+#define REVERSI_SOURCE_MCTS 4
+
+#define REVERSI_MAX_PV 24
+#define REVERSI_EXACT 0
+#define REVERSI_UPPER 2
+
+/*
+ * Engine library. A context holds one game (position and side to move),
+ * its search settings, its own transposition table and MCTS tree, and its
+ * statistics. Every call on a context takes its lock, so a context may be
+ * shared between threads, and contexts on different threads search in
+ * parallel without touching each other's tables.
+ *
+ * Squares are bit indexes: in the notation of the printed board, 'a1' is
+ * 0, 'a2' is 1 and 'b1' is the board size. Functions return
+ * REVERSI_OK or a negative REVERSI_ERR_ code, never exit; reversi_error
+ * gives the details of the last failure of a context.
+ *
+ * The network, ProbCut parameters, solved database and result cache are
+ * read-only process-wide resources: load them before using contexts from
+ * several threads. Pondering runs one background thread for the process.
+ */
+typedef struct reversi reversi_t;
+
+typedef struct {
+	int engine;
+	int evaluator;
+	int depth;
+	int endgame_empties;
+	int playouts;
+	int threads;
+	uint64_t seed;
+	int tt_bits;
+	int clock_ms;
+} reversi_settings_t;
+
+/*
+ * depth is the deepest completed iteration, or the empties of a solve;
+ * stopped results are the best so far. planned is the predicted time of
+ * a search on a clock, 0 without one. MCTS results count playouts in
+ * nodes, and the tree in tree_nodes, of which tree_reused were kept from
+ * the search of the previous move.
+ */
+typedef struct {
+	int square;
+	int score;
+	int source;
+	int depth;
+	int stopped;
+	size_t nodes;
+	size_t tree_nodes;
+	size_t tree_reused;
+	double elapsed;
+	double planned;
+} reversi_result_t;
+
+/* a root move with its score, exact or an upper bound, and the line expected after it */
+typedef struct {
+	int square;
+	int score;
+	int bound;
+	int pv_length;
+	int pv[REVERSI_MAX_PV];
+} reversi_line_t;
+
+/* every root move, best first, after a completed depth; solved lines score the final disc difference */
+typedef struct {
+	int depth;
+	int solved;
+	int num_lines;
+	size_t nodes;
+	double elapsed;
+	reversi_line_t lines[REVERSI_MAX_SQUARES];
+} reversi_analysis_t;
+
+typedef void (*reversi_report_t) (const reversi_analysis_t *analysis, void *arg);
+
+typedef struct {
+	size_t searches;
+	size_t nodes;
+	size_t solved;
+	size_t ponder_hits;
+	size_t moves;
+	double elapsed;
+} reversi_stats_t;
+
+void reversi_default_settings(reversi_settings_t *settings);
+
+int reversi_new(reversi_t **ctx, int size, const reversi_settings_t *settings);
+
+void reversi_free(reversi_t *ctx);
+
+int reversi_configure(reversi_t *ctx, const reversi_settings_t *settings);
+
+int reversi_reset(reversi_t *ctx, int size);
+
+int reversi_load(reversi_t *ctx, const char *text, size_t length);
+
+int reversi_load_file(reversi_t *ctx, const char *filename);
+
+int reversi_write(reversi_t *ctx, FILE *f);
+
+void reversi_print(reversi_t *ctx);
+
+int reversi_position(reversi_t *ctx, uint64_t *black, uint64_t *white, char *player, int *size);
+
+int reversi_moves(reversi_t *ctx, int *squares, int max);
+
+int reversi_play(reversi_t *ctx, int square);
+
+int reversi_game_over(reversi_t *ctx);
+
+int reversi_score(reversi_t *ctx, int *black, int *white);
+
+/*
+ * The best move of the side to move. With a clock_ms setting, each side
+ * has that clock for the game, from reversi_new, reversi_reset, a load or
+ * a new clock_ms, and every search is charged to its side. The depth,
+ * MCTS time and when to solve are then planned from the clock and the
+ * process-wide schedule (include/schedule.h) instead of depth, playouts
+ * and endgame_empties; the first search on a clock calibrates the
+ * schedule, unless it was loaded or calibrated before.
+ */
+int reversi_search(reversi_t *ctx, reversi_result_t *result);
+
+int reversi_clock(reversi_t *ctx, double *black, double *white);
+
+/*
+ * Scores every legal move by iterative deepening up to depth (the
+ * context's depth if 0), or solves them at endgame_empties or fewer. The
+ * best `lines` moves (all if 0) get exact scores; the others may only get
+ * an upper bound, which is much cheaper. report, if given, gets the
+ * analysis after each depth, under the context's lock; result holds the
+ * deepest one. A stopped analysis keeps the last completed depth.
+ */
+int reversi_analyze(reversi_t *ctx, int depth, int lines, reversi_report_t report, void *arg,
+	reversi_analysis_t *result);
+
+int reversi_ponder(reversi_t *ctx, int on);
+
+/*
+ * Stops the running search of ctx, or its next one; safe from any thread
+ * and from a signal handler. A stopped search still answers a legal move.
+ */
+void reversi_stop(reversi_t *ctx);
+
+/* drops a stop that came after the last search returned; only while no search of ctx runs */
+void reversi_clear_stop(reversi_t *ctx);
+
+int reversi_stats(reversi_t *ctx, reversi_stats_t *stats);
+
+const char *reversi_error(reversi_t *ctx);
+
+const char *reversi_strerror(int code);
+
+int reversi_load_network(const char *filename);
+
+int reversi_load_probcut(const char *filename);
+
+int reversi_open_database(const char *filename);
+
+int reversi_open_cache(const char *filename);
+
+void reversi_close_cache(void);
+
+int reversi_load_schedule(const char *filename);
+
+int reversi_calibrate(double seconds);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "bitboard.h"
+
+#define MCTS_PLAYOUTS 20000
+#define MCTS_MEMORY 64
+#define MCTS_EXPLORATION 1.4
+#define MCTS_PASS 0xff
+#define MCTS_MAX_THREADS 64
+
+#define MCTS_EXPANDED 0x01
+#define MCTS_EXPANDING 0x02
+
+/*
+ * Tree nodes live in one of two arenas: children of a node are allocated
+ * together, as a contiguous block, and referenced by the index of the
+ * first one. Index 0 is never used, so 0 means "no children yet". When the
+ * tree is reused for the next move, the kept subtree is copied into the
+ * other arena and the old one is simply reset.
+ *
+ * With several threads, all of them descend the same tree. Statistics are
+ * updated with atomics and a visit is counted on the way down, so it acts
+ * as a virtual loss until the playout result is backed up. The thread that
+ * sets MCTS_EXPANDING on a leaf expands it; the others play out from the
+ * leaf instead of waiting. Child blocks are reserved with a CAS on used.
+ * In deterministic mode the threads are simulated in lockstep on the
+ * calling thread: each round descends, plays out and backs up every worker
+ * in order, so a given seed always builds the same tree.
+ */
+typedef struct {
+	uint32_t visits;
+	uint32_t wins;
+	uint32_t children;
+	uint8_t num_children;
+	uint8_t move;
+	uint8_t flags;
+	uint8_t pad;
+} mcts_node_t;
+
+typedef struct {
+	mcts_node_t *arena[2];
+	int current;
+	uint32_t used;
+	uint32_t capacity;
+	state_t root_state;
+	uint64_t rng;
+	int threads;
+	int deterministic;
+	size_t issued;
+	size_t playouts;
+	size_t reused;
+	double elapsed;
+} mcts_t;
+
+int mcts_init(mcts_t *tree, size_t megabytes, uint64_t seed);
+
+void mcts_free(mcts_t *tree);
+
+void mcts_set_threads(mcts_t *tree, int threads);
+
+void mcts_set_deterministic(mcts_t *tree, uint64_t seed);
+
+move_t mcts_search(mcts_t *tree, state_t state, int playouts);
+
+move_t mcts_player(state_t state);
+
+mcts_t *mcts_default(void);
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef NN_H
+#define NN_H
+
+#include "search.h"
+
+#define NN_VERSION 1
+#define NN_HEADER_SIZE 16
+#define NN_SQUARES 64
+#define NN_INPUTS (3 * NN_SQUARES)
+#define NN_HIDDEN1 64
+#define NN_HIDDEN2 32
+#define NN_SHIFT 6
+#define NN_ACTIVATION_MAX 127
+#define NN_VALUE_SCALE 16
+
+#define NN_SCALAR 0
+#define NN_AVX2 1
+
+/*
+ * Small evaluation network: own discs, opponent discs and the mobility of
+ * the side to move (three planes of one input per square), two hidden
+ * layers clipped to [0, 127] and a scalar output, the final disc difference
+ * in 1/NN_VALUE_SCALE discs. Weights and activations are fixed point with
+ * NN_SHIFT fraction bits: the first layer is int16, the others int8.
+ *
+ * The first layer is kept as one accumulator per color, the sum of the rows
+ * of its discs seen as own and of the other color's seen as opponent. A
+ * move adds one row to each and a flipped disc moves one row difference
+ * from one to the other, so search leaves only add the mobility rows of the
+ * side to move and run the two small layers.
+ *
+ * File: 16 byte header ("RVNN", version, board size, hidden sizes) then
+ * w1, b1, w2, b2, w3, b3 in the order below, all little-endian.
+ */
+typedef struct {
+	size_t size;
+	int16_t w1[NN_INPUTS][NN_HIDDEN1];
+	int16_t b1[NN_HIDDEN1];
+	int8_t w2[NN_HIDDEN2][NN_HIDDEN1];
+	int32_t b2[NN_HIDDEN2];
+	int8_t w3[NN_HIDDEN2];
+	int32_t b3;
+} nn_weights_t;
+
+/* first layer, indexed by color: 0 for black, 1 for white */
+typedef struct {
+	int16_t v[2][NN_HIDDEN1];
+} nn_acc_t;
+
+int nn_load(const char *filename);
+
+int nn_save(const char *filename, const nn_weights_t *weights);
+
+void nn_set(const nn_weights_t *weights);
+
+void nn_unload(void);
+
+int nn_ready(size_t size);
+
+void nn_refresh(nn_acc_t *acc, uint64_t black, uint64_t white);
+
+void nn_update(nn_acc_t *acc, const nn_acc_t *from, int color, int square, uint64_t flips);
+
+int nn_output(const nn_acc_t *acc, int color, uint64_t mobility);
+
+int nn_eval(uint64_t own, uint64_t opp, size_t size);
+
+int nn_heuristic(state_t state);
+
+void nn_search_start(const search_t *s);
+
+int nn_search_eval(const search_t *s);
+
+int nn_isa(void);
+
+int nn_set_isa(int isa);
+
+#endif
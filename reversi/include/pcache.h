@@ -0,0 +1,56 @@
+#ifndef PCACHE_H
+#define PCACHE_H
+
+#include "tt.h"
+
+#define PCACHE_VERSION 1
+#define PCACHE_HEADER_SIZE 64
+#define PCACHE_SLOT_SIZE 32
+#define PCACHE_MIN_EMPTIES 6
+#define PCACHE_OVERLAY_BITS 16
+#define PCACHE_BATCH 64
+
+/*
+ * Persistent result cache. A cache is two files:
+ *  - NAME: open-addressing hash table of canonical positions, written only
+ *    by pcache_compact() (new file, fsync, rename) and mapped read-only, so
+ *    any number of processes can read it while another one compacts.
+ *  - NAME.log: append-only journal of new results, written PCACHE_BATCH
+ *    records at a time and on every refresh. Each 32 byte record is
+ *    checksummed, so a record torn by a crash is skipped on load.
+ * depth is the number of plies searched; depth >= empties means solved.
+ */
+
+typedef struct {
+	int lower;
+	int upper;
+	int depth;
+	move_t move;
+} pcache_entry_t;
+
+typedef struct {
+	size_t slots;
+	size_t used;
+	size_t journal;
+	size_t hits;
+	size_t probes;
+} pcache_stats_t;
+
+int pcache_open(const char *filename);
+
+void pcache_close(void);
+
+void pcache_refresh(void);
+
+/* while on, the calling thread neither reads nor writes the cache */
+void pcache_bypass(int on);
+
+int pcache_probe(state_t state, pcache_entry_t *entry);
+
+void pcache_store(state_t state, int depth, int lower, int upper, move_t move);
+
+pcache_stats_t pcache_stats(void);
+
+int pcache_compact(const char *filename, char **inputs, int num_inputs);
+
+#endif
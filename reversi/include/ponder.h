@@ -0,0 +1,22 @@
+#ifndef PONDER_H
+#define PONDER_H
+
+#include "tt.h"
+
+#define PONDER_MAX_DEPTH 10
+
+typedef struct {
+	size_t hits;
+	size_t misses;
+	int depth;
+} ponder_stats_t;
+
+void ponder_start(state_t state, int (*heuristic) (state_t state), tt_table_t *tt);
+
+void ponder_stop(void);
+
+int ponder_lookup(state_t state, int depth, int (*heuristic) (state_t state), move_t *move);
+
+ponder_stats_t ponder_stats(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef PROBCUT_H
+#define PROBCUT_H
+
+#include "bitboard.h"
+
+#define PROBCUT_PHASES 4
+#define PROBCUT_MIN_DEPTH 3
+#define PROBCUT_MAX_DEPTH 12
+#define PROBCUT_CHECKS 2
+#define PROBCUT_CONFIDENCE 1.5
+
+/*
+ * Multi-ProbCut. For a deep search of depth d, the value v of a shallow
+ * search of depth probcut_shallow(d, k) predicts it as a * v + b, with a
+ * residual standard deviation sigma; one set of parameters per game phase.
+ * A node of depth d is cut when the prediction is outside the window by
+ * more than confidence * sigma. Parameters are fitted by 'rvprobcut fit'.
+ */
+typedef struct {
+	double a;
+	double b;
+	double sigma;
+} probcut_param_t;
+
+typedef struct {
+	int enabled;
+	double confidence[PROBCUT_CHECKS];
+	probcut_param_t params[PROBCUT_PHASES][PROBCUT_MAX_DEPTH + 1][PROBCUT_CHECKS];
+} probcut_t;
+
+int probcut_shallow(int depth, int check);
+
+int probcut_phase(uint64_t occupied, size_t size);
+
+int probcut_load(const char *filename);
+
+int probcut_save(const char *filename, const probcut_t *probcut);
+
+void probcut_enable(int enabled);
+
+void probcut_set_confidence(double confidence);
+
+const probcut_t *probcut_active(void);
+
+#endif
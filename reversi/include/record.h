@@ -0,0 +1,75 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "bitboard.h"
+
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 16
+#define RECORD_POSITION_SIZE 18
+#define RECORD_GAME_HEADER_SIZE 4
+#define RECORD_MAX_MOVES 128
+
+#define GAME_CUSTOM_START 0x01
+
+/*
+ * Positions file: 16 byte header ("RVPS", version, record count) followed
+ * by fixed 18 byte records (black mask, white mask, player, size), all
+ * little-endian, so record i lives at 16 + 18 * i.
+ *
+ * Games file: 16 byte header ("RVGM", version, index offset) followed by
+ * the games. A game is a 4 byte header (size, number of moves, final disc
+ * difference black - white, flags), the start position when it is not the
+ * standard one, and one byte per move (bit index, passes are implied).
+ * On close the writer appends an index (count, then one offset per game).
+ */
+
+typedef struct {
+	uint8_t size;
+	uint8_t num_moves;
+	int8_t score;
+	uint8_t flags;
+	state_t start;
+	uint8_t moves[RECORD_MAX_MOVES];
+} game_t;
+
+typedef struct {
+	FILE *f;
+	int writing;
+	int games;
+	uint64_t count;
+	uint64_t next;
+	uint64_t *offsets;
+	size_t capacity;
+} record_file_t;
+
+void pos_encode(state_t state, uint8_t *buffer);
+
+state_t pos_decode(const uint8_t *buffer);
+
+int pos_writer_open(record_file_t *rf, const char *filename);
+
+int pos_write(record_file_t *rf, state_t state);
+
+int pos_reader_open(record_file_t *rf, const char *filename);
+
+int pos_read(record_file_t *rf, state_t *state);
+
+int pos_seek(record_file_t *rf, uint64_t index);
+
+int game_writer_open(record_file_t *rf, const char *filename);
+
+int game_write(record_file_t *rf, const game_t *game);
+
+int game_reader_open(record_file_t *rf, const char *filename);
+
+int game_read(record_file_t *rf, game_t *game);
+
+int game_seek(record_file_t *rf, uint64_t index);
+
+int record_close(record_file_t *rf);
+
+void game_new(game_t *game, size_t size);
+
+int game_replay(const game_t *game, state_t *states);
+
+#endif
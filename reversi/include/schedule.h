@@ -0,0 +1,61 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include "probcut.h"
+
+#define SCHEDULE_PHASES PROBCUT_PHASES
+#define SCHEDULE_MAX_DEPTH 30
+#define SCHEDULE_SOLVE_SHARE 0.5
+#define SCHEDULE_RESERVE 0.05
+#define SCHEDULE_HARD_LIMIT 3.0
+#define SCHEDULE_CALIBRATION 1.0
+
+/*
+ * Time schedule of a game on a clock. Iterative deepening to depth d from a
+ * root with m moves in phase p (as in probcut_phase) costs about
+ * m * base[p] * ebf[p]^(i - 1) nodes for iteration i, and solving a
+ * position with e empties about m * solve_base * solve_ebf^(e - 1) nodes,
+ * at nps and solve_nps nodes per second. The parameters depend on the
+ * machine and the evaluation, so they are measured by schedule_calibrate(),
+ * at startup or once with 'rvschedule calibrate'.
+ *
+ * Each move plans when to solve: at the most empties whose predicted solve
+ * fits in SCHEDULE_SOLVE_SHARE of the clock. Until then, the rest of the
+ * clock is shared evenly by the moves left before the solve, and the move
+ * searches the deepest depth predicted within its share. Positions with
+ * few moves are cheap, so they are searched deeper for the same time. A
+ * move is stopped after SCHEDULE_HARD_LIMIT times its share at most, and
+ * SCHEDULE_RESERVE of the clock is never planned.
+ */
+typedef struct {
+	double nps;
+	double base[SCHEDULE_PHASES];
+	double ebf[SCHEDULE_PHASES];
+	double solve_nps;
+	double solve_base;
+	double solve_ebf;
+} schedule_t;
+
+typedef struct {
+	int solve;
+	int depth;
+	int solve_empties;
+	double budget;
+	double limit;
+} schedule_plan_t;
+
+void schedule_default(schedule_t *schedule);
+
+int schedule_calibrate(schedule_t *schedule, double seconds, int (*heuristic) (state_t state));
+
+int schedule_load(const char *filename, schedule_t *schedule);
+
+int schedule_save(const char *filename, const schedule_t *schedule);
+
+double schedule_search_time(const schedule_t *schedule, state_t state, int depth);
+
+double schedule_solve_time(const schedule_t *schedule, state_t state, int empties);
+
+void schedule_plan(const schedule_t *schedule, state_t state, double clock, int max_depth, schedule_plan_t *plan);
+
+#endif
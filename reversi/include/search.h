@@ -0,0 +1,109 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "tt.h"
+
+#define SEARCH_MAX_PLY 128
+#define SEARCH_PASS -1
+
+/*
+ * Search core shared by every tree search. The position is kept from the
+ * point of view of the side to move and is changed in place: a move xors
+ * its flip mask (and the new disc) into both bitboards and swaps them, and
+ * undoing it xors the same mask back. The ply stack only holds that mask
+ * and the square, 16 bytes per ply. A search_t belongs to one thread.
+ */
+typedef struct {
+	uint64_t flips;
+	int square;
+} ply_t;
+
+typedef struct {
+	uint64_t own;
+	uint64_t opp;
+	char player;
+	int ply;
+	size_t size;
+	size_t nodes;
+	int (*heuristic) (state_t state);
+	ply_t stack[SEARCH_MAX_PLY];
+} search_t;
+
+static inline void search_init(search_t *s, state_t state) {
+	s->own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	s->opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	s->player = state.player;
+	s->size = state.board.size;
+	s->ply = 0;
+	s->nodes = 0;
+	s->heuristic = NULL;
+}
+
+static inline uint64_t search_moves(const search_t *s) {
+	return bb_mobility(s->own, s->opp, s->size);
+}
+
+static inline void search_swap(search_t *s) {
+	uint64_t tmp = s->own;
+	s->own = s->opp;
+	s->opp = tmp;
+	s->player = (s->player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+}
+
+static inline void search_play(search_t *s, int square) {
+	ply_t *p = &s->stack[s->ply++];
+	p->square = square;
+	p->flips = 0;
+	if (square != SEARCH_PASS) {
+		p->flips = bb_flips(s->own, s->opp, square, s->size);
+		s->own ^= p->flips | (uint64_t) 1 << square;
+		s->opp ^= p->flips;
+	}
+	search_swap(s);
+	s->nodes++;
+}
+
+static inline void search_undo(search_t *s) {
+	ply_t *p = &s->stack[--s->ply];
+	search_swap(s);
+	if (p->square != SEARCH_PASS) {
+		s->own ^= p->flips | (uint64_t) 1 << p->square;
+		s->opp ^= p->flips;
+	}
+}
+
+static inline int search_empties(const search_t *s) {
+	return s->size * s->size - __builtin_popcountll(s->own | s->opp);
+}
+
+/* final disc difference for the side to move */
+static inline int search_disc_diff(const search_t *s) {
+	return __builtin_popcountll(s->own) - __builtin_popcountll(s->opp);
+}
+
+static inline state_t search_state(const search_t *s) {
+	state_t state;
+	state.player = s->player;
+	state.board.size = s->size;
+	state.board.black = (s->player == BLACK_STONE) ? s->own : s->opp;
+	state.board.white = (s->player == BLACK_STONE) ? s->opp : s->own;
+	return state;
+}
+
+static inline uint64_t search_key(const search_t *s) {
+	return tt_key((s->player == BLACK_STONE) ? s->own : s->opp,
+		(s->player == BLACK_STONE) ? s->opp : s->own, s->size, s->player);
+}
+
+static inline move_t search_move(const search_t *s, int square) {
+	move_t move;
+	if (square == SEARCH_PASS) {
+		move.row = move.column = -1;
+	} else {
+		move.row = square % s->size;
+		move.column = square / s->size;
+	}
+	return move;
+}
+
+#endif
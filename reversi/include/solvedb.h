@@ -0,0 +1,39 @@
+#ifndef SOLVEDB_H
+#define SOLVEDB_H
+
+#include "bitboard.h"
+
+#define SOLVEDB_VERSION 1
+#define SOLVEDB_HEADER_SIZE 64
+#define SOLVEDB_MAX_SIZE 6
+#define SOLVEDB_VALUE_BITS 7
+#define SOLVEDB_VALUE_BIAS 64
+
+/*
+ * Perfect-play database for small boards. A position is seen from the
+ * side to move and reduced to the smallest of its 8 symmetric keys: the 4
+ * center squares, never empty, take one bit each and the others one base 3
+ * digit, so 6x6 keys fit in 55 bits. Each record is the key shifted left
+ * by SOLVEDB_VALUE_BITS plus the biased final disc difference under
+ * perfect play, 8 bytes little endian. The file is a 64 byte header
+ * followed by the records in increasing order; it is mapped read-only and
+ * looked up by binary search.
+ */
+
+uint64_t solvedb_key(uint64_t own, uint64_t opp, size_t size);
+
+void solvedb_decode(uint64_t key, size_t size, uint64_t *own, uint64_t *opp);
+
+int solvedb_write(const char *filename, size_t size, const uint64_t *records, size_t count);
+
+int solvedb_open(const char *filename);
+
+void solvedb_close(void);
+
+size_t solvedb_count(void);
+
+int solvedb_probe(uint64_t own, uint64_t opp, size_t size, int *value);
+
+int solvedb_move(state_t state, move_t *move, int *value);
+
+#endif
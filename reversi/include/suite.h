@@ -0,0 +1,60 @@
+#ifndef SUITE_H
+#define SUITE_H
+
+#include "board_io.h"
+
+#define SUITE_MAX_BEST 4
+#define SUITE_DEPTH_SOLVE 0
+
+#define SUITE_PASS 0
+#define SUITE_WRONG_MOVE 1
+#define SUITE_WRONG_SCORE 2
+#define SUITE_TIMEOUT 3
+
+/*
+ * Test positions with expected answers, in the board text format: the
+ * published ones of suites/ffo.txt, or the engine's own as a regression
+ * baseline in suites/endgame.txt and midgame.txt. Each board follows a
+ * header comment:
+ *
+ *   # NAME solve MOVES SCORE      <- exact final disc difference
+ *   # NAME depth D MOVES SCORE    <- negamax_alphabeta with the stability
+ *                                    heuristic at depth D
+ *
+ * MOVES are the best moves, comma separated ("a1" is bit 0, "b1" bit 1),
+ * and SCORE is for the side to move.
+ */
+typedef struct {
+	char name[32];
+	state_t state;
+	int depth;
+	int best[SUITE_MAX_BEST];
+	int num_best;
+	int score;
+} suite_position_t;
+
+typedef struct {
+	suite_position_t *positions;
+	int count;
+	char error[128];
+} suite_t;
+
+typedef struct {
+	int move;
+	int score;
+	int status;
+	size_t nodes;
+	double elapsed;
+} suite_result_t;
+
+int suite_load(const char *filename, suite_t *suite);
+
+void suite_free(suite_t *suite);
+
+int suite_run(const suite_position_t *position, double limit, suite_result_t *result);
+
+int suite_square(const char *name, size_t size);
+
+void suite_square_name(int square, size_t size, char name[BOARD_SQUARE_NAME]);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef TT_H
+#define TT_H
+
+#include "bitboard.h"
+
+#define TT_DEFAULT_BITS 20
+
+#define TT_EXACT 0
+#define TT_LOWER 1
+#define TT_UPPER 2
+
+typedef struct {
+	int value;
+	int depth;
+	int flag;
+	move_t move;
+} tt_entry_t;
+
+typedef struct {
+	uint64_t check;
+	uint64_t data;
+} tt_slot_t;
+
+typedef struct {
+	tt_slot_t *slots;
+	uint64_t mask;
+} tt_table_t;
+
+uint64_t tt_key(uint64_t black, uint64_t white, size_t size, char player);
+
+uint64_t bb_hash(bitboard_t board, char player);
+
+uint64_t bb_canonical_hash(bitboard_t board, char player, int *sym);
+
+int tt_table_init(tt_table_t *t, int bits);
+
+void tt_table_free(tt_table_t *t);
+
+/* the table of this thread's searches, NULL for the shared one */
+void tt_use(tt_table_t *t);
+
+int tt_init(int bits);
+
+void tt_free(void);
+
+void tt_clear(void);
+
+int tt_probe(uint64_t key, tt_entry_t *entry);
+
+void tt_store(uint64_t key, int depth, int value, int flag, move_t move);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+/* seconds on the monotonic clock */
+static inline double util_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* the files of the engine store integers little-endian, whatever the machine */
+static inline void util_put(uint8_t *p, uint64_t v, int bytes) {
+	int i;
+	for (i = 0; i < bytes; i++)
+		p[i] = (v >> (8 * i)) & 0xff;
+}
+
+static inline uint64_t util_get(const uint8_t *p, int bytes) {
+	uint64_t v = 0;
+	int i;
+	for (i = bytes - 1; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static inline void util_put64(uint8_t *p, uint64_t v) {
+	util_put(p, v, 8);
+}
+
+static inline uint64_t util_get64(const uint8_t *p) {
+	return util_get(p, 8);
+}
+
+/* raises *stop after a time unless stopped before */
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	struct timespec deadline;
+	int done;
+	int fired;
+	int *stop;
+	pthread_t thread;
+} watchdog_t;
+
+int watchdog_start(watchdog_t *w, double seconds, int *stop);
+
+/* returns 1 when the watchdog raised the flag */
+int watchdog_stop(watchdog_t *w);
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef WIDE_H
+#define WIDE_H
+
+#include "bitboard.h"
+
+#define WIDE_MAX_SIZE 16
+#define WIDE_WORDS 4
+#define WIDE_SEARCH_DEPTH 4
+#define WIDE_PASS -1
+
+/*
+ * Bitboards for boards larger than 8x8: WIDE_WORDS 64-bit words, least
+ * significant word first, with the same square numbering as bitboard_t
+ * (row * size + column). Shifts carry bits across words, so move
+ * generation is the 8x8 code with wide operations. Perft and the search
+ * are written once over the board type and instantiated for both; sizes
+ * up to 8 always run on single words.
+ */
+typedef struct {
+	uint64_t w[WIDE_WORDS];
+} wide_t;
+
+typedef struct {
+	size_t size;
+	wide_t black;
+	wide_t white;
+} wide_board_t;
+
+typedef struct {
+	char player;
+	wide_board_t board;
+} wide_state_t;
+
+static inline wide_t wide_zero(void) {
+	wide_t x;
+	memset(&x, 0, sizeof(x));
+	return x;
+}
+
+static inline wide_t wide_bit(int pos) {
+	wide_t x = wide_zero();
+	x.w[pos >> 6] = (uint64_t) 1 << (pos & 63);
+	return x;
+}
+
+static inline int wide_test(wide_t x, int pos) {
+	return (x.w[pos >> 6] >> (pos & 63)) & 1;
+}
+
+static inline wide_t wide_or(wide_t a, wide_t b) {
+	int i;
+	for (i = 0; i < WIDE_WORDS; i++)
+		a.w[i] |= b.w[i];
+	return a;
+}
+
+static inline wide_t wide_and(wide_t a, wide_t b) {
+	int i;
+	for (i = 0; i < WIDE_WORDS; i++)
+		a.w[i] &= b.w[i];
+	return a;
+}
+
+static inline wide_t wide_andnot(wide_t a, wide_t b) {
+	int i;
+	for (i = 0; i < WIDE_WORDS; i++)
+		a.w[i] &= ~b.w[i];
+	return a;
+}
+
+static inline wide_t wide_xor(wide_t a, wide_t b) {
+	int i;
+	for (i = 0; i < WIDE_WORDS; i++)
+		a.w[i] ^= b.w[i];
+	return a;
+}
+
+static inline int wide_is_zero(wide_t x) {
+	uint64_t any = 0;
+	int i;
+	for (i = 0; i < WIDE_WORDS; i++)
+		any |= x.w[i];
+	return any == 0;
+}
+
+static inline int wide_popcount(wide_t x) {
+	int i, n = 0;
+	for (i = 0; i < WIDE_WORDS; i++)
+		n += __builtin_popcountll(x.w[i]);
+	return n;
+}
+
+/* index of the lowest set bit, x must not be zero */
+static inline int wide_first(wide_t x) {
+	int i = 0;
+	while (x.w[i] == 0)
+		i++;
+	return 64 * i + __builtin_ctzll(x.w[i]);
+}
+
+static inline wide_t wide_clear_first(wide_t x) {
+	int i = 0;
+	while (x.w[i] == 0)
+		i++;
+	x.w[i] &= x.w[i] - 1;
+	return x;
+}
+
+/* shifts by 0 < n < 64 */
+static inline wide_t wide_shl(wide_t x, int n) {
+	int i;
+	for (i = WIDE_WORDS - 1; i > 0; i--)
+		x.w[i] = x.w[i] << n | x.w[i - 1] >> (64 - n);
+	x.w[0] <<= n;
+	return x;
+}
+
+static inline wide_t wide_shr(wide_t x, int n) {
+	int i;
+	for (i = 0; i < WIDE_WORDS - 1; i++)
+		x.w[i] = x.w[i] >> n | x.w[i + 1] << (64 - n);
+	x.w[WIDE_WORDS - 1] >>= n;
+	return x;
+}
+
+wide_board_t wide_init(size_t size);
+
+void wide_print(wide_board_t board);
+
+wide_t wide_mobility(wide_t own, wide_t opp, size_t size);
+
+wide_t wide_flips(wide_t own, wide_t opp, int pos, size_t size);
+
+wide_t wide_moves(wide_state_t state);
+
+int wide_play(wide_state_t *state, int pos);
+
+uint64_t wide_perft(wide_state_t state, int depth);
+
+uint64_t wide_perft_words(wide_state_t state, int depth);
+
+int wide_search(wide_state_t state, int depth, int *value, size_t *nodes);
+
+#endif
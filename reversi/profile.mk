@@ -0,0 +1,34 @@
+# Build profiles, shared by src/, bench/ and tools/:
+#
+#   debug    no optimization (default)
+#   release  -O3 without asserts, NATIVE=1 adds -march=native
+#   lto      release with link-time optimization
+#   pgo-gen  release instrumented to write a profile (*.gcda) when run
+#   pgo-use  release optimized with that profile
+#
+# Objects depend on a stamp named after the profile, so switching profiles
+# rebuilds them. The profile data is kept until profile-clean.
+
+PROFILE ?= debug
+
+.DEFAULT_GOAL := all
+
+CFLAGS=-std=c99 -Wall -Wextra -g -pthread
+RELEASE=-O3 -DNDEBUG $(if $(NATIVE),-march=native)
+STAMP=.profile-$(PROFILE)$(if $(NATIVE),-native)
+
+ifeq ($(PROFILE),release)
+CFLAGS+=$(RELEASE)
+else ifeq ($(PROFILE),lto)
+CFLAGS+=$(RELEASE) -flto=auto
+else ifeq ($(PROFILE),pgo-gen)
+CFLAGS+=$(RELEASE) -fprofile-generate -fprofile-update=atomic
+else ifeq ($(PROFILE),pgo-use)
+CFLAGS+=$(RELEASE) -fprofile-use -fprofile-correction -Wno-missing-profile
+else ifneq ($(PROFILE),debug)
+$(error unknown PROFILE '$(PROFILE)': use debug, release, lto, pgo-gen or pgo-use)
+endif
+
+$(STAMP):
+	@rm -f .profile-*
+	@touch $@
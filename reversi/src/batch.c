@@ -0,0 +1,435 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/batch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86 1
+#endif
+
+static int isa = -1;
+
+static int best_isa(void) {
+#ifdef BATCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		return BATCH_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return BATCH_AVX2;
+#endif
+	return BATCH_SCALAR;
+}
+
+int batch_isa(void) {
+	int current = __atomic_load_n(&isa, __ATOMIC_RELAXED);
+	if (current < 0) {
+		current = best_isa();
+		__atomic_store_n(&isa, current, __ATOMIC_RELAXED);
+	}
+	return current;
+}
+
+int batch_set_isa(int wanted) {
+	int best = best_isa();
+	__atomic_store_n(&isa, wanted < best ? wanted : best, __ATOMIC_RELAXED);
+	return batch_isa();
+}
+
+int batch_init(batch_t *batch, size_t size, size_t capacity) {
+	void *own, *opp;
+
+	if (posix_memalign(&own, 64, capacity * sizeof(uint64_t)) != 0) {
+		return -1;
+	}
+	if (posix_memalign(&opp, 64, capacity * sizeof(uint64_t)) != 0) {
+		free(own);
+		return -1;
+	}
+	batch->size = size;
+	batch->count = 0;
+	batch->capacity = capacity;
+	batch->own = own;
+	batch->opp = opp;
+	return 0;
+}
+
+void batch_free(batch_t *batch) {
+	free(batch->own);
+	free(batch->opp);
+	batch->own = batch->opp = NULL;
+	batch->count = batch->capacity = 0;
+}
+
+int batch_add(batch_t *batch, state_t state) {
+	if (batch->count == batch->capacity || state.board.size != batch->size) {
+		return -1;
+	}
+	batch->own[batch->count] = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	batch->opp[batch->count] = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	return batch->count++;
+}
+
+static int parity(int own, int opp) {
+	if (own + opp == 0) {
+		return 0;
+	}
+	return 100 * (float) (own - opp) / (float) (own + opp);
+}
+
+static void scalar_mobility(const batch_t *batch, size_t from, uint64_t *moves) {
+	size_t i;
+	for (i = from; i < batch->count; i++) {
+		moves[i] = bb_mobility(batch->own[i], batch->opp[i], batch->size);
+	}
+}
+
+static void scalar_flips(const batch_t *batch, size_t from, const uint8_t *squares, uint64_t *flips) {
+	size_t i;
+	for (i = from; i < batch->count; i++) {
+		flips[i] = bb_flips(batch->own[i], batch->opp[i], squares[i], batch->size);
+	}
+}
+
+static void scalar_count(const batch_t *batch, size_t from, int *own, int *opp) {
+	size_t i;
+	for (i = from; i < batch->count; i++) {
+		own[i] = __builtin_popcountll(batch->own[i]);
+		opp[i] = __builtin_popcountll(batch->opp[i]);
+	}
+}
+
+static void scalar_eval(const batch_t *batch, size_t from, int *values) {
+	size_t i;
+	for (i = from; i < batch->count; i++) {
+		values[i] = parity(__builtin_popcountll(batch->own[i]), __builtin_popcountll(batch->opp[i]));
+	}
+}
+
+#ifdef BATCH_X86
+
+/* full board, not left column, not right column, and the shift counts */
+typedef struct {
+	__m256i full, left, right, nibble, lut;
+	__m128i one, n, n_minus, n_plus;
+} masks4_t;
+
+__attribute__((target("avx2")))
+static void masks4_init(masks4_t *m, size_t size) {
+	const uint64_t *masks = bb_size_masks(size);
+	m->full = _mm256_set1_epi64x(masks[0]);
+	m->left = _mm256_set1_epi64x(masks[1]);
+	m->right = _mm256_set1_epi64x(masks[2]);
+	m->nibble = _mm256_set1_epi8(0x0f);
+	m->lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	m->one = _mm_cvtsi32_si128(1);
+	m->n = _mm_cvtsi32_si128(size);
+	m->n_minus = _mm_cvtsi32_si128(size - 1);
+	m->n_plus = _mm_cvtsi32_si128(size + 1);
+}
+
+/* same directions as shift() in bitboard.c */
+__attribute__((target("avx2")))
+static inline __m256i shift4(__m256i x, int dir, const masks4_t *m) {
+	switch (dir) {
+	case 0:
+		return _mm256_sll_epi64(_mm256_and_si256(x, m->right), m->one);
+	case 1:
+		return _mm256_srl_epi64(_mm256_and_si256(x, m->left), m->one);
+	case 2:
+		return _mm256_and_si256(_mm256_sll_epi64(x, m->n), m->full);
+	case 3:
+		return _mm256_srl_epi64(x, m->n);
+	case 4:
+		return _mm256_and_si256(_mm256_sll_epi64(_mm256_and_si256(x, m->right), m->n_plus), m->full);
+	case 5:
+		return _mm256_and_si256(_mm256_sll_epi64(_mm256_and_si256(x, m->left), m->n_minus), m->full);
+	case 6:
+		return _mm256_srl_epi64(_mm256_and_si256(x, m->right), m->n_minus);
+	default:
+		return _mm256_srl_epi64(_mm256_and_si256(x, m->left), m->n_plus);
+	}
+}
+
+__attribute__((target("avx2")))
+static inline __m256i popcount4(__m256i x, const masks4_t *m) {
+	__m256i lo = _mm256_shuffle_epi8(m->lut, _mm256_and_si256(x, m->nibble));
+	__m256i hi = _mm256_shuffle_epi8(m->lut, _mm256_and_si256(_mm256_srli_epi64(x, 4), m->nibble));
+	return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+/* low 32 bits of each 64 bit lane */
+__attribute__((target("avx2")))
+static inline __m128i narrow4(__m256i x) {
+	return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_mobility(const batch_t *batch, uint64_t *moves) {
+	masks4_t m;
+	__m256i own, opp, empty, t, res;
+	size_t i;
+	int dir, k, size = batch->size;
+
+	masks4_init(&m, batch->size);
+	for (i = 0; i + 4 <= batch->count; i += 4) {
+		own = _mm256_load_si256((const __m256i *) &batch->own[i]);
+		opp = _mm256_load_si256((const __m256i *) &batch->opp[i]);
+		empty = _mm256_andnot_si256(_mm256_or_si256(own, opp), m.full);
+		res = _mm256_setzero_si256();
+		for (dir = 0; dir < 8; dir++) {
+			t = _mm256_and_si256(shift4(own, dir, &m), opp);
+			for (k = 3; k < size; k++) {
+				t = _mm256_or_si256(t, _mm256_and_si256(shift4(t, dir, &m), opp));
+			}
+			res = _mm256_or_si256(res, _mm256_and_si256(shift4(t, dir, &m), empty));
+		}
+		_mm256_storeu_si256((__m256i *) &moves[i], res);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_flips(const batch_t *batch, const uint8_t *squares, uint64_t *flips) {
+	masks4_t m;
+	__m256i own, opp, bit, f, capture, res;
+	int32_t packed;
+	size_t i;
+	int dir, k, size = batch->size;
+
+	masks4_init(&m, batch->size);
+	for (i = 0; i + 4 <= batch->count; i += 4) {
+		own = _mm256_load_si256((const __m256i *) &batch->own[i]);
+		opp = _mm256_load_si256((const __m256i *) &batch->opp[i]);
+		memcpy(&packed, &squares[i], sizeof(packed));
+		bit = _mm256_sllv_epi64(_mm256_set1_epi64x(1), _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed)));
+		res = _mm256_setzero_si256();
+		for (dir = 0; dir < 8; dir++) {
+			f = _mm256_and_si256(shift4(bit, dir, &m), opp);
+			for (k = 3; k < size; k++) {
+				f = _mm256_or_si256(f, _mm256_and_si256(shift4(f, dir, &m), opp));
+			}
+			capture = _mm256_and_si256(shift4(f, dir, &m), own);
+			capture = _mm256_cmpeq_epi64(capture, _mm256_setzero_si256());
+			res = _mm256_or_si256(res, _mm256_andnot_si256(capture, f));
+		}
+		_mm256_storeu_si256((__m256i *) &flips[i], res);
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_count(const batch_t *batch, int *own, int *opp) {
+	masks4_t m;
+	size_t i;
+
+	masks4_init(&m, batch->size);
+	for (i = 0; i + 4 <= batch->count; i += 4) {
+		_mm_storeu_si128((__m128i *) &own[i],
+			narrow4(popcount4(_mm256_load_si256((const __m256i *) &batch->own[i]), &m)));
+		_mm_storeu_si128((__m128i *) &opp[i],
+			narrow4(popcount4(_mm256_load_si256((const __m256i *) &batch->opp[i]), &m)));
+	}
+	return i;
+}
+
+__attribute__((target("avx2")))
+static size_t avx2_eval(const batch_t *batch, int *values) {
+	masks4_t m;
+	__m128i own, opp, sum, res;
+	__m128 q;
+	size_t i;
+
+	masks4_init(&m, batch->size);
+	for (i = 0; i + 4 <= batch->count; i += 4) {
+		own = narrow4(popcount4(_mm256_load_si256((const __m256i *) &batch->own[i]), &m));
+		opp = narrow4(popcount4(_mm256_load_si256((const __m256i *) &batch->opp[i]), &m));
+		sum = _mm_add_epi32(own, opp);
+		q = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(100), _mm_cvtepi32_ps(_mm_sub_epi32(own, opp))),
+			_mm_cvtepi32_ps(sum));
+		res = _mm_andnot_si128(_mm_cmpeq_epi32(sum, _mm_setzero_si128()), _mm_cvttps_epi32(q));
+		_mm_storeu_si128((__m128i *) &values[i], res);
+	}
+	return i;
+}
+
+typedef struct {
+	__m512i full, left, right, nibble, lut;
+	__m128i one, n, n_minus, n_plus;
+} masks8_t;
+
+__attribute__((target("avx512f,avx512bw")))
+static void masks8_init(masks8_t *m, size_t size) {
+	const uint64_t *masks = bb_size_masks(size);
+	m->full = _mm512_set1_epi64(masks[0]);
+	m->left = _mm512_set1_epi64(masks[1]);
+	m->right = _mm512_set1_epi64(masks[2]);
+	m->nibble = _mm512_set1_epi8(0x0f);
+	m->lut = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+	m->one = _mm_cvtsi32_si128(1);
+	m->n = _mm_cvtsi32_si128(size);
+	m->n_minus = _mm_cvtsi32_si128(size - 1);
+	m->n_plus = _mm_cvtsi32_si128(size + 1);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i shift8(__m512i x, int dir, const masks8_t *m) {
+	switch (dir) {
+	case 0:
+		return _mm512_sll_epi64(_mm512_and_si512(x, m->right), m->one);
+	case 1:
+		return _mm512_srl_epi64(_mm512_and_si512(x, m->left), m->one);
+	case 2:
+		return _mm512_and_si512(_mm512_sll_epi64(x, m->n), m->full);
+	case 3:
+		return _mm512_srl_epi64(x, m->n);
+	case 4:
+		return _mm512_and_si512(_mm512_sll_epi64(_mm512_and_si512(x, m->right), m->n_plus), m->full);
+	case 5:
+		return _mm512_and_si512(_mm512_sll_epi64(_mm512_and_si512(x, m->left), m->n_minus), m->full);
+	case 6:
+		return _mm512_srl_epi64(_mm512_and_si512(x, m->right), m->n_minus);
+	default:
+		return _mm512_srl_epi64(_mm512_and_si512(x, m->left), m->n_plus);
+	}
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i popcount8(__m512i x, const masks8_t *m) {
+	__m512i lo = _mm512_shuffle_epi8(m->lut, _mm512_and_si512(x, m->nibble));
+	__m512i hi = _mm512_shuffle_epi8(m->lut, _mm512_and_si512(_mm512_srli_epi64(x, 4), m->nibble));
+	return _mm512_sad_epu8(_mm512_add_epi8(lo, hi), _mm512_setzero_si512());
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t avx512_mobility(const batch_t *batch, uint64_t *moves) {
+	masks8_t m;
+	__m512i own, opp, empty, t, res;
+	size_t i;
+	int dir, k, size = batch->size;
+
+	masks8_init(&m, batch->size);
+	for (i = 0; i + 8 <= batch->count; i += 8) {
+		own = _mm512_load_si512(&batch->own[i]);
+		opp = _mm512_load_si512(&batch->opp[i]);
+		empty = _mm512_andnot_si512(_mm512_or_si512(own, opp), m.full);
+		res = _mm512_setzero_si512();
+		for (dir = 0; dir < 8; dir++) {
+			t = _mm512_and_si512(shift8(own, dir, &m), opp);
+			for (k = 3; k < size; k++) {
+				t = _mm512_or_si512(t, _mm512_and_si512(shift8(t, dir, &m), opp));
+			}
+			res = _mm512_or_si512(res, _mm512_and_si512(shift8(t, dir, &m), empty));
+		}
+		_mm512_storeu_si512(&moves[i], res);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t avx512_flips(const batch_t *batch, const uint8_t *squares, uint64_t *flips) {
+	masks8_t m;
+	__m512i own, opp, bit, f, res;
+	__mmask8 capture;
+	size_t i;
+	int dir, k, size = batch->size;
+
+	masks8_init(&m, batch->size);
+	for (i = 0; i + 8 <= batch->count; i += 8) {
+		own = _mm512_load_si512(&batch->own[i]);
+		opp = _mm512_load_si512(&batch->opp[i]);
+		bit = _mm512_sllv_epi64(_mm512_set1_epi64(1),
+			_mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i *) &squares[i])));
+		res = _mm512_setzero_si512();
+		for (dir = 0; dir < 8; dir++) {
+			f = _mm512_and_si512(shift8(bit, dir, &m), opp);
+			for (k = 3; k < size; k++) {
+				f = _mm512_or_si512(f, _mm512_and_si512(shift8(f, dir, &m), opp));
+			}
+			capture = _mm512_test_epi64_mask(shift8(f, dir, &m), own);
+			res = _mm512_mask_or_epi64(res, capture, res, f);
+		}
+		_mm512_storeu_si512(&flips[i], res);
+	}
+	return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t avx512_count(const batch_t *batch, int *own, int *opp) {
+	masks8_t m;
+	size_t i;
+
+	masks8_init(&m, batch->size);
+	for (i = 0; i + 8 <= batch->count; i += 8) {
+		_mm256_storeu_si256((__m256i *) &own[i],
+			_mm512_cvtepi64_epi32(popcount8(_mm512_load_si512(&batch->own[i]), &m)));
+		_mm256_storeu_si256((__m256i *) &opp[i],
+			_mm512_cvtepi64_epi32(popcount8(_mm512_load_si512(&batch->opp[i]), &m)));
+	}
+	return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t avx512_eval(const batch_t *batch, int *values) {
+	masks8_t m;
+	__m256i own, opp, sum, res;
+	__m256 q;
+	size_t i;
+
+	masks8_init(&m, batch->size);
+	for (i = 0; i + 8 <= batch->count; i += 8) {
+		own = _mm512_cvtepi64_epi32(popcount8(_mm512_load_si512(&batch->own[i]), &m));
+		opp = _mm512_cvtepi64_epi32(popcount8(_mm512_load_si512(&batch->opp[i]), &m));
+		sum = _mm256_add_epi32(own, opp);
+		q = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(100), _mm256_cvtepi32_ps(_mm256_sub_epi32(own, opp))),
+			_mm256_cvtepi32_ps(sum));
+		res = _mm256_andnot_si256(_mm256_cmpeq_epi32(sum, _mm256_setzero_si256()), _mm256_cvttps_epi32(q));
+		_mm256_storeu_si256((__m256i *) &values[i], res);
+	}
+	return i;
+}
+
+#endif
+
+void batch_mobility(const batch_t *batch, uint64_t *moves) {
+	size_t done = 0;
+#ifdef BATCH_X86
+	if (batch_isa() == BATCH_AVX512)
+		done = avx512_mobility(batch, moves);
+	else if (batch_isa() == BATCH_AVX2)
+		done = avx2_mobility(batch, moves);
+#endif
+	scalar_mobility(batch, done, moves);
+}
+
+void batch_flips(const batch_t *batch, const uint8_t *squares, uint64_t *flips) {
+	size_t done = 0;
+#ifdef BATCH_X86
+	if (batch_isa() == BATCH_AVX512)
+		done = avx512_flips(batch, squares, flips);
+	else if (batch_isa() == BATCH_AVX2)
+		done = avx2_flips(batch, squares, flips);
+#endif
+	scalar_flips(batch, done, squares, flips);
+}
+
+void batch_count(const batch_t *batch, int *own, int *opp) {
+	size_t done = 0;
+#ifdef BATCH_X86
+	if (batch_isa() == BATCH_AVX512)
+		done = avx512_count(batch, own, opp);
+	else if (batch_isa() == BATCH_AVX2)
+		done = avx2_count(batch, own, opp);
+#endif
+	scalar_count(batch, done, own, opp);
+}
+
+void batch_eval(const batch_t *batch, int *values) {
+	size_t done = 0;
+#ifdef BATCH_X86
+	if (batch_isa() == BATCH_AVX512)
+		done = avx512_eval(batch, values);
+	else if (batch_isa() == BATCH_AVX2)
+		done = avx2_eval(batch, values);
+#endif
+	scalar_eval(batch, done, values);
+}
@@ -1,4 +1,17 @@
-#include "../include/bitboard.h"
+#include <pthread.h>
+#include "../include/pcache.h"
+#include "../include/search.h"
+#include "../include/probcut.h"
+#include <math.h>
+#include "../include/mcts.h"
+#include "../include/solvedb.h"
+#include "../include/nn.h"
+#include "../include/ecache.h"
+
+static int search_stop = 0;
+static __thread int *thread_stop = NULL;
+static int engine = ENGINE_ALPHABETA;
+static __thread size_t search_nodes = 0;
 
 uint8_t get_bit(uint64_t bits, int pos) {
    return (bits >> pos) & 0x01;
@@ -13,6 +26,29 @@ uint64_t set_bit(uint64_t bits, int pos, int value) {
    return bits;
 }
 
+void bb_search_stop(int stop) {
+	__atomic_store_n(&search_stop, stop, __ATOMIC_RELAXED);
+}
+
+/* a flag that stops the searches of this thread only, NULL for none */
+void bb_search_flag(int *flag) {
+	thread_stop = flag;
+}
+
+int *bb_search_current_flag(void) {
+	return thread_stop;
+}
+
+int bb_search_stopped(void) {
+	return __atomic_load_n(&search_stop, __ATOMIC_RELAXED)
+		|| (thread_stop && __atomic_load_n(thread_stop, __ATOMIC_RELAXED));
+}
+
+/* nodes of the last negamax_alphabeta or ai_solve of this thread */
+size_t bb_search_nodes(void) {
+	return search_nodes;
+}
+
 bitboard_t bb_new(size_t size) {
 	bitboard_t board;
 	
@@ -107,10 +143,79 @@ score_t bb_score(bitboard_t board) {
 	return score;
 }
 
+int bb_empties(bitboard_t board) {
+	return board.size * board.size - __builtin_popcountll(board.black | board.white);
+}
+
 int one_dimension(int x, int y, size_t size) {
 	return y*size + x;
 }
 
+/*
+ * The 8 symmetries of the board: bit 2 of sym transposes, then bit 0
+ * mirrors the columns and bit 1 mirrors the rows.
+ */
+int bb_symmetry_square(int pos, size_t size, int sym) {
+	int row = pos / size, col = pos % size, tmp;
+	if (sym & 4) {
+		tmp = row;
+		row = col;
+		col = tmp;
+	}
+	if (sym & 1) {
+		col = size - 1 - col;
+	}
+	if (sym & 2) {
+		row = size - 1 - row;
+	}
+	return row * size + col;
+}
+
+static uint64_t mirror_columns(uint64_t x) {
+	const uint64_t k1 = 0x5555555555555555ULL, k2 = 0x3333333333333333ULL, k4 = 0x0f0f0f0f0f0f0f0fULL;
+	x = ((x >> 1) & k1) | ((x & k1) << 1);
+	x = ((x >> 2) & k2) | ((x & k2) << 2);
+	x = ((x >> 4) & k4) | ((x & k4) << 4);
+	return x;
+}
+
+static uint64_t transpose(uint64_t x) {
+	uint64_t t;
+	const uint64_t k1 = 0x5500550055005500ULL, k2 = 0x3333000033330000ULL, k4 = 0x0f0f0f0f00000000ULL;
+	t = k4 & (x ^ (x << 28));
+	x ^= t ^ (t >> 28);
+	t = k2 & (x ^ (x << 14));
+	x ^= t ^ (t >> 14);
+	t = k1 & (x ^ (x << 7));
+	x ^= t ^ (t >> 7);
+	return x;
+}
+
+static uint64_t symmetry_bits(uint64_t bits, size_t size, int sym) {
+	uint64_t res = 0;
+	int i;
+	if (size == 8) {
+		if (sym & 4)
+			bits = transpose(bits);
+		if (sym & 1)
+			bits = mirror_columns(bits);
+		if (sym & 2)
+			bits = __builtin_bswap64(bits);
+		return bits;
+	}
+	for (i = 0; i < (int) (size * size); i++) {
+		if (get_bit(bits, i))
+			res = set_bit(res, bb_symmetry_square(i, size, sym), 1);
+	}
+	return res;
+}
+
+bitboard_t bb_symmetry(bitboard_t board, int sym) {
+	board.black = symmetry_bits(board.black, board.size, sym);
+	board.white = symmetry_bits(board.white, board.size, sym);
+	return board;
+}
+
 /**
  * @brief 
  * @param player
@@ -584,30 +689,306 @@ bitboard_t bb_moves(state_t state) {
 	return moves;
 }
 
+int count_valid_moves(state_t state) {
+	bitboard_t a = bb_moves(state);
+	int i, count = 0;
+	uint64_t table;
+	if (state.player == BLACK_STONE) {
+		table = a.black;
+	} else {
+		table = a.white;
+	}
+	for (i = 0; i < a.size * a.size; i++) {
+		if (get_bit(table, i))
+			count++;
+	}
+	return count;
+}
+
+/*
+ * Shift based move generation, for any board size up to 8. Bit i is row
+ * i / size, column i % size; the column masks stop shifts from wrapping
+ * around the board edges.
+ */
+static uint64_t size_masks[MAX_BOARD_SIZE + 1][3];
+static int size_masks_ready = 0;
+static pthread_once_t size_masks_once = PTHREAD_ONCE_INIT;
+
+static void init_size_masks(void) {
+	size_t size, i;
+	for (size = 1; size <= MAX_BOARD_SIZE; size++) {
+		size_masks[size][0] = (size * size == 64) ? ~0ULL : ((uint64_t) 1 << (size * size)) - 1;
+		size_masks[size][1] = size_masks[size][2] = size_masks[size][0];
+		for (i = 0; i < size; i++) {
+			size_masks[size][1] &= ~((uint64_t) 1 << (i * size));
+			size_masks[size][2] &= ~((uint64_t) 1 << (i * size + size - 1));
+		}
+	}
+	__atomic_store_n(&size_masks_ready, 1, __ATOMIC_RELEASE);
+}
+
+/* built by one thread only; the flag saves the call once they are ready */
+static inline void need_size_masks(void) {
+	if (!__atomic_load_n(&size_masks_ready, __ATOMIC_ACQUIRE))
+		pthread_once(&size_masks_once, init_size_masks);
+}
+
+static inline uint64_t shift(uint64_t x, int dir, size_t size, const uint64_t *masks) {
+	switch (dir) {
+	case 0:
+		return (x & masks[2]) << 1;
+	case 1:
+		return (x & masks[1]) >> 1;
+	case 2:
+		return (x << size) & masks[0];
+	case 3:
+		return x >> size;
+	case 4:
+		return ((x & masks[2]) << (size + 1)) & masks[0];
+	case 5:
+		return ((x & masks[1]) << (size - 1)) & masks[0];
+	case 6:
+		return (x & masks[2]) >> (size - 1);
+	default:
+		return (x & masks[1]) >> (size + 1);
+	}
+}
+
+const uint64_t *bb_size_masks(size_t size) {
+	need_size_masks();
+	return size_masks[size];
+}
+
+uint64_t bb_mobility(uint64_t own, uint64_t opp, size_t size) {
+	const uint64_t *masks;
+	uint64_t empty, moves = 0, t;
+	int dir, i;
+
+	need_size_masks();
+	masks = size_masks[size];
+	empty = ~(own | opp) & masks[0];
+	for (dir = 0; dir < 8; dir++) {
+		t = shift(own, dir, size, masks) & opp;
+		for (i = 3; i < (int) size; i++) {
+			t |= shift(t, dir, size, masks) & opp;
+		}
+		moves |= shift(t, dir, size, masks) & empty;
+	}
+	return moves;
+}
+
+uint64_t bb_flips(uint64_t own, uint64_t opp, int pos, size_t size) {
+	const uint64_t *masks;
+	uint64_t flips = 0, line, x;
+	int dir;
+
+	need_size_masks();
+	masks = size_masks[size];
+	for (dir = 0; dir < 8; dir++) {
+		line = 0;
+		x = shift((uint64_t) 1 << pos, dir, size, masks);
+		while (x & opp) {
+			line |= x;
+			x = shift(x, dir, size, masks);
+		}
+		if (x & own)
+			flips |= line;
+	}
+	return flips;
+}
+
+/*
+ * Edge stability: for every board size and every configuration of one
+ * edge (base 3 index, own = 1, opponent = 2), the discs of either colour
+ * that no sequence of moves along that edge can flip.
+ */
+static uint8_t edge_stable[MAX_BOARD_SIZE + 1][EDGE_CONFIGS];
+static uint16_t base3[1 << MAX_BOARD_SIZE];
+static pthread_once_t stability_once = PTHREAD_ONCE_INIT;
+
+/* for each axis: every line of the board, and the squares at an end of one */
+static const int axis_dirs[4][2] = { { 0, 1 }, { 2, 3 }, { 4, 7 }, { 5, 6 } };
+static uint64_t lines[MAX_BOARD_SIZE + 1][4][2 * MAX_BOARD_SIZE];
+static int num_lines[MAX_BOARD_SIZE + 1][4];
+static uint64_t axis_walls[MAX_BOARD_SIZE + 1][4];
+
+static int edge_index(unsigned own, unsigned opp) {
+	return base3[own] + 2 * base3[opp];
+}
+
+/* flips along the line when colour own plays at square x */
+static unsigned edge_flips(unsigned own, unsigned opp, int x, int size) {
+	unsigned line, flips = 0;
+	int i;
+	for (line = 0, i = x + 1; i < size && (opp >> i & 1); i++)
+		line |= 1u << i;
+	if (i < size && (own >> i & 1))
+		flips |= line;
+	for (line = 0, i = x - 1; i >= 0 && (opp >> i & 1); i--)
+		line |= 1u << i;
+	if (i >= 0 && (own >> i & 1))
+		flips |= line;
+	return flips;
+}
+
+static uint8_t edge_stable_aux(unsigned own, unsigned opp, int size, uint8_t *done) {
+	unsigned empty = ~(own | opp) & ((1u << size) - 1), flips, stable = own | opp;
+	int x, index = edge_index(own, opp);
+
+	if (done[index]) {
+		return edge_stable[size][index];
+	}
+	for (x = 0; x < size; x++) {
+		if (!(empty >> x & 1))
+			continue;
+		flips = edge_flips(own, opp, x, size);
+		stable &= ~flips & edge_stable_aux(own | flips | 1u << x, opp & ~flips, size, done);
+		flips = edge_flips(opp, own, x, size);
+		stable &= ~flips & edge_stable_aux(own & ~flips, opp | flips | 1u << x, size, done);
+	}
+	done[index] = 1;
+	edge_stable[size][index] = stable;
+	return stable;
+}
+
+static void init_lines(size_t size) {
+	const uint64_t *masks = bb_size_masks(size);
+	uint64_t seed, line;
+	int k, i;
+
+	for (k = 0; k < 4; k++) {
+		num_lines[size][k] = 0;
+		axis_walls[size][k] = 0;
+		for (i = 0; i < (int) (size * size); i++) {
+			seed = (uint64_t) 1 << i;
+			if (!shift(seed, axis_dirs[k][0], size, masks) || !shift(seed, axis_dirs[k][1], size, masks))
+				axis_walls[size][k] |= seed;
+			if (shift(seed, axis_dirs[k][1], size, masks))
+				continue;
+			for (line = 0; seed; seed = shift(seed, axis_dirs[k][0], size, masks))
+				line |= seed;
+			lines[size][k][num_lines[size][k]++] = line;
+		}
+	}
+}
+
+static void init_stability(void) {
+	static uint8_t done[EDGE_CONFIGS];
+	unsigned own, opp;
+	int size, i;
+
+	for (own = 0; own < (1u << MAX_BOARD_SIZE); own++) {
+		base3[own] = 0;
+		for (i = MAX_BOARD_SIZE - 1; i >= 0; i--)
+			base3[own] = base3[own] * 3 + (own >> i & 1);
+	}
+	for (size = 1; size <= MAX_BOARD_SIZE; size++) {
+		memset(done, 0, sizeof(done));
+		for (own = 0; own < (1u << size); own++)
+			for (opp = 0; opp < (1u << size); opp++)
+				if (!(own & opp))
+					edge_stable_aux(own, opp, size, done);
+		init_lines(size);
+	}
+}
+
+/* column col as an n bit line, row 0 first */
+static unsigned get_column(uint64_t x, int col, int size) {
+	unsigned line = 0;
+	int i;
+	for (i = 0; i < size; i++)
+		line |= (unsigned) (x >> (i * size + col) & 1) << i;
+	return line;
+}
+
+static uint64_t set_column(unsigned line, int col, int size) {
+	uint64_t x = 0;
+	int i;
+	for (i = 0; i < size; i++)
+		x |= (uint64_t) (line >> i & 1) << (i * size + col);
+	return x;
+}
+
+static uint64_t edges_stable(uint64_t own, uint64_t opp, int size) {
+	int last = size * (size - 1);
+	unsigned row = (1u << size) - 1;
+	uint64_t stable;
+
+	stable = edge_stable[size][edge_index(own & row, opp & row)];
+	stable |= (uint64_t) edge_stable[size][edge_index(own >> last & row, opp >> last & row)] << last;
+	stable |= set_column(edge_stable[size][edge_index(get_column(own, 0, size),
+		get_column(opp, 0, size))], 0, size);
+	stable |= set_column(edge_stable[size][edge_index(get_column(own, size - 1, size),
+		get_column(opp, size - 1, size))], size - 1, size);
+	return stable;
+}
+
+/*
+ * Discs of own that can never be flipped: stable edge discs, then any disc
+ * that on each of the four axes has the board edge or a stable disc of its
+ * colour next to it, or sits on a full line, until nothing is added.
+ */
+uint64_t bb_stable(uint64_t own, uint64_t opp, size_t size) {
+	const uint64_t *masks = bb_size_masks(size);
+	uint64_t occupied = own | opp, axis[4], stable, old;
+	int k, i;
+
+	if (size < 2)
+		return own;
+	pthread_once(&stability_once, init_stability);
+	for (k = 0; k < 4; k++) {
+		axis[k] = axis_walls[size][k];
+		for (i = 0; i < num_lines[size][k]; i++) {
+			if ((occupied & lines[size][k][i]) == lines[size][k][i])
+				axis[k] |= lines[size][k][i];
+		}
+	}
+	stable = own & edges_stable(own, opp, size);
+	do {
+		old = stable;
+		stable |= own
+			& (axis[0] | shift(stable, 0, size, masks) | shift(stable, 1, size, masks))
+			& (axis[1] | shift(stable, 2, size, masks) | shift(stable, 3, size, masks))
+			& (axis[2] | shift(stable, 4, size, masks) | shift(stable, 7, size, masks))
+			& (axis[3] | shift(stable, 5, size, masks) | shift(stable, 6, size, masks));
+	} while (stable != old);
+	return stable;
+}
+
+static inline int eval_score(uint64_t own, uint64_t opp) {
+	(void) opp;
+	return __builtin_popcountll(own);
+}
+
+static inline int eval_coin_parity(uint64_t own, uint64_t opp) {
+	int max = __builtin_popcountll(own), min = __builtin_popcountll(opp);
+	return (max + min) ? 100 * (max - min) / (max + min) : 0;
+}
+
+static inline int eval_stability(uint64_t own, uint64_t opp, size_t size) {
+	return eval_coin_parity(own, opp) + STABILITY_WEIGHT * (__builtin_popcountll(bb_stable(own, opp, size))
+		- __builtin_popcountll(bb_stable(opp, own, size)));
+}
+
 int score_heuristic (state_t state) {
-	score_t score;
-	
-	score = bb_score(state.board);
-	
 	if (state.player == BLACK_STONE) {
-		return score.black;
+		return eval_score(state.board.black, state.board.white);
 	}
-	return score.white;
+	return eval_score(state.board.white, state.board.black);
 }
 
 int coin_parity_heuristic (state_t state) {
-	score_t score;
-	
-	score = bb_score(state.board);
-	int max, min;
 	if (state.player == BLACK_STONE) {
-		max = score.black;
-		min = score.white;
-	} else {
-		max = score.white;
-		min = score.black;
+		return eval_coin_parity(state.board.black, state.board.white);
+	}
+	return eval_coin_parity(state.board.white, state.board.black);
+}
+
+int stability_heuristic (state_t state) {
+	if (state.player == BLACK_STONE) {
+		return eval_stability(state.board.black, state.board.white, state.board.size);
 	}
-	return 100 * (float) (max - min ) / (float) (max + min);
+	return eval_stability(state.board.white, state.board.black, state.board.size);
 }
 
 int max(int a, int b) {
@@ -626,436 +1007,402 @@ int min(int a,int b) {
 	}
 }
 
-algo_t minimax_aux(bitboard_t board, char player, int depth, int (*heuristic) (state_t state), int maximizing) {
-	int best_value;
-	int num_moves = 0, x, y;
-	bitboard_t aux_board, moved_board;
-	move_t move;
+/* keeps a predicted bound strictly inside the infinite window */
+static inline int probcut_clamp(double bound) {
+	if (bound >= SCORE_INF - 1)
+		return SCORE_INF - 1;
+	if (bound <= -SCORE_INF + 1)
+		return -SCORE_INF + 1;
+	return (int) bound;
+}
+
+/* any other heuristic goes through its function pointer */
+static inline int eval_plugin(const search_t *s, uint64_t own, uint64_t opp, char player) {
 	state_t state;
-	score_t score;
-	algo_t res, v;
-	state.board = board;
 	state.player = player;
-	aux_board = bb_moves(state);
-	score = bb_score(aux_board);
-	num_moves = score.black + score.white;
-	if (depth == 0 || num_moves == 0) {
-		state.board = board;
-		state.player = player;
-		res.v = (*heuristic)(state);
-		return res;
-	}
+	state.board.size = s->size;
+	state.board.black = (player == BLACK_STONE) ? own : opp;
+	state.board.white = (player == BLACK_STONE) ? opp : own;
+	return (*s->heuristic)(state);
+}
 
-	if (maximizing) {
-		best_value = INT_MIN;
-		for (x = 0; x < state.board.size; x++) {
-			for (y = 0; y < state.board.size; y++) {
-				if (state.player == BLACK_STONE) {
-					if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_aux(moved_board, WHITE_STONE, depth - 1, heuristic, 0);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				} else {
-					if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_aux(moved_board, BLACK_STONE, depth - 1, heuristic, 0);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				}
-			}
-		}
-		return res;
-	} else {
-		best_value = INT_MAX;
-		for (x = 0; x < state.board.size; x++) {
-			for (y = 0; y < state.board.size; y++) {
-				if (state.player == BLACK_STONE) {
-					if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_aux(moved_board, WHITE_STONE, depth - 1, heuristic, 1);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = min(v.v, best_value);
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				} else {
-					if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_aux(moved_board, BLACK_STONE, depth - 1, heuristic, 1);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				}
-			}
-		}
-		return res;
-	}
+#define SEARCH_SUFFIX score
+#define SEARCH_CACHE 1
+#define SEARCH_EVAL(s, own, opp, player) eval_score(own, opp)
+#include "search_impl.h"
+
+#define SEARCH_SUFFIX coin_parity
+#define SEARCH_CACHE 1
+#define SEARCH_EVAL(s, own, opp, player) eval_coin_parity(own, opp)
+#include "search_impl.h"
+
+#define SEARCH_SUFFIX stability
+#define SEARCH_CACHE 1
+#define SEARCH_EVAL(s, own, opp, player) eval_stability(own, opp, (s)->size)
+#include "search_impl.h"
+
+/* the network keeps its first layer along the search line; other points of view negate it */
+static inline int eval_nn(const search_t *s, uint64_t own, uint64_t opp, char player) {
+	if (!nn_ready(s->size))
+		return eval_stability(own, opp, s->size);
+	return (player == s->player) ? nn_search_eval(s) : -nn_search_eval(s);
+}
+
+#define SEARCH_SUFFIX nn
+#define SEARCH_CACHE 1
+#define SEARCH_EVAL(s, own, opp, player) eval_nn(s, own, opp, player)
+#include "search_impl.h"
+
+/* a function pointer may have side effects, so every leaf calls it */
+#define SEARCH_SUFFIX plugin
+#define SEARCH_CACHE 0
+#define SEARCH_EVAL(s, own, opp, player) eval_plugin(s, own, opp, player)
+#include "search_impl.h"
+
+typedef struct {
+	int (*heuristic) (state_t state);
+	algo_t (*minimax) (search_t *s, int depth, char root);
+	algo_t (*negamax) (search_t *s, int depth);
+	algo_t (*minimax_alphabeta) (search_t *s, int depth, int alpha, int beta, char root);
+	algo_t (*negamax_alphabeta) (search_t *s, int depth, int alpha, int beta);
+	algo_t (*negascout) (search_t *s, int depth, int alpha, int beta);
+} search_variant_t;
+
+#define SEARCH_VARIANT(suffix, heuristic) { heuristic, minimax_aux_##suffix, negamax_aux_##suffix, \
+	minimax_alphabeta_aux_##suffix, negamax_alphabeta_aux_##suffix, negascout_aux_##suffix }
+
+/* the built-in evaluators get their own inlined searches, the last entry is the fallback */
+static const search_variant_t variants[] = {
+	SEARCH_VARIANT(score, score_heuristic),
+	SEARCH_VARIANT(coin_parity, coin_parity_heuristic),
+	SEARCH_VARIANT(stability, stability_heuristic),
+	SEARCH_VARIANT(nn, nn_heuristic),
+	SEARCH_VARIANT(plugin, NULL)
+};
+
+static const search_variant_t *search_start(search_t *s, state_t state, int (*heuristic) (state_t state)) {
+	size_t i;
+	search_init(s, state);
+	s->heuristic = heuristic;
+	ecache_begin();
+	for (i = 0; variants[i].heuristic && variants[i].heuristic != heuristic; i++)
+		;
+	if (heuristic == nn_heuristic && nn_ready(s->size))
+		nn_search_start(s);
+	return &variants[i];
 }
 
 move_t minimax(state_t state, int depth, int (*heuristic) (state_t state)) {
-	return minimax_aux(state.board, state.player, depth, heuristic, 1).move;
+	search_t s;
+	return search_start(&s, state, heuristic)->minimax(&s, depth, state.player).move;
 }
 
-algo_t negamax_aux(bitboard_t board, char player, int depth, int (*heuristic) (state_t state), int color) {
-	state_t state;
-	algo_t res, v;
-	int x, y;
-	move_t move;
-	state.board = board;
-	state.player = player;
-	bitboard_t aux_board = bb_moves(state), moved_board;
-	score_t score = bb_score(aux_board);
-	int num_moves = score.black + score.white;
-	if (depth == 0 || num_moves == 0) {
-		state.board = board;
-		state.player = player;
-		res.v = (*heuristic)(state) * color;
-		return res;
-	}
-	
-	int best_value = INT_MIN;
-	for (x = 0; x < state.board.size; x++) {
-		for (y = 0; y < state.board.size; y++) {
-			if (state.player == BLACK_STONE) {
-				if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negamax_aux(moved_board, WHITE_STONE, depth - 1, heuristic, -color);
-					v.move.column = move.column;
-					v.move.row = move.row;
-					v.v *= -1;
-					best_value = max(v.v, best_value);
-					if (v.v == best_value) {
-						res.move.column = v.move.column;
-						res.move.row = v.move.row;
-						res.v = v.v;
-					}
-				}
-			} else {
-				if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negamax_aux(moved_board, BLACK_STONE, depth - 1, heuristic, -color);
-					v.move.column = move.column;
-					v.move.row = move.row;
-					v.v *= -1;
-					best_value = max(v.v, best_value);
-					if (v.v == best_value) {
-						res.move.column = v.move.column;
-						res.move.row = v.move.row;
-						res.v = v.v;
-					}
-				}
-			}
-		}
-	}
+move_t negamax(state_t state, int depth, int (*heuristic) (state_t state)) {
+	search_t s;
+	return search_start(&s, state, heuristic)->negamax(&s, depth).move;
+}
+
+move_t minimax_alphabeta(state_t state, int depth, int (*heuristic) (state_t state)) {
+	search_t s;
+	return search_start(&s, state, heuristic)->minimax_alphabeta(&s, depth, INT_MIN, INT_MAX, state.player).move;
+}
+
+algo_t negamax_alphabeta_search(state_t state, int depth, int (*heuristic) (state_t state)) {
+	search_t s;
+	algo_t res = search_start(&s, state, heuristic)->negamax_alphabeta(&s, depth, -SCORE_INF, SCORE_INF);
+	search_nodes = s.nodes;
 	return res;
 }
 
-move_t negamax(state_t state, int depth, int (*heuristic) (state_t state)) {
-	return negamax_aux(state.board, state.player, depth, heuristic, 1).move;
+move_t negamax_alphabeta(state_t state, int depth, int (*heuristic) (state_t state)) {
+	return negamax_alphabeta_search(state, depth, heuristic).move;
 }
 
-algo_t minimax_alphabeta_aux(bitboard_t board, char player, int depth, int alpha, int beta, int (*heuristic) (state_t state), int maximizing) {
-	int best_value;
-	int num_moves = 0, x, y;
-	bitboard_t aux_board, moved_board;
-	move_t move;
-	state_t state;
-	score_t score;
-	algo_t res, v;
-	state.board = board;
-	state.player = player;
-	aux_board = bb_moves(state);
-	score = bb_score(aux_board);
-	num_moves = score.black + score.white;
-	if (depth == 0 || num_moves == 0) {
-		state.board = board;
-		state.player = player;
-		res.v = (*heuristic)(state);
-		return res;
+int negamax_alphabeta_value(state_t state, int depth, int (*heuristic) (state_t state)) {
+	return negamax_alphabeta_search(state, depth, heuristic).v;
+}
+
+/*
+ * Iterative deepening that can be stopped at any node. The answer is the
+ * best move of the deepest completed iteration, or of the stopped one once
+ * its first root move, the best of the one before, has been searched: the
+ * root window is full, so a move that replaced it has an exact score.
+ * reached gets the deepest completed iteration, 0 if none.
+ */
+algo_t bb_deepening_search(state_t state, int depth, int (*heuristic) (state_t state), int *reached) {
+	search_t s;
+	const search_variant_t *v = search_start(&s, state, heuristic);
+	algo_t best, res;
+	int d;
+
+	best.v = 0;
+	best.move = search_move(&s, SEARCH_PASS);
+	*reached = 0;
+	for (d = 1; d <= depth; d++) {
+		res = v->negamax_alphabeta(&s, d, -SCORE_INF, SCORE_INF);
+		if (res.move.row < s.size && res.move.column < s.size)
+			best = res;
+		if (bb_search_stopped())
+			break;
+		*reached = d;
 	}
+	search_nodes = s.nodes;
+	return best;
+}
 
-	if (maximizing) {
-		best_value = INT_MIN;
-		for (x = 0; x < state.board.size; x++) {
-			for (y = 0; y < state.board.size; y++) {
-				if (state.player == BLACK_STONE) {
-					if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_alphabeta_aux(moved_board, WHITE_STONE, depth - 1, alpha, beta, heuristic, 0);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						alpha = max(alpha, v.v);
-						if (beta <= alpha)
-							break;
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				} else {
-					if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_alphabeta_aux(moved_board, BLACK_STONE, depth - 1, alpha, beta, heuristic, 0);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						alpha = max(alpha, v.v);
-						if (beta <= alpha)
-							break;
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				}
-			}
+move_t negascout(state_t state, int depth, int (*heuristic) (state_t state)) {
+	search_t s;
+	return search_start(&s, state, heuristic)->negascout(&s, depth, -SCORE_INF, SCORE_INF).move;
+}
+
+/*
+ * Exact solver: final disc difference for the side to move. Nodes with
+ * enough empties are looked up in, and written to, the persistent cache.
+ */
+static int solve_aux(search_t *s, int alpha, int beta, bool passed, int *best) {
+	pcache_entry_t entry;
+	uint64_t moves;
+	int square, child_best, v, best_value = -SCORE_INF, alpha_orig, lower, upper, bound;
+	int empties = search_empties(s), cached = empties >= PCACHE_MIN_EMPTIES, squares = s->size * s->size;
+
+	*best = SEARCH_PASS;
+	if (bb_search_stopped()) {
+		return 0;
+	}
+	if (cached && pcache_probe(search_state(s), &entry) && entry.depth >= empties) {
+		if (entry.move.row < s->size && entry.move.column < s->size)
+			*best = one_dimension(entry.move.row, entry.move.column, s->size);
+		if (entry.lower == entry.upper || entry.lower >= beta) {
+			return entry.lower;
+		} else if (entry.upper <= alpha) {
+			return entry.upper;
 		}
-		return res;
-	} else {
-		best_value = INT_MAX;
-		for (x = 0; x < state.board.size; x++) {
-			for (y = 0; y < state.board.size; y++) {
-				if (state.player == BLACK_STONE) {
-					if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_alphabeta_aux(moved_board, WHITE_STONE, alpha, beta, depth - 1, heuristic, 1);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = min(v.v, best_value);
-						beta = min(beta, v.v);
-						if (beta <= alpha)
-							break;
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				} else {
-					if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-						move.column = (size_t) y;
-						move.row = (size_t) x;
-						moved_board = bb_move(move, state);
-						v = minimax_alphabeta_aux(moved_board, BLACK_STONE, alpha, beta, depth - 1, heuristic, 1);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						best_value = max(v.v, best_value);
-						if (v.v == best_value) {
-							res.move.column = v.move.column;
-							res.move.row = v.move.row;
-							res.v = v.v;
-						}
-					}
-				}
-			}
+		alpha = max(alpha, entry.lower);
+		beta = min(beta, entry.upper);
+	}
+	/* stable discs bound the final score, so it may already be outside the window */
+	if ((int) (squares - 2 * __builtin_popcountll(s->opp)) <= alpha) {
+		bound = squares - 2 * __builtin_popcountll(bb_stable(s->opp, s->own, s->size));
+		if (bound <= alpha)
+			return bound;
+		beta = min(beta, bound);
+	}
+	if ((int) (2 * __builtin_popcountll(s->own) - squares) >= beta) {
+		bound = 2 * __builtin_popcountll(bb_stable(s->own, s->opp, s->size)) - squares;
+		if (bound >= beta)
+			return bound;
+		alpha = max(alpha, bound);
+	}
+	alpha_orig = alpha;
+
+	moves = search_moves(s);
+	if (moves == 0) {
+		if (passed) {
+			return search_disc_diff(s);
 		}
-		return res;
+		search_play(s, SEARCH_PASS);
+		v = -solve_aux(s, -beta, -alpha, true, &child_best);
+		search_undo(s);
+		return v;
+	}
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		search_play(s, square);
+		v = -solve_aux(s, -beta, -alpha, false, &child_best);
+		search_undo(s);
+		if (bb_search_stopped()) {
+			return 0;
+		}
+		if (v > best_value) {
+			best_value = v;
+			*best = square;
+		}
+		alpha = max(alpha, v);
+		if (alpha >= beta)
+			break;
 	}
-}
 
+	if (cached) {
+		lower = -(int) (s->size * s->size);
+		upper = -lower;
+		if (best_value <= alpha_orig) {
+			upper = best_value;
+		} else if (best_value >= beta) {
+			lower = best_value;
+		} else {
+			lower = upper = best_value;
+		}
+		pcache_store(search_state(s), empties, lower, upper, search_move(s, *best));
+	}
+	return best_value;
+}
 
-move_t minimax_alphabeta(state_t state, int depth, int (*heuristic) (state_t state)) {
-	/*(* Initial call *)
-	alphabeta(origin, depth, -∞, +∞, TRUE)*/
-	return minimax_alphabeta_aux(state.board, state.player, depth, INT_MIN, INT_MAX, heuristic, 1).move;
-	
+move_t ai_solve(state_t state, int *score) {
+	search_t s;
+	int v, best;
+	pcache_refresh();
+	search_init(&s, state);
+	v = solve_aux(&s, -SCORE_INF, SCORE_INF, false, &best);
+	search_nodes = s.nodes;
+	if (score) {
+		*score = v;
+	}
+	return search_move(&s, best);
 }
 
-algo_t negamax_alphabeta_aux(bitboard_t board, char player, int depth, int alpha, int beta, int (*heuristic) (state_t state), int color) {
-	state_t state;
-	algo_t res, v;
-	int x, y;
-	move_t move;
-	state.board = board;
-	state.player = player;
-	bitboard_t aux_board = bb_moves(state), moved_board;
-	score_t score = bb_score(aux_board);
-	int num_moves = score.black + score.white;
-	if (depth == 0 || num_moves == 0) {
-		state.board = board;
-		state.player = player;
-		res.v = (*heuristic)(state) * color;
-		return res;
+/*
+ * Multi-PV analysis: every root move gets a score. The first `lines`
+ * moves in the order of the previous iteration are searched with a full
+ * window, so their scores are exact. Any other move is first tested with
+ * a null window against the lines-th best exact score. Only a move that
+ * beats it is searched again in full; otherwise its score is an upper
+ * bound. The table is shared by all root moves and all iterations, so
+ * moves are ordered by the previous depth and transpositions between
+ * them are free.
+ */
+static int analysis_kth(const analysis_t *a, int upto, int k) {
+	int scores[MAX_BOARD_SIZE * MAX_BOARD_SIZE], n = 0, i, j, tmp;
+
+	for (i = 0; i < upto; i++) {
+		if (a->lines[i].bound == ANALYSIS_EXACT)
+			scores[n++] = a->lines[i].score;
 	}
-	
-	int best_value = INT_MIN;
-	for (x = 0; x < state.board.size; x++) {
-		for (y = 0; y < state.board.size; y++) {
-			if (state.player == BLACK_STONE) {
-				if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negamax_aux(moved_board, WHITE_STONE, depth - 1, heuristic, -color);
-					v.move.column = move.column;
-					v.move.row = move.row;
-					v.v *= -1;
-					best_value = max(v.v, best_value);
-					alpha = max(alpha, v.v);
-					if (alpha >= beta)
-						break;
-					if (v.v == best_value) {
-						res.move.column = v.move.column;
-						res.move.row = v.move.row;
-						res.v = v.v;
-					}
-				}
-			} else {
-				if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negamax_aux(moved_board, BLACK_STONE, depth - 1, heuristic, -color);
-					v.move.column = move.column;
-					v.move.row = move.row;
-					v.v *= -1;
-					best_value = max(v.v, best_value);
-					alpha = max(alpha, v.v);
-					if (alpha >= beta)
-						break;
-					if (v.v == best_value) {
-						res.move.column = v.move.column;
-						res.move.row = v.move.row;
-						res.v = v.v;
-					}
-				}
+	for (i = 0; i < k && i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			if (scores[j] > scores[i]) {
+				tmp = scores[i];
+				scores[i] = scores[j];
+				scores[j] = tmp;
 			}
 		}
 	}
-	return res;
+	return n >= k ? scores[k - 1] : -SCORE_INF;
 }
 
-move_t negamax_alphabeta(state_t state, int depth, int (*heuristic) (state_t state)) {
-	return negamax_alphabeta_aux(state.board, state.player, depth, INT_MIN, INT_MAX, heuristic, 1).move;
+/* exact scores first: a bound is no better than the worst of the best `lines` moves */
+static int compare_lines(const void *x, const void *y) {
+	const analysis_line_t *a = x, *b = y;
+	if (a->bound != b->bound)
+		return a->bound - b->bound;
+	return (a->score < b->score) - (a->score > b->score);
 }
 
-algo_t negascout_aux(bitboard_t board, char player, int depth, int alpha, int beta, int (*heuristic) (state_t state)) {
-	int num_moves = 0, x, y, b, a;
-	bitboard_t aux_board, moved_board;
-	move_t move;
-	state_t state;
-	score_t score;
-	algo_t res, v;
-	state.board = board;
-	state.player = player;
-	aux_board = bb_moves(state);
-	score = bb_score(aux_board);
-	num_moves = score.black + score.white;
-	if (depth == 0 || num_moves == 0) {
-		state.board = board;
-		state.player = player;
-		res.v = (*heuristic)(state);
-		return res;
+/* the line after the root move: best moves from the table, or from the solver */
+static void analysis_pv(search_t *s, analysis_line_t *line, int max, bool solved) {
+	tt_entry_t entry;
+	int square, plies = 0;
+
+	while (line->pv_length < max && !bb_search_stopped()) {
+		if (solved) {
+			solve_aux(s, -SCORE_INF, SCORE_INF, false, &square);
+		} else if (tt_probe(search_key(s), &entry) && entry.move.row < s->size && entry.move.column < s->size) {
+			square = one_dimension(entry.move.row, entry.move.column, s->size);
+		} else {
+			break;
+		}
+		if (square == SEARCH_PASS || !(search_moves(s) >> square & 1))
+			break;
+		search_play(s, square);
+		plies++;
+		line->pv[line->pv_length++] = search_move(s, square);
 	}
+	while (plies--)
+		search_undo(s);
+}
 
-	b = beta;
-	for (x = 0; x < state.board.size; x++) {
-		for (y = 0; y < state.board.size; y++) {
-			if (state.player == BLACK_STONE) {
-				if (get_bit(aux_board.black, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negascout_aux(moved_board, WHITE_STONE, depth - 1, -b, -alpha, heuristic);
-					v.v *= -1;
-					v.move.column = move.column;
-					v.move.row = move.row;
-					a = v.v;
-					if (a > alpha)
-						alpha = a;
-					if (alpha >= beta)
-						return v;
-					if (alpha >= b) {
-						v = negascout_aux(moved_board, WHITE_STONE, depth - 1, -b, -alpha, heuristic);
-						v.v *= -1;
-						alpha = v.v;
-						if (alpha >= beta)
-							return v;
-					}
-					b = alpha + 1;
-					
-				}
+static int analysis_value(search_t *s, const search_variant_t *v, int depth, bool solved, int alpha, int beta) {
+	int best;
+	if (solved)
+		return -solve_aux(s, -beta, -alpha, false, &best);
+	return -v->negamax_alphabeta(s, depth - 1, -beta, -alpha).v;
+}
+
+int bb_analyze(state_t state, int depth, int lines, int solve_empties, int (*heuristic) (state_t state),
+		analysis_report_t report, void *arg, analysis_t *result) {
+	search_t s;
+	const search_variant_t *v = search_start(&s, state, heuristic);
+	analysis_t a;
+	analysis_line_t *line;
+	uint64_t moves = search_moves(&s);
+	bool solved = bb_empties(state.board) <= solve_empties;
+	int d, i, kth, square;
+
+	a.num_lines = 0;
+	for (; moves; moves &= moves - 1) {
+		line = &a.lines[a.num_lines++];
+		line->move = search_move(&s, __builtin_ctzll(moves));
+		line->score = 0;
+		line->bound = ANALYSIS_EXACT;
+	}
+	lines = (lines <= 0 || lines > a.num_lines) ? a.num_lines : lines;
+	result->depth = 0;
+	result->solved = false;
+	result->num_lines = a.num_lines;
+	result->nodes = 0;
+	if (a.num_lines == 0) {
+		return 0;
+	}
+	if (solved) {
+		pcache_refresh();
+		depth = bb_empties(state.board);
+	}
+	for (d = solved ? depth : 1; d <= depth; d++) {
+		for (i = 0; i < a.num_lines; i++) {
+			line = &a.lines[i];
+			square = one_dimension(line->move.row, line->move.column, s.size);
+			search_play(&s, square);
+			if (i < lines) {
+				line->score = analysis_value(&s, v, d, solved, -SCORE_INF, SCORE_INF);
+				line->bound = ANALYSIS_EXACT;
 			} else {
-				if (get_bit(aux_board.white, one_dimension(x, y, state.board.size))) {
-					move.column = (size_t) y;
-					move.row = (size_t) x;
-					moved_board = bb_move(move, state);
-					v = negascout_aux(moved_board, BLACK_STONE, depth - 1, -b, -alpha, heuristic);
-					v.move.column = move.column;
-					v.move.row = move.row;
-					v.v *= -1;
-					a = v.v;
-					if (a > alpha)
-						alpha = a;
-					if (alpha >= beta)
-						return v;
-					if (alpha >= b) {
-						v = negascout_aux(moved_board, BLACK_STONE, depth - 1, -b, -alpha, heuristic);
-						v.move.column = move.column;
-						v.move.row = move.row;
-						v.v *= -1;
-						alpha = v.v;
-						if (alpha >= beta)
-							return v;
-					}
-					b = alpha + 1;
+				kth = analysis_kth(&a, i, lines);
+				line->score = analysis_value(&s, v, d, solved, kth, kth + 1);
+				line->bound = ANALYSIS_UPPER;
+				if (line->score > kth && !bb_search_stopped()) {
+					line->score = analysis_value(&s, v, d, solved, -SCORE_INF, SCORE_INF);
+					line->bound = ANALYSIS_EXACT;
 				}
 			}
+			line->pv[0] = line->move;
+			line->pv_length = 1;
+			if (line->bound == ANALYSIS_EXACT)
+				analysis_pv(&s, line, min(d, ANALYSIS_MAX_PV), solved);
+			search_undo(&s);
+			if (bb_search_stopped())
+				break;
 		}
+		if (bb_search_stopped())
+			break;
+		qsort(a.lines, a.num_lines, sizeof(analysis_line_t), compare_lines);
+		a.depth = d;
+		a.solved = solved;
+		a.nodes = s.nodes;
+		*result = a;
+		if (report)
+			report(result, arg);
 	}
-	return v;
+	search_nodes = s.nodes;
+	return result->depth;
 }
 
-move_t negascout(state_t state, int depth, int (*heuristic) (state_t state)) {
-	return negascout_aux(state.board, state.player, depth, INT_MIN, INT_MAX, heuristic).move;
+move_t ai_search(state_t state, int depth) {
+	return negamax_alphabeta(state, depth, nn_ready(state.board.size) ? nn_heuristic : stability_heuristic);
+}
+
+void ai_set_engine(int name) {
+	engine = name;
 }
 
 move_t ai_player(state_t state) {
-	return minimax_alphabeta(state, 2, coin_parity_heuristic);
+	move_t move;
+	if (solvedb_move(state, &move, NULL)) {
+		return move;
+	}
+	if (bb_empties(state.board) <= ENDGAME_EMPTIES) {
+		return ai_solve(state, NULL);
+	}
+	if (engine == ENGINE_MCTS) {
+		return mcts_player(state);
+	}
+	return ai_search(state, AI_DEPTH);
 }
@@ -0,0 +1,84 @@
+/*
+ * Perft and search bodies over a board type, included by wide.c once per
+ * type. Before each inclusion BOARD_SUFFIX names the instance, BOARD_T is
+ * the bitboard type and the BOARD_* macros are its operations. Positions
+ * are copied rather than undone, as own and opp of the side to move.
+ */
+#define BOARD_PASTE(name, suffix) name##_##suffix
+#define BOARD_NAME(name, suffix) BOARD_PASTE(name, suffix)
+#define BOARD_FN(name) BOARD_NAME(name, BOARD_SUFFIX)
+
+/* a pass is a ply; a finished game is a leaf */
+static uint64_t BOARD_FN(perft)(BOARD_T own, BOARD_T opp, size_t size, int depth, int passed) {
+	BOARD_T moves, flips;
+	uint64_t nodes = 0;
+	int square;
+
+	if (depth == 0) {
+		return 1;
+	}
+	moves = BOARD_MOBILITY(own, opp, size);
+	if (BOARD_IS_ZERO(moves)) {
+		return passed ? 1 : BOARD_FN(perft)(opp, own, size, depth - 1, 1);
+	}
+	for (; !BOARD_IS_ZERO(moves); moves = BOARD_CLEAR_FIRST(moves)) {
+		square = BOARD_FIRST(moves);
+		flips = BOARD_FLIPS(own, opp, square, size);
+		nodes += BOARD_FN(perft)(BOARD_XOR(opp, flips), BOARD_OR(BOARD_XOR(own, flips), BOARD_BIT(square)),
+			size, depth - 1, 0);
+	}
+	return nodes;
+}
+
+static inline int BOARD_FN(coin_parity)(BOARD_T own, BOARD_T opp) {
+	int max = BOARD_COUNT(own), min = BOARD_COUNT(opp);
+	return (max + min) ? 100 * (max - min) / (max + min) : 0;
+}
+
+static int BOARD_FN(alphabeta)(BOARD_T own, BOARD_T opp, size_t size, int depth, int alpha, int beta,
+		int *best, size_t *nodes) {
+	BOARD_T moves, flips;
+	int square, v, child, value = -SCORE_INF;
+
+	*best = WIDE_PASS;
+	(*nodes)++;
+	if (bb_search_stopped()) {
+		return value;
+	}
+	moves = BOARD_MOBILITY(own, opp, size);
+	if (depth == 0 || BOARD_IS_ZERO(moves)) {
+		return BOARD_FN(coin_parity)(own, opp);
+	}
+	for (; !BOARD_IS_ZERO(moves); moves = BOARD_CLEAR_FIRST(moves)) {
+		square = BOARD_FIRST(moves);
+		flips = BOARD_FLIPS(own, opp, square, size);
+		v = -BOARD_FN(alphabeta)(BOARD_XOR(opp, flips), BOARD_OR(BOARD_XOR(own, flips), BOARD_BIT(square)),
+			size, depth - 1, -beta, -alpha, &child, nodes);
+		if (bb_search_stopped()) {
+			return value;
+		}
+		if (v > value) {
+			value = v;
+			*best = square;
+		}
+		alpha = (v > alpha) ? v : alpha;
+		if (alpha >= beta)
+			break;
+	}
+	return value;
+}
+
+#undef BOARD_FN
+#undef BOARD_NAME
+#undef BOARD_PASTE
+#undef BOARD_SUFFIX
+#undef BOARD_T
+#undef BOARD_MOBILITY
+#undef BOARD_FLIPS
+#undef BOARD_XOR
+#undef BOARD_OR
+#undef BOARD_BIT
+#undef BOARD_IS_ZERO
+#undef BOARD_FIRST
+#undef BOARD_CLEAR_FIRST
+#undef BOARD_COUNT
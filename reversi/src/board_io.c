@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/board_io.h"
+
+/*
+ * Board text format:
+ *
+ *   # comment (anywhere, up to the end of the line)
+ *   X               <- player to move
+ *   _ _ O X ...     <- one line per row, stones separated by spaces
+ *
+ * A file may hold several positions one after the other. The scanner walks
+ * the buffer once and builds the black/white masks as it goes.
+ */
+
+int board_file_open(const char *filename, board_file_t *file) {
+	struct stat st;
+	int fd;
+
+	file->data = NULL;
+	file->length = 0;
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) < 0) {
+		close(fd);
+		return -1;
+	}
+	if (st.st_size > 0) {
+		file->data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (file->data == MAP_FAILED) {
+			file->data = NULL;
+			close(fd);
+			return -1;
+		}
+		file->length = st.st_size;
+	}
+	close(fd);
+	return 0;
+}
+
+void board_file_close(board_file_t *file) {
+	if (file->data) {
+		munmap(file->data, file->length);
+	}
+	file->data = NULL;
+	file->length = 0;
+}
+
+void board_reader_init(board_reader_t *reader, const char *data, size_t length) {
+	reader->cur = data;
+	reader->end = data + length;
+	reader->line = 0;
+	reader->error[0] = 0;
+}
+
+static int wrong_char(board_reader_t *reader, char c) {
+	snprintf(reader->error, sizeof(reader->error),
+		"reversi: error: wrong character '%c' at line %d", c, reader->line);
+	return BOARD_ERROR;
+}
+
+int board_read(board_reader_t *reader, state_t *state) {
+	const char *p = reader->cur, *end = reader->end;
+	char player = 0, line_player = 0, c;
+	size_t width = 0, rows = 0, cols;
+	uint64_t black = 0, white = 0, row_black, row_white;
+	bool last_stone;
+
+	while (p < end) {
+		reader->line++;
+		cols = 0;
+		row_black = row_white = 0;
+		last_stone = false;
+		for (; p < end && *p != '\n'; p++) {
+			c = *p;
+			if (c == '#') {
+				while (p < end && *p != '\n')
+					p++;
+				break;
+			}
+			if (c == ' ' || c == '\t' || c == '\r') {
+				last_stone = false;
+				continue;
+			}
+			if ((c != BLACK_STONE && c != WHITE_STONE && c != EMPTY_STONE) || last_stone) {
+				return wrong_char(reader, c);
+			}
+			last_stone = true;
+			if (!player) {
+				if (c == EMPTY_STONE || cols) {
+					return wrong_char(reader, c);
+				}
+				line_player = c;
+				cols++;
+				continue;
+			}
+			if (cols >= MAX_BOARD_SIZE) {
+				snprintf(reader->error, sizeof(reader->error),
+					"reversi: error: board width is too long at line %d", reader->line);
+				return BOARD_ERROR;
+			}
+			if (c == BLACK_STONE) {
+				row_black |= (uint64_t) 1 << cols;
+			} else if (c == WHITE_STONE) {
+				row_white |= (uint64_t) 1 << cols;
+			}
+			cols++;
+		}
+		if (p < end) {
+			p++;
+		}
+		if (cols == 0) {
+			continue;
+		}
+		if (!player) {
+			player = line_player;
+			continue;
+		}
+		if (width == 0) {
+			width = cols;
+		} else if (cols < width) {
+			snprintf(reader->error, sizeof(reader->error),
+				"reversi: error board is too short at line %d", reader->line);
+			return BOARD_ERROR;
+		} else if (cols > width) {
+			snprintf(reader->error, sizeof(reader->error),
+				"reversi: error board is too long at line %d", reader->line);
+			return BOARD_ERROR;
+		}
+		black |= row_black << (rows * width);
+		white |= row_white << (rows * width);
+		rows++;
+		if (rows == width) {
+			reader->cur = p;
+			state->player = player;
+			state->board.size = width;
+			state->board.black = black;
+			state->board.white = white;
+			return BOARD_OK;
+		}
+	}
+	reader->cur = p;
+	if (!player) {
+		return BOARD_END;
+	}
+	snprintf(reader->error, sizeof(reader->error),
+		"reversi: error: board has too few rows at line %d", reader->line);
+	return BOARD_ERROR;
+}
+
+int board_write(FILE *f, state_t state) {
+	char buffer[2 + MAX_BOARD_SIZE * MAX_BOARD_SIZE * 2], *p = buffer;
+	size_t i, size = state.board.size;
+
+	*p++ = state.player;
+	*p++ = '\n';
+	for (i = 0; i < size * size; i++) {
+		if (get_bit(state.board.black, i)) {
+			*p++ = BLACK_STONE;
+		} else if (get_bit(state.board.white, i)) {
+			*p++ = WHITE_STONE;
+		} else {
+			*p++ = EMPTY_STONE;
+		}
+		*p++ = (i % size == size - 1) ? '\n' : ' ';
+	}
+	return fwrite(buffer, 1, p - buffer, f) == (size_t) (p - buffer) ? 0 : -1;
+}
+
+void board_square_name(int square, size_t size, char name[BOARD_SQUARE_NAME]) {
+	if (square < 0) {
+		snprintf(name, BOARD_SQUARE_NAME, "pass");
+	} else {
+		snprintf(name, BOARD_SQUARE_NAME, "%c%d", 'a' + (int) (square / size), (int) (square % size) + 1);
+	}
+}
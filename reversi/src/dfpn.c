@@ -0,0 +1,291 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/dfpn.h"
+#include "../include/search.h"
+#include "../include/util.h"
+
+#define DFPN_MAX_MOVES 64
+
+typedef struct {
+	uint64_t key;
+	uint32_t pn;
+	uint32_t dn;
+	uint32_t tree;
+	int square;
+	int best;
+} child_t;
+
+/* saturated sum; only a proof or a disproof reaches DFPN_INF */
+static inline uint32_t add(uint32_t a, uint32_t b) {
+	if (a >= DFPN_INF || b >= DFPN_INF)
+		return DFPN_INF;
+	return (a + b >= DFPN_INF) ? DFPN_INF - 1 : a + b;
+}
+
+/* the threshold is part of the key, so proofs of different questions never mix */
+static inline uint64_t node_key(const search_t *s, int threshold) {
+	uint64_t key = search_key(s) ^ (uint64_t) (threshold + 128) * 0x9e3779b97f4a7c15ULL;
+	return key ? key : 1;
+}
+
+int dfpn_init(dfpn_t *dfpn, size_t megabytes) {
+	dfpn->buckets = (megabytes << 20) / (DFPN_BUCKET * sizeof(dfpn_entry_t));
+	dfpn->table = malloc(dfpn->buckets * DFPN_BUCKET * sizeof(dfpn_entry_t));
+	if (dfpn->table == NULL || dfpn->buckets == 0) {
+		dfpn_free(dfpn);
+		return -1;
+	}
+	dfpn->max_nodes = 0;
+	dfpn->epsilon = DFPN_EPSILON;
+	dfpn->leaf_empties = DFPN_LEAF_EMPTIES;
+	dfpn_clear(dfpn);
+	return 0;
+}
+
+void dfpn_free(dfpn_t *dfpn) {
+	free(dfpn->table);
+	dfpn->table = NULL;
+	dfpn->buckets = 0;
+}
+
+void dfpn_clear(dfpn_t *dfpn) {
+	memset(dfpn->table, 0, dfpn->buckets * DFPN_BUCKET * sizeof(dfpn_entry_t));
+	dfpn->used = 0;
+	dfpn->aborted = 0;
+	dfpn->nodes = 0;
+	dfpn->collections = 0;
+	dfpn->collected = 0;
+}
+
+static dfpn_entry_t *probe(dfpn_t *dfpn, uint64_t key) {
+	dfpn_entry_t *bucket = dfpn->table + (key % dfpn->buckets) * DFPN_BUCKET;
+	int i;
+	for (i = 0; i < DFPN_BUCKET; i++) {
+		if (bucket[i].key == key)
+			return &bucket[i];
+	}
+	return NULL;
+}
+
+static inline int work_class(uint32_t work) {
+	return 31 - __builtin_clz(work | 1);
+}
+
+/* drop the entries with the least work, by powers of two, until enough are gone */
+static void collect(dfpn_t *dfpn) {
+	size_t histogram[32] = { 0 }, target = dfpn->used * (1 - DFPN_GC_KEEP), removed = 0, i;
+	size_t entries = dfpn->buckets * DFPN_BUCKET;
+	int cutoff;
+
+	for (i = 0; i < entries; i++) {
+		if (dfpn->table[i].key)
+			histogram[work_class(dfpn->table[i].work)]++;
+	}
+	for (cutoff = 0; cutoff < 32 && removed < target; cutoff++)
+		removed += histogram[cutoff];
+	for (i = 0; i < entries; i++) {
+		if (dfpn->table[i].key && work_class(dfpn->table[i].work) < cutoff) {
+			dfpn->table[i].key = 0;
+			dfpn->used--;
+		}
+	}
+	dfpn->collected += removed;
+	dfpn->collections++;
+}
+
+static void store(dfpn_t *dfpn, const child_t *node, uint32_t work) {
+	dfpn_entry_t *bucket = dfpn->table + (node->key % dfpn->buckets) * DFPN_BUCKET;
+	dfpn_entry_t *e = NULL, *victim = bucket;
+	int i;
+
+	for (i = 0; i < DFPN_BUCKET; i++) {
+		if (bucket[i].key == node->key) {
+			e = &bucket[i];
+			work = add(e->work, work);
+			break;
+		}
+		if (victim->key != 0 && (bucket[i].key == 0 || bucket[i].work < victim->work))
+			victim = &bucket[i];
+	}
+	if (e == NULL) {
+		e = victim;
+		if (e->key == 0)
+			dfpn->used++;
+	}
+	e->key = node->key;
+	e->pn = node->pn;
+	e->dn = node->dn;
+	e->work = work;
+	e->tree = node->tree;
+	e->best = node->best;
+	if (dfpn->used > dfpn->buckets * DFPN_BUCKET * DFPN_GC_LOAD)
+		collect(dfpn);
+}
+
+/* does the side to move finish above the threshold? plain search, for the last empties */
+static int leaf_wins(dfpn_t *dfpn, search_t *s, int threshold, bool passed) {
+	uint64_t moves = search_moves(s);
+	int win = 0;
+
+	dfpn->nodes++;
+	if (moves == 0) {
+		if (passed)
+			return search_disc_diff(s) > threshold;
+		search_play(s, SEARCH_PASS);
+		win = !leaf_wins(dfpn, s, -threshold - 1, true);
+		search_undo(s);
+		return win;
+	}
+	for (; moves && !win; moves &= moves - 1) {
+		search_play(s, __builtin_ctzll(moves));
+		win = !leaf_wins(dfpn, s, -threshold - 1, false);
+		search_undo(s);
+	}
+	return win;
+}
+
+/* numbers of a node not in the table: exact for leaves, mobility otherwise */
+static int evaluate(dfpn_t *dfpn, search_t *s, int threshold, child_t *node) {
+	uint64_t moves = search_moves(s);
+
+	node->tree = 1;
+	node->best = SEARCH_PASS;
+	if (search_empties(s) <= dfpn->leaf_empties
+		|| (moves == 0 && bb_mobility(s->opp, s->own, s->size) == 0)) {
+		if (leaf_wins(dfpn, s, threshold, false)) {
+			node->pn = 0;
+			node->dn = DFPN_INF;
+		} else {
+			node->pn = DFPN_INF;
+			node->dn = 0;
+		}
+		return 1;
+	}
+	node->pn = 1;
+	node->dn = moves ? __builtin_popcountll(moves) : 1;
+	return 0;
+}
+
+/*
+ * Negamax form: the proof number of a node is the smallest disproof number
+ * of its children and its disproof number the sum of their proof numbers.
+ */
+static void mid(dfpn_t *dfpn, search_t *s, int threshold, uint32_t thpn, uint32_t thdn, child_t *node) {
+	child_t children[DFPN_MAX_MOVES];
+	dfpn_entry_t *e;
+	uint64_t moves = search_moves(s);
+	size_t start = dfpn->nodes;
+	uint32_t dn2, sum, child_thpn, child_thdn;
+	int n = 0, i, best = 0;
+
+	dfpn->nodes++;
+	if (moves == 0)
+		children[n++].square = SEARCH_PASS;
+	for (; moves; moves &= moves - 1)
+		children[n++].square = __builtin_ctzll(moves);
+	for (i = 0; i < n; i++) {
+		search_play(s, children[i].square);
+		children[i].key = node_key(s, -threshold - 1);
+		if ((e = probe(dfpn, children[i].key)) != NULL) {
+			children[i].pn = e->pn;
+			children[i].dn = e->dn;
+			children[i].tree = e->tree;
+			children[i].best = e->best;
+		} else if (evaluate(dfpn, s, -threshold - 1, &children[i])) {
+			store(dfpn, &children[i], 1);
+		}
+		search_undo(s);
+	}
+
+	for (;;) {
+		node->pn = DFPN_INF;
+		dn2 = DFPN_INF;
+		sum = 0;
+		for (i = 0; i < n; i++) {
+			if ((e = probe(dfpn, children[i].key)) != NULL) {
+				children[i].pn = e->pn;
+				children[i].dn = e->dn;
+				children[i].tree = e->tree;
+			}
+			sum = add(sum, children[i].pn);
+			if (children[i].dn < node->pn) {
+				dn2 = node->pn;
+				node->pn = children[i].dn;
+				best = i;
+			} else if (children[i].dn < dn2) {
+				dn2 = children[i].dn;
+			}
+		}
+		node->dn = sum;
+		if (node->pn >= thpn || node->dn >= thdn || dfpn->aborted)
+			break;
+
+		child_thpn = (thdn >= DFPN_INF) ? DFPN_INF : thdn - sum + children[best].pn;
+		child_thdn = add(dn2, 1 + (uint32_t) (dn2 * dfpn->epsilon));
+		child_thdn = (child_thdn < thpn) ? child_thdn : thpn;
+		search_play(s, children[best].square);
+		mid(dfpn, s, -threshold - 1, child_thpn, child_thdn, &children[best]);
+		search_undo(s);
+		if (dfpn->max_nodes && dfpn->nodes >= dfpn->max_nodes)
+			dfpn->aborted = 1;
+	}
+
+	node->best = children[best].square;
+	node->tree = 0;
+	if (node->pn == 0) {
+		node->tree = children[best].tree + 1;
+	} else if (node->dn == 0) {
+		node->tree = 1;
+		for (i = 0; i < n; i++)
+			node->tree = (node->tree + children[i].tree < node->tree) ? UINT32_MAX : node->tree + children[i].tree;
+	}
+	store(dfpn, node, dfpn->nodes - start);
+}
+
+int dfpn_prove(dfpn_t *dfpn, state_t state, int threshold, move_t *move, size_t *tree) {
+	search_t s;
+	child_t root;
+
+	search_init(&s, state);
+	dfpn->aborted = 0;
+	root.key = node_key(&s, threshold);
+	root.square = SEARCH_PASS;
+	mid(dfpn, &s, threshold, DFPN_INF, DFPN_INF, &root);
+	if (move) {
+		*move = search_move(&s, root.best);
+	}
+	if (tree) {
+		*tree = root.tree;
+	}
+	if (root.pn == 0) {
+		return DFPN_PROVEN;
+	} else if (root.dn == 0) {
+		return DFPN_DISPROVEN;
+	}
+	return DFPN_UNKNOWN;
+}
+
+/* a win is a final difference above 0, a draw one above -1 but not 0 */
+int dfpn_solve(dfpn_t *dfpn, state_t state, dfpn_result_t *result) {
+	size_t nodes = dfpn->nodes, collections = dfpn->collections, tree;
+	double start = util_now();
+	int res;
+
+	result->outcome = DFPN_UNKNOWN;
+	res = dfpn_prove(dfpn, state, 0, &result->move, &result->tree);
+	if (res == DFPN_PROVEN) {
+		result->outcome = DFPN_WIN;
+	} else if (res == DFPN_DISPROVEN) {
+		res = dfpn_prove(dfpn, state, -1, &result->move, &tree);
+		result->tree += tree;
+		if (res == DFPN_PROVEN) {
+			result->outcome = DFPN_DRAW;
+		} else if (res == DFPN_DISPROVEN) {
+			result->outcome = DFPN_LOSS;
+		}
+	}
+	result->nodes = dfpn->nodes - nodes;
+	result->collections = dfpn->collections - collections;
+	result->elapsed = util_now() - start;
+	return result->outcome;
+}
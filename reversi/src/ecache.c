@@ -0,0 +1,72 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include "../include/ecache.h"
+
+__thread ecache_t *ecache_local = NULL;
+
+static pthread_key_t owner;
+static pthread_once_t owner_once = PTHREAD_ONCE_INIT;
+static int phases = ECACHE_DEFAULT;
+
+static void owner_init(void) {
+	pthread_key_create(&owner, free);
+}
+
+/* the cache of this thread, freed when the thread exits */
+ecache_t *ecache_create(void) {
+	void *cache;
+
+	if (posix_memalign(&cache, 64, sizeof(ecache_t)) != 0) {
+		return NULL;
+	}
+	memset(cache, 0, sizeof(ecache_t));
+	pthread_once(&owner_once, owner_init);
+	pthread_setspecific(owner, cache);
+	ecache_local = cache;
+	return ecache_local;
+}
+
+void ecache_begin(void) {
+	ecache_t *cache = ecache_local;
+	size_t i;
+
+	if (cache == NULL) {
+		return;
+	}
+	if (++cache->generation == 0) {
+		for (i = 0; i < (1 << ECACHE_BITS); i++)
+			cache->entries[i].flags &= ~ECACHE_VALUE;
+	}
+}
+
+void ecache_clear(void) {
+	uint16_t generation;
+
+	if (ecache_local) {
+		generation = ecache_local->generation;
+		memset(ecache_local->entries, 0, sizeof(ecache_local->entries));
+		ecache_local->generation = generation;
+	}
+}
+
+void ecache_enable(int mask) {
+	__atomic_store_n(&phases, mask & ECACHE_ALL, __ATOMIC_RELAXED);
+}
+
+int ecache_enabled(int phase) {
+	return __atomic_load_n(&phases, __ATOMIC_RELAXED) >> phase & 1;
+}
+
+void ecache_stats(ecache_stats_t *stats) {
+	if (ecache_local) {
+		*stats = ecache_local->stats;
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+void ecache_reset_stats(void) {
+	if (ecache_local) {
+		memset(&ecache_local->stats, 0, sizeof(ecache_local->stats));
+	}
+}
@@ -0,0 +1,691 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include "../include/libreversi.h"
+#include "../include/ponder.h"
+#include "../include/board_io.h"
+#include "../include/pcache.h"
+#include "../include/mcts.h"
+#include "../include/probcut.h"
+#include "../include/solvedb.h"
+#include "../include/nn.h"
+#include "../include/schedule.h"
+#include "../include/util.h"
+
+struct reversi {
+	pthread_mutex_t lock;
+	state_t state;
+	reversi_settings_t settings;
+	tt_table_t tt;
+	mcts_t *tree;
+	reversi_stats_t stats;
+	int stop;
+	double clock[2];
+	char error[128];
+};
+
+/* pondering is process-wide */
+static pthread_mutex_t ponder_lock = PTHREAD_MUTEX_INITIALIZER;
+static reversi_t *ponderer = NULL;
+/* and so is the time schedule, calibrated by the first search on a clock unless loaded */
+static pthread_mutex_t schedule_lock = PTHREAD_MUTEX_INITIALIZER;
+static schedule_t schedule;
+static int schedule_ready = 0;
+
+static const char *messages[] = {
+	"success",
+	"not enough memory",
+	"invalid argument",
+	"cannot open file",
+	"invalid board",
+	"invalid board size",
+	"illegal move",
+	"game over",
+	"search stopped"
+};
+
+static int fail(reversi_t *ctx, int code, const char *format, ...) {
+	va_list ap;
+
+	va_start(ap, format);
+	vsnprintf(ctx->error, sizeof(ctx->error), format, ap);
+	va_end(ap);
+	return code;
+}
+
+static char opponent(char player) {
+	return (player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+}
+
+static uint64_t mobility(state_t state) {
+	bitboard_t b = state.board;
+	return (state.player == BLACK_STONE) ? bb_mobility(b.black, b.white, b.size)
+		: bb_mobility(b.white, b.black, b.size);
+}
+
+static int square(move_t move, size_t size) {
+	return one_dimension(move.row, move.column, size);
+}
+
+static move_t to_move(int square, size_t size) {
+	move_t move;
+	move.row = square % size;
+	move.column = square / size;
+	return move;
+}
+
+static int check_settings(const reversi_settings_t *s) {
+	if (s->engine != REVERSI_ALPHABETA && s->engine != REVERSI_MCTS) {
+		return -1;
+	}
+	if (s->evaluator < REVERSI_EVAL_AUTO || s->evaluator > REVERSI_EVAL_NETWORK) {
+		return -1;
+	}
+	if (s->depth < 1 || s->endgame_empties < 0 || s->playouts < 1) {
+		return -1;
+	}
+	if (s->threads < 1 || s->threads > MCTS_MAX_THREADS || s->tt_bits < 1 || s->tt_bits > 30) {
+		return -1;
+	}
+	if (s->clock_ms < 0) {
+		return -1;
+	}
+	return 0;
+}
+
+static void reset_clock(reversi_t *ctx) {
+	ctx->clock[0] = ctx->clock[1] = ctx->settings.clock_ms * 1e-3;
+}
+
+/* a new table when the size changes, and the MCTS tree follows the settings */
+static int apply_settings(reversi_t *ctx, const reversi_settings_t *settings) {
+	tt_table_t tt;
+
+	if (check_settings(settings) != 0) {
+		return fail(ctx, REVERSI_ERR_ARGUMENT, "invalid settings");
+	}
+	if (ctx->tt.slots == NULL || ctx->tt.mask != ((uint64_t) 1 << settings->tt_bits) - 1) {
+		if (tt_table_init(&tt, settings->tt_bits) != 0) {
+			return fail(ctx, REVERSI_ERR_MEMORY, "cannot allocate a table of 2^%d entries",
+				settings->tt_bits);
+		}
+		/* pondering fills the table of its context */
+		pthread_mutex_lock(&ponder_lock);
+		if (ponderer == ctx) {
+			ponder_stop();
+			ponderer = NULL;
+		}
+		pthread_mutex_unlock(&ponder_lock);
+		tt_table_free(&ctx->tt);
+		ctx->tt = tt;
+	}
+	if (ctx->tree) {
+		mcts_set_threads(ctx->tree, settings->threads);
+		if (settings->seed) {
+			mcts_set_deterministic(ctx->tree, settings->seed);
+		} else {
+			ctx->tree->deterministic = 0;
+		}
+	}
+	if (settings->clock_ms != ctx->settings.clock_ms) {
+		ctx->settings.clock_ms = settings->clock_ms;
+		reset_clock(ctx);
+	}
+	ctx->settings = *settings;
+	return REVERSI_OK;
+}
+
+void reversi_default_settings(reversi_settings_t *settings) {
+	settings->engine = REVERSI_ALPHABETA;
+	settings->evaluator = REVERSI_EVAL_AUTO;
+	settings->depth = AI_DEPTH;
+	settings->endgame_empties = ENDGAME_EMPTIES;
+	settings->playouts = MCTS_PLAYOUTS;
+	settings->threads = 1;
+	settings->seed = 0;
+	settings->tt_bits = TT_DEFAULT_BITS;
+	settings->clock_ms = 0;
+}
+
+int reversi_new(reversi_t **ctx, int size, const reversi_settings_t *settings) {
+	reversi_settings_t defaults;
+	reversi_t *c;
+	int res;
+
+	*ctx = NULL;
+	if (size < MIN_BOARD_SIZE || size > MAX_BOARD_SIZE || size % 2) {
+		return REVERSI_ERR_SIZE;
+	}
+	c = calloc(1, sizeof(reversi_t));
+	if (c == NULL) {
+		return REVERSI_ERR_MEMORY;
+	}
+	if (settings == NULL) {
+		reversi_default_settings(&defaults);
+		settings = &defaults;
+	}
+	if ((res = apply_settings(c, settings)) != REVERSI_OK) {
+		free(c);
+		return res;
+	}
+	pthread_mutex_init(&c->lock, NULL);
+	c->state.board = bb_init(size);
+	c->state.player = BLACK_STONE;
+	*ctx = c;
+	return REVERSI_OK;
+}
+
+void reversi_free(reversi_t *ctx) {
+	if (ctx == NULL) {
+		return;
+	}
+	reversi_ponder(ctx, 0);
+	if (ctx->tree) {
+		mcts_free(ctx->tree);
+		free(ctx->tree);
+	}
+	tt_table_free(&ctx->tt);
+	pthread_mutex_destroy(&ctx->lock);
+	free(ctx);
+}
+
+int reversi_configure(reversi_t *ctx, const reversi_settings_t *settings) {
+	int res;
+
+	pthread_mutex_lock(&ctx->lock);
+	res = apply_settings(ctx, settings);
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+int reversi_reset(reversi_t *ctx, int size) {
+	int res = REVERSI_OK;
+
+	pthread_mutex_lock(&ctx->lock);
+	if (size < MIN_BOARD_SIZE || size > MAX_BOARD_SIZE || size % 2) {
+		res = fail(ctx, REVERSI_ERR_SIZE, "board size must be even, from %d to %d",
+			MIN_BOARD_SIZE, MAX_BOARD_SIZE);
+	} else {
+		ctx->state.board = bb_init(size);
+		ctx->state.player = BLACK_STONE;
+		memset(ctx->tt.slots, 0, (ctx->tt.mask + 1) * sizeof(tt_slot_t));
+		reset_clock(ctx);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+int reversi_load(reversi_t *ctx, const char *text, size_t length) {
+	board_reader_t reader;
+	state_t state;
+	const char *message;
+	int res;
+
+	board_reader_init(&reader, text, length);
+	res = board_read(&reader, &state);
+	pthread_mutex_lock(&ctx->lock);
+	if (res == BOARD_ERROR) {
+		/* without the "reversi: error" prefix of the reader's messages */
+		message = reader.error;
+		if (strncmp(message, "reversi: error", 14) == 0) {
+			message += 14 + (message[14] == ':');
+			message += message[0] == ' ';
+		}
+		res = fail(ctx, REVERSI_ERR_FORMAT, "%s", message);
+	} else if (res == BOARD_END) {
+		res = fail(ctx, REVERSI_ERR_FORMAT, "no board found");
+	} else {
+		ctx->state = state;
+		reset_clock(ctx);
+		res = REVERSI_OK;
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+int reversi_load_file(reversi_t *ctx, const char *filename) {
+	board_file_t file;
+	int res;
+
+	if (board_file_open(filename, &file) != 0) {
+		pthread_mutex_lock(&ctx->lock);
+		res = fail(ctx, REVERSI_ERR_FILE, "cannot open '%s'", filename);
+		pthread_mutex_unlock(&ctx->lock);
+		return res;
+	}
+	res = reversi_load(ctx, file.data, file.length);
+	board_file_close(&file);
+	return res;
+}
+
+int reversi_write(reversi_t *ctx, FILE *f) {
+	int res;
+
+	pthread_mutex_lock(&ctx->lock);
+	res = board_write(f, ctx->state) == 0 ? REVERSI_OK
+		: fail(ctx, REVERSI_ERR_FILE, "cannot write the board");
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+void reversi_print(reversi_t *ctx) {
+	pthread_mutex_lock(&ctx->lock);
+	bb_print(ctx->state.board);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+int reversi_position(reversi_t *ctx, uint64_t *black, uint64_t *white, char *player, int *size) {
+	pthread_mutex_lock(&ctx->lock);
+	*black = ctx->state.board.black;
+	*white = ctx->state.board.white;
+	*player = ctx->state.player;
+	*size = ctx->state.board.size;
+	pthread_mutex_unlock(&ctx->lock);
+	return REVERSI_OK;
+}
+
+int reversi_moves(reversi_t *ctx, int *squares, int max) {
+	uint64_t moves;
+	int n = 0;
+
+	pthread_mutex_lock(&ctx->lock);
+	for (moves = mobility(ctx->state); moves && n < max; moves &= moves - 1) {
+		squares[n++] = __builtin_ctzll(moves);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return n;
+}
+
+static int game_over(state_t state) {
+	state_t other = state;
+	other.player = opponent(state.player);
+	return mobility(state) == 0 && mobility(other) == 0;
+}
+
+int reversi_game_over(reversi_t *ctx) {
+	int res;
+
+	pthread_mutex_lock(&ctx->lock);
+	res = game_over(ctx->state);
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+int reversi_play(reversi_t *ctx, int sq) {
+	uint64_t moves;
+	size_t size;
+	int res = REVERSI_OK;
+
+	pthread_mutex_lock(&ctx->lock);
+	size = ctx->state.board.size;
+	moves = mobility(ctx->state);
+	if (game_over(ctx->state)) {
+		res = fail(ctx, REVERSI_ERR_GAME_OVER, "the game is over");
+	} else if (sq == REVERSI_PASS ? moves != 0
+			: sq < 0 || sq >= (int) (size * size) || !get_bit(moves, sq)) {
+		res = fail(ctx, REVERSI_ERR_ILLEGAL, "illegal move for '%c'", ctx->state.player);
+	} else {
+		if (sq != REVERSI_PASS) {
+			ctx->state.board = bb_move(to_move(sq, size), ctx->state);
+		}
+		ctx->state.player = opponent(ctx->state.player);
+		ctx->stats.moves++;
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+int reversi_score(reversi_t *ctx, int *black, int *white) {
+	score_t score;
+
+	pthread_mutex_lock(&ctx->lock);
+	score = bb_score(ctx->state.board);
+	pthread_mutex_unlock(&ctx->lock);
+	*black = score.black;
+	*white = score.white;
+	return REVERSI_OK;
+}
+
+static int (*evaluator(const reversi_settings_t *s, size_t size)) (state_t state) {
+	switch (s->evaluator) {
+		case REVERSI_EVAL_COIN_PARITY:
+			return coin_parity_heuristic;
+		case REVERSI_EVAL_SCORE:
+			return score_heuristic;
+		case REVERSI_EVAL_NETWORK:
+			return nn_ready(size) ? nn_heuristic : NULL;
+		case REVERSI_EVAL_STABILITY:
+			return stability_heuristic;
+	}
+	return nn_ready(size) ? nn_heuristic : stability_heuristic;
+}
+
+/* stops pondering for ctx; a response is only used by an alpha-beta search of depth with heuristic */
+static int pondered(reversi_t *ctx, int use, int depth, int (*heuristic) (state_t state), move_t *move) {
+	int hit = 0;
+
+	pthread_mutex_lock(&ponder_lock);
+	if (ponderer == ctx) {
+		ponder_stop();
+		ponderer = NULL;
+		hit = use && ponder_lookup(ctx->state, depth, heuristic, move);
+	}
+	pthread_mutex_unlock(&ponder_lock);
+	return hit;
+}
+
+/* the same choices as ai_player(), with the settings and tables of the context, or the plan of a clock */
+static int search(reversi_t *ctx, const schedule_plan_t *plan, reversi_result_t *r) {
+	state_t state = ctx->state;
+	size_t size = state.board.size;
+	int (*heuristic) (state_t state) = evaluator(&ctx->settings, size);
+	move_t move, response;
+	algo_t best;
+	uint64_t moves;
+	int empties = bb_empties(state.board);
+	int solving = plan ? plan->solve : empties <= ctx->settings.endgame_empties;
+	int depth = plan ? plan->depth : ctx->settings.depth;
+	int playouts = plan ? INT_MAX : ctx->settings.playouts;
+	int hit;
+
+	r->score = 0;
+	r->depth = 0;
+	r->stopped = 0;
+	r->nodes = 0;
+	r->tree_nodes = 0;
+	r->tree_reused = 0;
+	if (game_over(state)) {
+		return fail(ctx, REVERSI_ERR_GAME_OVER, "the game is over");
+	}
+	if (mobility(state) == 0) {
+		r->square = REVERSI_PASS;
+		r->source = REVERSI_SOURCE_SEARCH;
+		return REVERSI_OK;
+	}
+	hit = pondered(ctx, !solving && ctx->settings.engine == REVERSI_ALPHABETA && heuristic != NULL, depth, heuristic,
+		&response);
+	if (solvedb_move(state, &move, &r->score)) {
+		r->source = REVERSI_SOURCE_DATABASE;
+	} else if (hit) {
+		move = response;
+		r->depth = depth;
+		r->source = REVERSI_SOURCE_PONDER;
+		ctx->stats.ponder_hits++;
+	} else if (solving) {
+		move = ai_solve(state, &r->score);
+		r->source = REVERSI_SOURCE_SOLVE;
+		r->stopped = bb_search_stopped();
+		r->depth = r->stopped ? 0 : empties;
+		r->nodes = bb_search_nodes();
+		ctx->stats.solved++;
+	} else if (ctx->settings.engine == REVERSI_MCTS) {
+		if (ctx->tree == NULL) {
+			ctx->tree = malloc(sizeof(mcts_t));
+			if (ctx->tree == NULL || mcts_init(ctx->tree, MCTS_MEMORY, 0x9e3779b97f4a7c15ULL) != 0) {
+				free(ctx->tree);
+				ctx->tree = NULL;
+				return fail(ctx, REVERSI_ERR_MEMORY, "cannot allocate the MCTS tree");
+			}
+			apply_settings(ctx, &ctx->settings);
+		}
+		move = mcts_search(ctx->tree, state, playouts);
+		r->source = REVERSI_SOURCE_MCTS;
+		r->nodes = ctx->tree->playouts;
+		r->tree_nodes = ctx->tree->used - 2;
+		r->tree_reused = ctx->tree->reused;
+		/* on a clock, MCTS always runs until its time */
+		r->stopped = plan == NULL && r->nodes < (size_t) playouts;
+	} else {
+		if (heuristic == NULL) {
+			return fail(ctx, REVERSI_ERR_ARGUMENT, "no network for %zux%zu boards", size, size);
+		}
+		best = bb_deepening_search(state, depth, heuristic, &r->depth);
+		move = best.move;
+		r->score = best.v;
+		r->source = REVERSI_SOURCE_SEARCH;
+		r->stopped = r->depth < depth;
+		r->nodes = bb_search_nodes();
+	}
+	/* stopped before any move was searched */
+	if (move.row >= size || move.column >= size) {
+		moves = mobility(state);
+		move = to_move(__builtin_ctzll(moves), size);
+	}
+	r->square = square(move, size);
+	return REVERSI_OK;
+}
+
+/* on the table of the caller, with the evaluation of the default settings */
+static void calibrate(double seconds) {
+	tt_table_t tt;
+
+	if (tt_table_init(&tt, TT_DEFAULT_BITS) != 0) {
+		schedule_default(&schedule);
+	} else {
+		tt_use(&tt);
+		schedule_calibrate(&schedule, seconds, nn_ready(8) ? nn_heuristic : stability_heuristic);
+		tt_use(NULL);
+		tt_table_free(&tt);
+	}
+	schedule_ready = 1;
+}
+
+/* the plan of the side to move, and the time the search is stopped after */
+static double plan_search(reversi_t *ctx, schedule_plan_t *plan, double *planned) {
+	state_t state = ctx->state;
+
+	pthread_mutex_lock(&schedule_lock);
+	if (!schedule_ready) {
+		calibrate(SCHEDULE_CALIBRATION);
+	}
+	schedule_plan(&schedule, state, ctx->clock[state.player != BLACK_STONE], SCHEDULE_MAX_DEPTH, plan);
+	*planned = plan->solve ? plan->budget : schedule_search_time(&schedule, state, plan->depth);
+	pthread_mutex_unlock(&schedule_lock);
+	if (ctx->settings.engine == REVERSI_MCTS && !plan->solve) {
+		*planned = plan->budget;
+		return plan->budget;
+	}
+	return plan->limit;
+}
+
+int reversi_search(reversi_t *ctx, reversi_result_t *result) {
+	schedule_plan_t plan;
+	watchdog_t w;
+	double start, planned = 0, limit = 0;
+	int res, side, timed = 0;
+
+	pthread_mutex_lock(&ctx->lock);
+	side = ctx->state.player != BLACK_STONE;
+	if (ctx->settings.clock_ms > 0) {
+		limit = plan_search(ctx, &plan, &planned);
+	}
+	start = util_now();
+	if (limit > 0) {
+		timed = watchdog_start(&w, limit, &ctx->stop) == 0;
+	}
+	tt_use(&ctx->tt);
+	bb_search_flag(&ctx->stop);
+	res = search(ctx, limit > 0 ? &plan : NULL, result);
+	bb_search_flag(NULL);
+	tt_use(NULL);
+	if (timed) {
+		watchdog_stop(&w);
+	}
+	__atomic_store_n(&ctx->stop, 0, __ATOMIC_RELAXED);
+	result->elapsed = util_now() - start;
+	result->planned = planned;
+	if (limit > 0 && res == REVERSI_OK) {
+		ctx->clock[side] -= result->elapsed;
+	}
+	if (res == REVERSI_OK) {
+		ctx->stats.searches++;
+		ctx->stats.nodes += result->nodes;
+		ctx->stats.elapsed += result->elapsed;
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+typedef struct {
+	reversi_report_t report;
+	void *arg;
+	reversi_analysis_t *result;
+	size_t size;
+	double start;
+} analysis_sink_t;
+
+/* called by bb_analyze() after every completed depth */
+static void analysis_report(const analysis_t *a, void *arg) {
+	analysis_sink_t *sink = arg;
+	reversi_analysis_t *r = sink->result;
+	int i, j;
+
+	r->depth = a->depth;
+	r->solved = a->solved;
+	r->num_lines = a->num_lines;
+	r->nodes = a->nodes;
+	r->elapsed = util_now() - sink->start;
+	for (i = 0; i < a->num_lines; i++) {
+		r->lines[i].square = square(a->lines[i].move, sink->size);
+		r->lines[i].score = a->lines[i].score;
+		r->lines[i].bound = a->lines[i].bound;
+		r->lines[i].pv_length = a->lines[i].pv_length;
+		for (j = 0; j < a->lines[i].pv_length; j++) {
+			r->lines[i].pv[j] = square(a->lines[i].pv[j], sink->size);
+		}
+	}
+	if (sink->report) {
+		sink->report(r, sink->arg);
+	}
+}
+
+int reversi_analyze(reversi_t *ctx, int depth, int lines, reversi_report_t report, void *arg,
+		reversi_analysis_t *result) {
+	int (*heuristic) (state_t state);
+	analysis_sink_t sink = { report, arg, result, ctx->state.board.size, util_now() };
+	analysis_t a;
+	int res = REVERSI_OK;
+
+	pthread_mutex_lock(&ctx->lock);
+	memset(result, 0, sizeof(*result));
+	if (game_over(ctx->state)) {
+		res = fail(ctx, REVERSI_ERR_GAME_OVER, "the game is over");
+	} else if ((heuristic = evaluator(&ctx->settings, sink.size)) == NULL) {
+		res = fail(ctx, REVERSI_ERR_ARGUMENT, "no network for %zux%zu boards", sink.size, sink.size);
+	} else if (mobility(ctx->state) != 0) {
+		tt_use(&ctx->tt);
+		bb_search_flag(&ctx->stop);
+		bb_analyze(ctx->state, depth > 0 ? depth : ctx->settings.depth, lines, ctx->settings.endgame_empties,
+			heuristic, analysis_report, &sink, &a);
+		bb_search_flag(NULL);
+		tt_use(NULL);
+		if (__atomic_exchange_n(&ctx->stop, 0, __ATOMIC_RELAXED) && result->depth == 0) {
+			res = fail(ctx, REVERSI_ERR_STOPPED, "analysis stopped");
+		}
+		ctx->stats.searches++;
+		ctx->stats.nodes += bb_search_nodes();
+		ctx->stats.elapsed += util_now() - sink.start;
+	}
+	pthread_mutex_unlock(&ctx->lock);
+	return res;
+}
+
+/* think about the replies of the side to move until the next search */
+int reversi_ponder(reversi_t *ctx, int on) {
+	int (*heuristic) (state_t state);
+	state_t state;
+
+	pthread_mutex_lock(&ctx->lock);
+	state = ctx->state;
+	heuristic = evaluator(&ctx->settings, state.board.size);
+	pthread_mutex_unlock(&ctx->lock);
+	pthread_mutex_lock(&ponder_lock);
+	if (ponderer == ctx || (on && ponderer)) {
+		ponder_stop();
+		ponderer = NULL;
+	}
+	if (on && heuristic && !game_over(state)) {
+		ponder_start(state, heuristic, &ctx->tt);
+		ponderer = ctx;
+	}
+	pthread_mutex_unlock(&ponder_lock);
+	return REVERSI_OK;
+}
+
+void reversi_stop(reversi_t *ctx) {
+	__atomic_store_n(&ctx->stop, 1, __ATOMIC_RELAXED);
+}
+
+void reversi_clear_stop(reversi_t *ctx) {
+	__atomic_store_n(&ctx->stop, 0, __ATOMIC_RELAXED);
+}
+
+int reversi_clock(reversi_t *ctx, double *black, double *white) {
+	pthread_mutex_lock(&ctx->lock);
+	*black = ctx->clock[0];
+	*white = ctx->clock[1];
+	pthread_mutex_unlock(&ctx->lock);
+	return REVERSI_OK;
+}
+
+int reversi_stats(reversi_t *ctx, reversi_stats_t *stats) {
+	pthread_mutex_lock(&ctx->lock);
+	*stats = ctx->stats;
+	pthread_mutex_unlock(&ctx->lock);
+	return REVERSI_OK;
+}
+
+const char *reversi_error(reversi_t *ctx) {
+	return ctx->error;
+}
+
+const char *reversi_strerror(int code) {
+	if (code > 0 || code < REVERSI_ERR_STOPPED) {
+		return "unknown error";
+	}
+	return messages[-code];
+}
+
+int reversi_load_network(const char *filename) {
+	return nn_load(filename) == 0 ? REVERSI_OK : REVERSI_ERR_FILE;
+}
+
+int reversi_load_probcut(const char *filename) {
+	return probcut_load(filename) == 0 ? REVERSI_OK : REVERSI_ERR_FILE;
+}
+
+int reversi_open_database(const char *filename) {
+	return solvedb_open(filename) == 0 ? REVERSI_OK : REVERSI_ERR_FILE;
+}
+
+int reversi_open_cache(const char *filename) {
+	return pcache_open(filename) == 0 ? REVERSI_OK : REVERSI_ERR_FILE;
+}
+
+void reversi_close_cache(void) {
+	pcache_close();
+}
+
+int reversi_load_schedule(const char *filename) {
+	schedule_t loaded;
+
+	if (schedule_load(filename, &loaded) != 0) {
+		return REVERSI_ERR_FILE;
+	}
+	pthread_mutex_lock(&schedule_lock);
+	schedule = loaded;
+	schedule_ready = 1;
+	pthread_mutex_unlock(&schedule_lock);
+	return REVERSI_OK;
+}
+
+int reversi_calibrate(double seconds) {
+	if (seconds <= 0) {
+		return REVERSI_ERR_ARGUMENT;
+	}
+	pthread_mutex_lock(&schedule_lock);
+	calibrate(seconds);
+	pthread_mutex_unlock(&schedule_lock);
+	return REVERSI_OK;
+}
@@ -0,0 +1,430 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "../include/mcts.h"
+#include "../include/util.h"
+
+#define MCTS_MAX_PATH 128
+
+typedef struct {
+	uint64_t own;
+	uint64_t opp;
+	char player;
+} position_t;
+
+typedef struct {
+	mcts_t *tree;
+	int *stop;
+	size_t done;
+	uint64_t rng;
+	position_t pos;
+	int depth;
+	uint32_t path[MCTS_MAX_PATH];
+	char movers[MCTS_MAX_PATH];
+} worker_t;
+
+static inline uint64_t rng_next(uint64_t *s) {
+	uint64_t x = *s;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*s = x;
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+static position_t position_of(state_t state) {
+	position_t pos;
+	pos.player = state.player;
+	pos.own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	pos.opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	return pos;
+}
+
+static inline void play(position_t *pos, int sq, size_t size) {
+	uint64_t flips, tmp;
+	if (sq != MCTS_PASS) {
+		flips = bb_flips(pos->own, pos->opp, sq, size);
+		pos->own |= flips | (uint64_t) 1 << sq;
+		pos->opp &= ~flips;
+	}
+	tmp = pos->own;
+	pos->own = pos->opp;
+	pos->opp = tmp;
+	pos->player = (pos->player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+}
+
+static int same_position(position_t a, position_t b) {
+	return a.own == b.own && a.opp == b.opp && a.player == b.player;
+}
+
+int mcts_init(mcts_t *tree, size_t megabytes, uint64_t seed) {
+	tree->capacity = (megabytes << 20) / 2 / sizeof(mcts_node_t);
+	tree->arena[0] = malloc(tree->capacity * sizeof(mcts_node_t));
+	tree->arena[1] = malloc(tree->capacity * sizeof(mcts_node_t));
+	if (tree->arena[0] == NULL || tree->arena[1] == NULL || tree->capacity < 2) {
+		mcts_free(tree);
+		return -1;
+	}
+	tree->current = 0;
+	tree->used = 0;
+	tree->rng = seed ? seed : 1;
+	tree->threads = 1;
+	tree->deterministic = 0;
+	tree->playouts = 0;
+	tree->reused = 0;
+	tree->elapsed = 0;
+	return 0;
+}
+
+void mcts_free(mcts_t *tree) {
+	free(tree->arena[0]);
+	free(tree->arena[1]);
+	tree->arena[0] = tree->arena[1] = NULL;
+	tree->used = tree->capacity = 0;
+}
+
+void mcts_set_threads(mcts_t *tree, int threads) {
+	if (threads < 1) {
+		threads = 1;
+	} else if (threads > MCTS_MAX_THREADS) {
+		threads = MCTS_MAX_THREADS;
+	}
+	tree->threads = threads;
+}
+
+void mcts_set_deterministic(mcts_t *tree, uint64_t seed) {
+	tree->rng = seed ? seed : 1;
+	tree->deterministic = 1;
+}
+
+static void reset(mcts_t *tree, state_t state) {
+	mcts_node_t *nodes = tree->arena[tree->current];
+	memset(&nodes[1], 0, sizeof(mcts_node_t));
+	nodes[1].move = MCTS_PASS;
+	tree->used = 2;
+	tree->root_state = state;
+	tree->reused = 0;
+}
+
+/* copy the subtree under index from into the other arena, breadth first */
+static void relocate(mcts_t *tree, uint32_t from, state_t state) {
+	mcts_node_t *src = tree->arena[tree->current], *dst = tree->arena[1 - tree->current];
+	uint32_t i, used = 2;
+
+	dst[1] = src[from];
+	for (i = 1; i < used; i++) {
+		if (dst[i].num_children && dst[i].children) {
+			memcpy(&dst[used], &src[dst[i].children], dst[i].num_children * sizeof(mcts_node_t));
+			dst[i].children = used;
+			used += dst[i].num_children;
+		}
+	}
+	tree->current = 1 - tree->current;
+	tree->used = used;
+	tree->root_state = state;
+	tree->reused = used - 2;
+}
+
+/* keep the part of the previous tree the game actually went through */
+static void reuse(mcts_t *tree, state_t state) {
+	mcts_node_t *nodes = tree->arena[tree->current];
+	position_t target = position_of(state), pos, pos2;
+	size_t size = state.board.size;
+	uint32_t c, g;
+
+	if (tree->used < 2 || tree->root_state.board.size != size) {
+		reset(tree, state);
+		return;
+	}
+	pos = position_of(tree->root_state);
+	if (same_position(pos, target)) {
+		tree->reused = tree->used - 2;
+		return;
+	}
+	for (c = 0; nodes[1].children && c < nodes[1].num_children; c++) {
+		mcts_node_t *child = &nodes[nodes[1].children + c];
+		pos2 = pos;
+		play(&pos2, child->move, size);
+		if (same_position(pos2, target)) {
+			relocate(tree, nodes[1].children + c, state);
+			return;
+		}
+		for (g = 0; child->children && g < child->num_children; g++) {
+			position_t pos3 = pos2;
+			play(&pos3, nodes[child->children + g].move, size);
+			if (same_position(pos3, target)) {
+				relocate(tree, child->children + g, state);
+				return;
+			}
+		}
+	}
+	reset(tree, state);
+}
+
+/* reserve n contiguous nodes, 0 if the arena is full */
+static uint32_t reserve(mcts_t *tree, int n) {
+	uint32_t used = __atomic_load_n(&tree->used, __ATOMIC_RELAXED);
+	do {
+		if (used + n > tree->capacity) {
+			return 0;
+		}
+	} while (!__atomic_compare_exchange_n(&tree->used, &used, used + n, 1,
+		__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return used;
+}
+
+/* only called by the thread that set MCTS_EXPANDING on the node */
+static int expand(mcts_t *tree, uint32_t index, position_t pos, size_t size) {
+	mcts_node_t *nodes = tree->arena[tree->current], *node = &nodes[index];
+	uint64_t moves = bb_mobility(pos.own, pos.opp, size);
+	uint32_t first;
+	int n, i;
+
+	if (moves == 0) {
+		if (bb_mobility(pos.opp, pos.own, size) == 0) {
+			/* game over, nothing to expand */
+			return 1;
+		}
+		n = 1;
+	} else {
+		n = __builtin_popcountll(moves);
+	}
+	first = reserve(tree, n);
+	if (first == 0) {
+		return 0;
+	}
+	for (i = 0; i < n; i++) {
+		mcts_node_t *child = &nodes[first + i];
+		memset(child, 0, sizeof(mcts_node_t));
+		if (moves) {
+			child->move = __builtin_ctzll(moves);
+			moves &= moves - 1;
+		} else {
+			child->move = MCTS_PASS;
+		}
+	}
+	node->children = first;
+	node->num_children = n;
+	return 1;
+}
+
+static uint32_t select_child(const mcts_t *tree, const mcts_node_t *node) {
+	const mcts_node_t *nodes = tree->arena[tree->current];
+	uint32_t i, visits, wins, best_index = node->children;
+	double best = -1, value;
+	double log_visits = log((double) __atomic_load_n(&node->visits, __ATOMIC_RELAXED) + 1);
+
+	for (i = node->children; i < node->children + node->num_children; i++) {
+		visits = __atomic_load_n(&nodes[i].visits, __ATOMIC_RELAXED);
+		if (visits == 0) {
+			return i;
+		}
+		wins = __atomic_load_n(&nodes[i].wins, __ATOMIC_RELAXED);
+		value = wins / (2.0 * visits) + MCTS_EXPLORATION * sqrt(log_visits / visits);
+		if (value > best) {
+			best = value;
+			best_index = i;
+		}
+	}
+	return best_index;
+}
+
+/* random game to the end, returns the winner's stone or 0 for a draw */
+static char playout(position_t pos, size_t size, uint64_t *rng) {
+	uint64_t moves;
+	int n, black, white, passes = 0;
+
+	while (passes < 2) {
+		moves = bb_mobility(pos.own, pos.opp, size);
+		if (moves == 0) {
+			play(&pos, MCTS_PASS, size);
+			passes++;
+			continue;
+		}
+		passes = 0;
+		for (n = rng_next(rng) % __builtin_popcountll(moves); n > 0; n--) {
+			moves &= moves - 1;
+		}
+		play(&pos, __builtin_ctzll(moves), size);
+	}
+	black = __builtin_popcountll(pos.player == BLACK_STONE ? pos.own : pos.opp);
+	white = __builtin_popcountll(pos.player == BLACK_STONE ? pos.opp : pos.own);
+	if (black == white) {
+		return 0;
+	}
+	return black > white ? BLACK_STONE : WHITE_STONE;
+}
+
+static void enter(worker_t *w, uint32_t index, size_t size) {
+	mcts_node_t *nodes = w->tree->arena[w->tree->current];
+	__atomic_add_fetch(&nodes[index].visits, 1, __ATOMIC_RELAXED);
+	w->movers[++w->depth] = w->pos.player;
+	w->path[w->depth] = index;
+	play(&w->pos, nodes[index].move, size);
+}
+
+/* walk down to a leaf, counting each visit as a loss until backup() */
+static void descend(worker_t *w) {
+	mcts_t *tree = w->tree;
+	mcts_node_t *nodes = tree->arena[tree->current];
+	size_t size = tree->root_state.board.size;
+	uint32_t index = 1;
+	uint8_t flags;
+
+	w->pos = position_of(tree->root_state);
+	w->depth = 0;
+	w->path[0] = 1;
+	w->movers[0] = 0;
+	__atomic_add_fetch(&nodes[1].visits, 1, __ATOMIC_RELAXED);
+	while (w->depth + 1 < MCTS_MAX_PATH) {
+		flags = __atomic_load_n(&nodes[index].flags, __ATOMIC_ACQUIRE);
+		if (flags & MCTS_EXPANDED) {
+			if (nodes[index].num_children == 0) {
+				return;
+			}
+			index = select_child(tree, &nodes[index]);
+			enter(w, index, size);
+			continue;
+		}
+		if ((flags & MCTS_EXPANDING) || !__atomic_compare_exchange_n(&nodes[index].flags,
+				&flags, flags | MCTS_EXPANDING, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			/* someone else is expanding this leaf, play out from here */
+			return;
+		}
+		if (!expand(tree, index, w->pos, size)) {
+			__atomic_store_n(&nodes[index].flags, flags, __ATOMIC_RELEASE);
+			return;
+		}
+		__atomic_store_n(&nodes[index].flags, flags | MCTS_EXPANDED, __ATOMIC_RELEASE);
+		if (nodes[index].num_children) {
+			enter(w, select_child(tree, &nodes[index]), size);
+		}
+		return;
+	}
+}
+
+static void backup(worker_t *w, char winner) {
+	mcts_node_t *nodes = w->tree->arena[w->tree->current];
+	int depth;
+	for (depth = w->depth; depth >= 0; depth--) {
+		if (winner == 0) {
+			__atomic_add_fetch(&nodes[w->path[depth]].wins, 1, __ATOMIC_RELAXED);
+		} else if (winner == w->movers[depth]) {
+			__atomic_add_fetch(&nodes[w->path[depth]].wins, 2, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static void *work(void *arg) {
+	worker_t *w = arg;
+	mcts_t *tree = w->tree;
+	size_t size = tree->root_state.board.size;
+
+	/* the stop flag of the caller, so that stopping it stops every worker */
+	bb_search_flag(w->stop);
+	while (__atomic_fetch_add(&tree->issued, 1, __ATOMIC_RELAXED) < tree->playouts && !bb_search_stopped()) {
+		descend(w);
+		backup(w, playout(w->pos, size, &w->rng));
+		w->done++;
+	}
+	return NULL;
+}
+
+/* same tree policy as the threaded search, one worker after the other */
+static void lockstep(mcts_t *tree, worker_t *workers, int threads) {
+	size_t size = tree->root_state.board.size, done = 0;
+	char winners[MCTS_MAX_THREADS];
+	int i, n;
+
+	while (done < tree->playouts && !bb_search_stopped()) {
+		n = (tree->playouts - done < (size_t) threads) ? (int) (tree->playouts - done) : threads;
+		for (i = 0; i < n; i++) {
+			descend(&workers[i]);
+		}
+		for (i = 0; i < n; i++) {
+			winners[i] = playout(workers[i].pos, size, &workers[i].rng);
+		}
+		for (i = 0; i < n; i++) {
+			backup(&workers[i], winners[i]);
+		}
+		done += n;
+	}
+	workers[0].done = done;
+}
+
+move_t mcts_search(mcts_t *tree, state_t state, int playouts) {
+	worker_t workers[MCTS_MAX_THREADS];
+	pthread_t ids[MCTS_MAX_THREADS];
+	mcts_node_t *nodes, *root;
+	move_t move;
+	uint32_t i, best = 0, best_visits = 0;
+	double start = util_now();
+	int t, started = 1;
+
+	reuse(tree, state);
+	tree->playouts = playouts;
+	tree->issued = 0;
+	for (t = 0; t < tree->threads; t++) {
+		workers[t].tree = tree;
+		workers[t].stop = bb_search_current_flag();
+		workers[t].done = 0;
+		workers[t].rng = rng_next(&tree->rng) | 1;
+	}
+	if (tree->deterministic) {
+		lockstep(tree, workers, tree->threads);
+	} else {
+		for (t = 1; t < tree->threads; t++) {
+			if (pthread_create(&ids[t], NULL, work, &workers[t]) != 0) {
+				break;
+			}
+			started++;
+		}
+		work(&workers[0]);
+		for (t = 1; t < started; t++) {
+			pthread_join(ids[t], NULL);
+		}
+	}
+	tree->elapsed = util_now() - start;
+	for (tree->playouts = 0, t = 0; t < tree->threads; t++) {
+		tree->playouts += workers[t].done;
+	}
+
+	nodes = tree->arena[tree->current];
+	root = &nodes[1];
+	move.row = move.column = -1;
+	for (i = root->children; root->children && i < root->children + root->num_children; i++) {
+		if (nodes[i].visits > best_visits) {
+			best_visits = nodes[i].visits;
+			best = i;
+		}
+	}
+	if (best && nodes[best].move != MCTS_PASS) {
+		move.row = nodes[best].move % state.board.size;
+		move.column = nodes[best].move / state.board.size;
+	}
+	return move;
+}
+
+static mcts_t default_tree;
+static int default_ready = 0;
+
+mcts_t *mcts_default(void) {
+	if (!default_ready) {
+		if (mcts_init(&default_tree, MCTS_MEMORY, 0x9e3779b97f4a7c15ULL) != 0) {
+			return NULL;
+		}
+		default_ready = 1;
+	}
+	return &default_tree;
+}
+
+move_t mcts_player(state_t state) {
+	mcts_t *tree = mcts_default();
+	move_t move;
+	if (tree == NULL) {
+		move.row = move.column = -1;
+		return move;
+	}
+	return mcts_search(tree, state, MCTS_PLAYOUTS);
+}
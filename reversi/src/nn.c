@@ -0,0 +1,394 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/nn.h"
+#include "../include/util.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NN_X86 1
+#endif
+
+/* the line of the running search on this thread, see nn_search_eval */
+typedef struct {
+	int color;
+	int length;
+	int squares[SEARCH_MAX_PLY];
+	nn_acc_t acc[SEARCH_MAX_PLY + 1];
+} line_t;
+
+static nn_weights_t net;
+/* own row minus opponent row: what a flipped disc moves between the accumulators */
+static int16_t delta[NN_SQUARES][NN_HIDDEN1];
+static int loaded = 0;
+static int isa = -1;
+static __thread line_t line;
+
+static int best_isa(void) {
+#ifdef NN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return NN_AVX2;
+#endif
+	return NN_SCALAR;
+}
+
+int nn_isa(void) {
+	int current = __atomic_load_n(&isa, __ATOMIC_RELAXED);
+	if (current < 0) {
+		current = best_isa();
+		__atomic_store_n(&isa, current, __ATOMIC_RELAXED);
+	}
+	return current;
+}
+
+int nn_set_isa(int wanted) {
+	int best = best_isa();
+	__atomic_store_n(&isa, wanted < best ? wanted : best, __ATOMIC_RELAXED);
+	return nn_isa();
+}
+
+static inline int clamp(int x) {
+	return (x < 0) ? 0 : (x > NN_ACTIVATION_MAX) ? NN_ACTIVATION_MAX : x;
+}
+
+/* output units (2 * NN_SHIFT fraction bits of disc difference / NN_SQUARES) to the value scale */
+static inline int to_value(int32_t out) {
+	return out / ((1 << 2 * NN_SHIFT) / (NN_SQUARES * NN_VALUE_SCALE));
+}
+
+static void scalar_accumulate(int16_t *dst, const int16_t *src, const int16_t *const *add, int n_add,
+		const int16_t *const *sub, int n_sub) {
+	int16_t sum[NN_HIDDEN1];
+	int i, k;
+
+	memcpy(sum, src, sizeof(sum));
+	for (i = 0; i < n_add; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			sum[k] += add[i][k];
+	}
+	for (i = 0; i < n_sub; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			sum[k] -= sub[i][k];
+	}
+	memcpy(dst, sum, sizeof(sum));
+}
+
+static int scalar_forward(const int16_t *h) {
+	uint8_t a1[NN_HIDDEN1], a2[NN_HIDDEN2];
+	int32_t s;
+	int i, j;
+
+	for (i = 0; i < NN_HIDDEN1; i++)
+		a1[i] = clamp(h[i]);
+	for (j = 0; j < NN_HIDDEN2; j++) {
+		s = net.b2[j];
+		for (i = 0; i < NN_HIDDEN1; i++)
+			s += a1[i] * net.w2[j][i];
+		a2[j] = clamp(s >> NN_SHIFT);
+	}
+	s = net.b3;
+	for (j = 0; j < NN_HIDDEN2; j++)
+		s += a2[j] * net.w3[j];
+	return to_value(s);
+}
+
+#ifdef NN_X86
+
+__attribute__((target("avx2")))
+static void avx2_accumulate(int16_t *dst, const int16_t *src, const int16_t *const *add, int n_add,
+		const int16_t *const *sub, int n_sub) {
+	__m256i x[NN_HIDDEN1 / 16];
+	int i, k;
+
+	for (k = 0; k < NN_HIDDEN1 / 16; k++)
+		x[k] = _mm256_loadu_si256((const __m256i *) &src[16 * k]);
+	for (i = 0; i < n_add; i++) {
+		for (k = 0; k < NN_HIDDEN1 / 16; k++)
+			x[k] = _mm256_add_epi16(x[k], _mm256_loadu_si256((const __m256i *) &add[i][16 * k]));
+	}
+	for (i = 0; i < n_sub; i++) {
+		for (k = 0; k < NN_HIDDEN1 / 16; k++)
+			x[k] = _mm256_sub_epi16(x[k], _mm256_loadu_si256((const __m256i *) &sub[i][16 * k]));
+	}
+	for (k = 0; k < NN_HIDDEN1 / 16; k++)
+		_mm256_storeu_si256((__m256i *) &dst[16 * k], x[k]);
+}
+
+__attribute__((target("avx2")))
+static inline int32_t hsum8(__m256i x) {
+	__m128i v = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0x4e));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, 0xb1));
+	return _mm_cvtsi128_si32(v);
+}
+
+/* u8 activations times s8 weights, summed in int32; a pair of products cannot saturate */
+__attribute__((target("avx2")))
+static inline __m256i dot32(__m256i a, const int8_t *w, __m256i ones) {
+	return _mm256_madd_epi16(_mm256_maddubs_epi16(a, _mm256_loadu_si256((const __m256i *) w)), ones);
+}
+
+/* same integer arithmetic as scalar_forward, for NN_HIDDEN1 = 64 and NN_HIDDEN2 = 32 */
+__attribute__((target("avx2")))
+static int avx2_forward(const int16_t *h) {
+	const __m256i zero = _mm256_setzero_si256(), ones = _mm256_set1_epi16(1);
+	const __m256i top16 = _mm256_set1_epi16(NN_ACTIVATION_MAX), top32 = _mm256_set1_epi32(NN_ACTIVATION_MAX);
+	__m256i x[4], a[2], s[8], out[4], t, u;
+	int i, j;
+
+	for (i = 0; i < 4; i++)
+		x[i] = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *) &h[16 * i]), zero), top16);
+	/* packing works within 128 bit lanes, the permutation restores the order */
+	a[0] = _mm256_permute4x64_epi64(_mm256_packus_epi16(x[0], x[1]), 0xd8);
+	a[1] = _mm256_permute4x64_epi64(_mm256_packus_epi16(x[2], x[3]), 0xd8);
+	for (j = 0; j < NN_HIDDEN2; j += 8) {
+		for (i = 0; i < 8; i++)
+			s[i] = _mm256_add_epi32(dot32(a[0], net.w2[j + i], ones), dot32(a[1], net.w2[j + i] + 32, ones));
+		s[0] = _mm256_hadd_epi32(s[0], s[1]);
+		s[2] = _mm256_hadd_epi32(s[2], s[3]);
+		s[4] = _mm256_hadd_epi32(s[4], s[5]);
+		s[6] = _mm256_hadd_epi32(s[6], s[7]);
+		s[0] = _mm256_hadd_epi32(s[0], s[2]);
+		s[4] = _mm256_hadd_epi32(s[4], s[6]);
+		t = _mm256_add_epi32(_mm256_permute2x128_si256(s[0], s[4], 0x20),
+			_mm256_permute2x128_si256(s[0], s[4], 0x31));
+		t = _mm256_add_epi32(t, _mm256_loadu_si256((const __m256i *) &net.b2[j]));
+		out[j / 8] = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(t, NN_SHIFT), zero), top32);
+	}
+	t = _mm256_packs_epi32(out[0], out[1]);
+	u = _mm256_packs_epi32(out[2], out[3]);
+	t = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(t, u), _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+	return to_value(hsum8(dot32(t, net.w3, ones)) + net.b3);
+}
+
+#endif
+
+static void accumulate(int16_t *dst, const int16_t *src, const int16_t *const *add, int n_add,
+		const int16_t *const *sub, int n_sub) {
+#ifdef NN_X86
+	if (nn_isa() == NN_AVX2) {
+		avx2_accumulate(dst, src, add, n_add, sub, n_sub);
+		return;
+	}
+#endif
+	scalar_accumulate(dst, src, add, n_add, sub, n_sub);
+}
+
+static int forward(const int16_t *h) {
+#ifdef NN_X86
+	if (nn_isa() == NN_AVX2)
+		return avx2_forward(h);
+#endif
+	return scalar_forward(h);
+}
+
+static void refresh_color(int16_t *acc, uint64_t own, uint64_t opp) {
+	const int16_t *rows[NN_SQUARES];
+	int n = 0;
+
+	for (; own; own &= own - 1)
+		rows[n++] = net.w1[__builtin_ctzll(own)];
+	for (; opp; opp &= opp - 1)
+		rows[n++] = net.w1[NN_SQUARES + __builtin_ctzll(opp)];
+	accumulate(acc, net.b1, rows, n, NULL, 0);
+}
+
+void nn_refresh(nn_acc_t *acc, uint64_t black, uint64_t white) {
+	refresh_color(acc->v[0], black, white);
+	refresh_color(acc->v[1], white, black);
+}
+
+/* the side of the given color plays square (or passes) and flips discs */
+void nn_update(nn_acc_t *acc, const nn_acc_t *from, int color, int square, uint64_t flips) {
+	const int16_t *own[NN_SQUARES + 1], *opp[1], *rows[NN_SQUARES];
+	int n = 0;
+
+	if (square < 0) {
+		*acc = *from;
+		return;
+	}
+	own[0] = net.w1[square];
+	opp[0] = net.w1[NN_SQUARES + square];
+	for (; flips; flips &= flips - 1)
+		rows[n++] = delta[__builtin_ctzll(flips)];
+	memcpy(own + 1, rows, n * sizeof(rows[0]));
+	accumulate(acc->v[color], from->v[color], own, n + 1, NULL, 0);
+	accumulate(acc->v[!color], from->v[!color], opp, 1, rows, n);
+}
+
+/* value for the side of the given color, mobility being its legal moves */
+int nn_output(const nn_acc_t *acc, int color, uint64_t mobility) {
+	const int16_t *rows[NN_SQUARES];
+	int16_t h[NN_HIDDEN1];
+	int n = 0;
+
+	for (; mobility; mobility &= mobility - 1)
+		rows[n++] = net.w1[2 * NN_SQUARES + __builtin_ctzll(mobility)];
+	accumulate(h, acc->v[color], rows, n, NULL, 0);
+	return forward(h);
+}
+
+int nn_eval(uint64_t own, uint64_t opp, size_t size) {
+	nn_acc_t acc;
+	refresh_color(acc.v[0], own, opp);
+	return nn_output(&acc, 0, bb_mobility(own, opp, size));
+}
+
+int nn_heuristic(state_t state) {
+	if (!nn_ready(state.board.size)) {
+		return stability_heuristic(state);
+	}
+	if (state.player == BLACK_STONE) {
+		return nn_eval(state.board.black, state.board.white, state.board.size);
+	}
+	return nn_eval(state.board.white, state.board.black, state.board.size);
+}
+
+void nn_search_start(const search_t *s) {
+	line.color = (s->player == WHITE_STONE);
+	line.length = 0;
+	if (s->player == BLACK_STONE) {
+		nn_refresh(&line.acc[0], s->own, s->opp);
+	} else {
+		nn_refresh(&line.acc[0], s->opp, s->own);
+	}
+}
+
+/*
+ * Leaf value for the side to move of s. The accumulators of the previous
+ * leaf are kept as far as its line agrees with the moves on the search
+ * stack, and only the plies after that are applied.
+ */
+int nn_search_eval(const search_t *s) {
+	int n = 0;
+
+	while (n < line.length && n < s->ply && line.squares[n] == s->stack[n].square)
+		n++;
+	for (; n < s->ply; n++) {
+		nn_update(&line.acc[n + 1], &line.acc[n], line.color ^ (n & 1), s->stack[n].square, s->stack[n].flips);
+		line.squares[n] = s->stack[n].square;
+	}
+	line.length = s->ply;
+	return nn_output(&line.acc[s->ply], line.color ^ (s->ply & 1), search_moves(s));
+}
+
+/* the weights in file order, as (pointer, element size, count) */
+typedef struct {
+	void *data;
+	int bytes;
+	size_t count;
+} field_t;
+
+static void fields(nn_weights_t *w, field_t *f) {
+	f[0] = (field_t) { w->w1, 2, NN_INPUTS * NN_HIDDEN1 };
+	f[1] = (field_t) { w->b1, 2, NN_HIDDEN1 };
+	f[2] = (field_t) { w->w2, 1, NN_HIDDEN2 * NN_HIDDEN1 };
+	f[3] = (field_t) { w->b2, 4, NN_HIDDEN2 };
+	f[4] = (field_t) { w->w3, 1, NN_HIDDEN2 };
+	f[5] = (field_t) { &w->b3, 4, 1 };
+}
+
+static size_t file_size(void) {
+	return NN_HEADER_SIZE + 2 * (NN_INPUTS + 1) * NN_HIDDEN1 + (NN_HIDDEN1 + 4) * NN_HIDDEN2 + NN_HIDDEN2 + 4;
+}
+
+int nn_save(const char *filename, const nn_weights_t *weights) {
+	nn_weights_t copy = *weights;
+	field_t f[6];
+	uint8_t *buffer, *p;
+	size_t i;
+	int k, res;
+	FILE *out;
+
+	buffer = calloc(file_size(), 1);
+	if (buffer == NULL) {
+		return -1;
+	}
+	memcpy(buffer, "RVNN", 4);
+	buffer[4] = NN_VERSION;
+	buffer[5] = weights->size;
+	buffer[6] = NN_HIDDEN1;
+	buffer[7] = NN_HIDDEN2;
+	p = buffer + NN_HEADER_SIZE;
+	fields(&copy, f);
+	for (k = 0; k < 6; k++) {
+		for (i = 0; i < f[k].count; i++, p += f[k].bytes) {
+			if (f[k].bytes == 1)
+				util_put(p, ((int8_t *) f[k].data)[i], 1);
+			else if (f[k].bytes == 2)
+				util_put(p, ((int16_t *) f[k].data)[i], 2);
+			else
+				util_put(p, ((int32_t *) f[k].data)[i], 4);
+		}
+	}
+	out = fopen(filename, "wb");
+	if (out == NULL) {
+		free(buffer);
+		return -1;
+	}
+	res = fwrite(buffer, file_size(), 1, out) != 1;
+	res |= fclose(out) != 0;
+	free(buffer);
+	return res ? -1 : 0;
+}
+
+int nn_load(const char *filename) {
+	static nn_weights_t w;
+	field_t f[6];
+	uint8_t *buffer, *p;
+	size_t i, n;
+	int k;
+	FILE *in = fopen(filename, "rb");
+
+	if (in == NULL) {
+		return -1;
+	}
+	buffer = malloc(file_size() + 1);
+	if (buffer == NULL) {
+		fclose(in);
+		return -1;
+	}
+	n = fread(buffer, 1, file_size() + 1, in);
+	fclose(in);
+	if (n != file_size() || memcmp(buffer, "RVNN", 4) != 0 || buffer[4] != NN_VERSION
+			|| buffer[5] < MIN_BOARD_SIZE || buffer[5] > MAX_BOARD_SIZE
+			|| buffer[6] != NN_HIDDEN1 || buffer[7] != NN_HIDDEN2) {
+		free(buffer);
+		return -1;
+	}
+	w.size = buffer[5];
+	p = buffer + NN_HEADER_SIZE;
+	fields(&w, f);
+	for (k = 0; k < 6; k++) {
+		for (i = 0; i < f[k].count; i++, p += f[k].bytes) {
+			if (f[k].bytes == 1)
+				((int8_t *) f[k].data)[i] = (int8_t) util_get(p, 1);
+			else if (f[k].bytes == 2)
+				((int16_t *) f[k].data)[i] = (int16_t) util_get(p, 2);
+			else
+				((int32_t *) f[k].data)[i] = (int32_t) util_get(p, 4);
+		}
+	}
+	free(buffer);
+	nn_set(&w);
+	return 0;
+}
+
+/* not to be called while a search evaluates with the network */
+void nn_set(const nn_weights_t *weights) {
+	int i, k;
+
+	net = *weights;
+	for (i = 0; i < NN_SQUARES; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			delta[i][k] = net.w1[i][k] - net.w1[NN_SQUARES + i][k];
+	}
+	loaded = 1;
+}
+
+void nn_unload(void) {
+	loaded = 0;
+}
+
+int nn_ready(size_t size) {
+	return loaded && net.size == size;
+}
@@ -0,0 +1,517 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/pcache.h"
+#include "../include/util.h"
+
+typedef struct {
+	uint64_t key;
+	uint64_t black;
+	uint64_t white;
+	uint8_t player;
+	uint8_t size;
+	uint8_t depth;
+	uint8_t move;
+	int8_t lower;
+	int8_t upper;
+} pc_record_t;
+
+typedef struct {
+	pc_record_t *slots;
+	size_t mask;
+	size_t used;
+} pc_table_t;
+
+/* every search thread shares the map, overlay and pending batch, under the lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t *map = NULL;
+static size_t map_length = 0;
+static size_t map_slots = 0;
+static size_t map_used = 0;
+static ino_t map_ino = 0;
+static char cache_name[1024];
+static int journal_fd = -1;
+static off_t journal_offset = 0;
+static size_t journal_records = 0;
+static pc_table_t overlay = { NULL, 0, 0 };
+static size_t hits = 0, probes = 0;
+static uint8_t pending[PCACHE_BATCH * PCACHE_SLOT_SIZE];
+static int num_pending = 0;
+static __thread int bypass = 0;
+
+static uint16_t checksum(const uint8_t *p, int length) {
+	uint16_t a = 0, b = 0;
+	int i;
+	for (i = 0; i < length; i++) {
+		a = (a + p[i]) % 255;
+		b = (b + a) % 255;
+	}
+	return b << 8 | a;
+}
+
+static void encode(const pc_record_t *r, uint8_t *p) {
+	uint16_t sum;
+	util_put64(p, r->key);
+	util_put64(p + 8, r->black);
+	util_put64(p + 16, r->white);
+	p[24] = r->player;
+	p[25] = r->size;
+	p[26] = r->depth;
+	p[27] = r->move;
+	p[28] = (uint8_t) r->lower;
+	p[29] = (uint8_t) r->upper;
+	sum = checksum(p, 30);
+	p[30] = sum & 0xff;
+	p[31] = sum >> 8;
+}
+
+static int decode(const uint8_t *p, pc_record_t *r) {
+	r->key = util_get64(p);
+	r->black = util_get64(p + 8);
+	r->white = util_get64(p + 16);
+	r->player = p[24];
+	r->size = p[25];
+	r->depth = p[26];
+	r->move = p[27];
+	r->lower = (int8_t) p[28];
+	r->upper = (int8_t) p[29];
+	return r->key != 0 && checksum(p, 30) == (p[30] | p[31] << 8);
+}
+
+static int same_position(const pc_record_t *a, const pc_record_t *b) {
+	return a->key == b->key && a->black == b->black && a->white == b->white
+		&& a->player == b->player && a->size == b->size;
+}
+
+/* the deeper result wins, results of the same depth narrow each other */
+static void merge(pc_record_t *into, const pc_record_t *r) {
+	if (r->depth > into->depth) {
+		*into = *r;
+		return;
+	} else if (r->depth < into->depth) {
+		return;
+	}
+	if (r->lower > into->lower)
+		into->lower = r->lower;
+	if (r->upper < into->upper)
+		into->upper = r->upper;
+	if (into->lower > into->upper) {
+		*into = *r;
+	}
+	if (into->move == 0xff)
+		into->move = r->move;
+}
+
+static int table_init(pc_table_t *table, int bits) {
+	table->slots = calloc((size_t) 1 << bits, sizeof(pc_record_t));
+	table->mask = ((size_t) 1 << bits) - 1;
+	table->used = 0;
+	return table->slots ? 0 : -1;
+}
+
+static pc_record_t *table_find(pc_table_t *table, const pc_record_t *r) {
+	size_t i = r->key & table->mask;
+	while (table->slots[i].key && !same_position(&table->slots[i], r)) {
+		i = (i + 1) & table->mask;
+	}
+	return &table->slots[i];
+}
+
+static int table_insert(pc_table_t *table, const pc_record_t *r) {
+	pc_table_t bigger;
+	pc_record_t *slot;
+	size_t i;
+	int bits;
+
+	if (2 * (table->used + 1) > table->mask + 1) {
+		for (bits = 0; ((size_t) 1 << bits) <= table->mask; bits++)
+			;
+		if (table_init(&bigger, bits + 1) != 0) {
+			return -1;
+		}
+		for (i = 0; i <= table->mask; i++) {
+			if (table->slots[i].key) {
+				*table_find(&bigger, &table->slots[i]) = table->slots[i];
+				bigger.used++;
+			}
+		}
+		free(table->slots);
+		*table = bigger;
+	}
+	slot = table_find(table, r);
+	if (slot->key) {
+		merge(slot, r);
+	} else {
+		*slot = *r;
+		table->used++;
+	}
+	return 0;
+}
+
+static int map_find(const pc_record_t *r, pc_record_t *found) {
+	size_t i;
+	if (map == NULL) {
+		return 0;
+	}
+	for (i = r->key & (map_slots - 1); ; i = (i + 1) & (map_slots - 1)) {
+		if (!decode(map + PCACHE_HEADER_SIZE + i * PCACHE_SLOT_SIZE, found)) {
+			return 0;
+		}
+		if (same_position(found, r)) {
+			return 1;
+		}
+	}
+}
+
+static int map_file(const char *filename, uint8_t **data, size_t *length, size_t *slots, size_t *used,
+		ino_t *ino) {
+	struct stat st;
+	int fd;
+
+	*data = NULL;
+	*ino = 0;
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < PCACHE_HEADER_SIZE) {
+		close(fd);
+		return -1;
+	}
+	*ino = st.st_ino;
+	*data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (*data == MAP_FAILED) {
+		*data = NULL;
+		return -1;
+	}
+	*length = st.st_size;
+	*slots = util_get64(*data + 8);
+	*used = util_get64(*data + 16);
+	if (memcmp(*data, "RVPC", 4) != 0 || (*data)[4] != PCACHE_VERSION || *slots == 0
+			|| (*slots & (*slots - 1)) || PCACHE_HEADER_SIZE + *slots * PCACHE_SLOT_SIZE > *length) {
+		munmap(*data, *length);
+		*data = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+static void load_journal(int fd, off_t *offset, pc_table_t *table, size_t *records) {
+	uint8_t buffer[PCACHE_SLOT_SIZE * 256];
+	pc_record_t r;
+	ssize_t n;
+	int i;
+
+	/* a trailing partial record is left for the next refresh */
+	while ((n = pread(fd, buffer, sizeof(buffer), *offset)) >= PCACHE_SLOT_SIZE) {
+		n -= n % PCACHE_SLOT_SIZE;
+		for (i = 0; i < n; i += PCACHE_SLOT_SIZE) {
+			if (decode(buffer + i, &r)) {
+				table_insert(table, &r);
+				(*records)++;
+			}
+		}
+		*offset += n;
+	}
+}
+
+/*
+ * One O_APPEND write per batch keeps concurrent writers from interleaving,
+ * the lock out of a compaction. The batch lands at the end of the file,
+ * after what other processes appended since the last load, so the offset
+ * stays: the next load reads both, and merging our own records is harmless.
+ */
+static void flush(void) {
+	if (num_pending == 0) {
+		return;
+	}
+	/* a batch the disk refuses is dropped: the cache only saves work, it never holds the only copy */
+	flock(journal_fd, LOCK_SH);
+	write(journal_fd, pending, num_pending * PCACHE_SLOT_SIZE);
+	flock(journal_fd, LOCK_UN);
+	num_pending = 0;
+}
+
+/* journal_fd is read without the lock to skip it when no cache is open */
+static int is_open(void) {
+	return __atomic_load_n(&journal_fd, __ATOMIC_ACQUIRE) >= 0;
+}
+
+static void close_cache(void) {
+	if (map) {
+		munmap(map, map_length);
+	}
+	if (journal_fd >= 0) {
+		flush();
+		close(journal_fd);
+	}
+	free(overlay.slots);
+	map = NULL;
+	__atomic_store_n(&journal_fd, -1, __ATOMIC_RELEASE);
+	overlay.slots = NULL;
+	overlay.used = 0;
+}
+
+int pcache_open(const char *filename) {
+	char name[1024];
+	int fd;
+
+	pthread_mutex_lock(&lock);
+	close_cache();
+	snprintf(cache_name, sizeof(cache_name), "%s", filename);
+	map_file(filename, &map, &map_length, &map_slots, &map_used, &map_ino);
+	snprintf(name, sizeof(name), "%s.log", filename);
+	fd = open(name, O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (fd < 0 || table_init(&overlay, PCACHE_OVERLAY_BITS) != 0) {
+		if (fd >= 0) {
+			close(fd);
+		}
+		close_cache();
+		pthread_mutex_unlock(&lock);
+		return -1;
+	}
+	journal_offset = 0;
+	journal_records = 0;
+	load_journal(fd, &journal_offset, &overlay, &journal_records);
+	__atomic_store_n(&journal_fd, fd, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&lock);
+	return 0;
+}
+
+void pcache_close(void) {
+	pthread_mutex_lock(&lock);
+	close_cache();
+	pthread_mutex_unlock(&lock);
+}
+
+void pcache_bypass(int on) {
+	bypass = on;
+}
+
+/* a new table inode means a compaction folded the journal into it and emptied it: start over from both */
+void pcache_refresh(void) {
+	struct stat st;
+
+	if (bypass || !is_open()) {
+		return;
+	}
+	pthread_mutex_lock(&lock);
+	if (journal_fd < 0) {
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	flush();
+	if (stat(cache_name, &st) == 0 && st.st_ino != map_ino) {
+		if (map) {
+			munmap(map, map_length);
+		}
+		map_file(cache_name, &map, &map_length, &map_slots, &map_used, &map_ino);
+		memset(overlay.slots, 0, (overlay.mask + 1) * sizeof(pc_record_t));
+		overlay.used = 0;
+		journal_offset = 0;
+		journal_records = 0;
+	}
+	load_journal(journal_fd, &journal_offset, &overlay, &journal_records);
+	pthread_mutex_unlock(&lock);
+}
+
+static void canonical(state_t state, pc_record_t *r, int *sym) {
+	bitboard_t board;
+	r->key = bb_canonical_hash(state.board, state.player, sym);
+	if (r->key == 0)
+		r->key = 1;
+	board = bb_symmetry(state.board, *sym);
+	r->black = board.black;
+	r->white = board.white;
+	r->player = state.player;
+	r->size = state.board.size;
+}
+
+int pcache_probe(state_t state, pcache_entry_t *entry) {
+	pc_record_t r, found, *slot;
+	int sym, found_any = 0, i;
+
+	if (bypass || !is_open()) {
+		return 0;
+	}
+	canonical(state, &r, &sym);
+	pthread_mutex_lock(&lock);
+	if (journal_fd < 0) {
+		pthread_mutex_unlock(&lock);
+		return 0;
+	}
+	probes++;
+	if (map_find(&r, &found)) {
+		found_any = 1;
+	}
+	slot = table_find(&overlay, &r);
+	if (slot->key) {
+		if (found_any) {
+			merge(&found, slot);
+		} else {
+			found = *slot;
+		}
+		found_any = 1;
+	}
+	hits += found_any;
+	pthread_mutex_unlock(&lock);
+	if (!found_any) {
+		return 0;
+	}
+	entry->lower = found.lower;
+	entry->upper = found.upper;
+	entry->depth = found.depth;
+	entry->move.row = entry->move.column = -1;
+	for (i = 0; found.move != 0xff && i < (int) (found.size * found.size); i++) {
+		if (bb_symmetry_square(i, found.size, sym) == found.move) {
+			entry->move.row = i % found.size;
+			entry->move.column = i / found.size;
+			break;
+		}
+	}
+	return 1;
+}
+
+void pcache_store(state_t state, int depth, int lower, int upper, move_t move) {
+	pc_record_t r;
+	int sym;
+
+	if (bypass || !is_open()) {
+		return;
+	}
+	canonical(state, &r, &sym);
+	r.depth = depth;
+	r.lower = lower;
+	r.upper = upper;
+	r.move = 0xff;
+	if (move.row < state.board.size && move.column < state.board.size) {
+		r.move = bb_symmetry_square(one_dimension(move.row, move.column, state.board.size),
+			state.board.size, sym);
+	}
+	pthread_mutex_lock(&lock);
+	if (journal_fd >= 0) {
+		table_insert(&overlay, &r);
+		encode(&r, pending + num_pending++ * PCACHE_SLOT_SIZE);
+		if (num_pending == PCACHE_BATCH) {
+			flush();
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+pcache_stats_t pcache_stats(void) {
+	pcache_stats_t stats;
+	pthread_mutex_lock(&lock);
+	stats.slots = map_slots;
+	stats.used = map_used;
+	stats.journal = journal_records;
+	stats.hits = hits;
+	stats.probes = probes;
+	pthread_mutex_unlock(&lock);
+	return stats;
+}
+
+static void load_cache(const char *filename, pc_table_t *table) {
+	uint8_t *data;
+	size_t length, slots, used, i;
+	pc_record_t r;
+	char name[1024];
+	off_t offset = 0;
+	ino_t ino;
+	int fd;
+
+	if (map_file(filename, &data, &length, &slots, &used, &ino) == 0) {
+		for (i = 0; i < slots; i++) {
+			if (decode(data + PCACHE_HEADER_SIZE + i * PCACHE_SLOT_SIZE, &r)) {
+				table_insert(table, &r);
+			}
+		}
+		munmap(data, length);
+	}
+	snprintf(name, sizeof(name), "%s.log", filename);
+	fd = open(name, O_RDONLY);
+	if (fd >= 0) {
+		load_journal(fd, &offset, table, &used);
+		close(fd);
+	}
+}
+
+/*
+ * Writers append under a shared lock of the journal, so holding it
+ * exclusively from the load to the truncation loses no record. Readers
+ * see the new table on their next refresh and reload the journal.
+ */
+int pcache_compact(const char *filename, char **inputs, int num_inputs) {
+	pc_table_t all, out;
+	uint8_t header[PCACHE_HEADER_SIZE], buffer[PCACHE_SLOT_SIZE], empty[PCACHE_SLOT_SIZE];
+	char name[1024];
+	size_t i;
+	int bits, j, journal, res = 0;
+	FILE *f;
+
+	snprintf(name, sizeof(name), "%s.log", filename);
+	journal = open(name, O_RDWR | O_CREAT, 0644);
+	if (journal < 0 || flock(journal, LOCK_EX) != 0 || table_init(&all, PCACHE_OVERLAY_BITS) != 0) {
+		if (journal >= 0) {
+			close(journal);
+		}
+		return -1;
+	}
+	load_cache(filename, &all);
+	for (j = 0; j < num_inputs; j++) {
+		load_cache(inputs[j], &all);
+	}
+	for (bits = 10; ((size_t) 1 << bits) < 2 * all.used; bits++)
+		;
+	if (table_init(&out, bits) != 0) {
+		free(all.slots);
+		close(journal);
+		return -1;
+	}
+	for (i = 0; i <= all.mask; i++) {
+		if (all.slots[i].key) {
+			*table_find(&out, &all.slots[i]) = all.slots[i];
+			out.used++;
+		}
+	}
+	free(all.slots);
+
+	/* the new table only replaces the old one once it is safely on disk */
+	snprintf(name, sizeof(name), "%s.tmp", filename);
+	f = fopen(name, "wb");
+	if (f == NULL) {
+		free(out.slots);
+		close(journal);
+		return -1;
+	}
+	memset(header, 0, sizeof(header));
+	memcpy(header, "RVPC", 4);
+	header[4] = PCACHE_VERSION;
+	util_put64(header + 8, out.mask + 1);
+	util_put64(header + 16, out.used);
+	res |= fwrite(header, PCACHE_HEADER_SIZE, 1, f) != 1;
+	memset(empty, 0, sizeof(empty));
+	for (i = 0; i <= out.mask; i++) {
+		if (out.slots[i].key) {
+			encode(&out.slots[i], buffer);
+			res |= fwrite(buffer, PCACHE_SLOT_SIZE, 1, f) != 1;
+		} else {
+			res |= fwrite(empty, PCACHE_SLOT_SIZE, 1, f) != 1;
+		}
+	}
+	free(out.slots);
+	res |= fflush(f) != 0 || fsync(fileno(f)) != 0;
+	res |= fclose(f) != 0;
+	if (res || rename(name, filename) != 0) {
+		remove(name);
+		close(journal);
+		return -1;
+	}
+	res = ftruncate(journal, 0);
+	close(journal);
+	return res ? -1 : 0;
+}
@@ -0,0 +1,136 @@
+#include <pthread.h>
+#include "../include/ponder.h"
+
+/*
+ * Pondering: while the human player is thinking, a background thread walks
+ * the replies available to them (most likely first) and searches the
+ * position after each one with increasing depth. Every search fills the
+ * table given to ponder_start, the shared one when NULL, so the next search
+ * reuses it even on a miss. The best answer found for each reply is kept
+ * in a small response cache. A response answers the next search only if it
+ * was searched at least as deep, with the same evaluation.
+ */
+
+typedef struct {
+	uint64_t key;
+	move_t move;
+	int depth;
+	int order;
+	state_t state;
+} response_t;
+
+static pthread_t thread;
+static int running = 0;
+static int halt = 0;
+static response_t responses[MAX_BOARD_SIZE * MAX_BOARD_SIZE];
+static int num_responses = 0;
+static ponder_stats_t stats;
+static int (*evaluation) (state_t state);
+static tt_table_t *ponder_table;
+
+static int compare_responses(const void *a, const void *b) {
+	return ((const response_t *) b)->order - ((const response_t *) a)->order;
+}
+
+static void *ponder_main(void *arg) {
+	int depth, i;
+	move_t move;
+
+	(void) arg;
+	tt_use(ponder_table);
+	bb_search_flag(&halt);
+	for (depth = 1; depth <= PONDER_MAX_DEPTH; depth++) {
+		for (i = 0; i < num_responses; i++) {
+			move = negamax_alphabeta(responses[i].state, depth, evaluation);
+			if (bb_search_stopped()) {
+				return NULL;
+			}
+			responses[i].move = move;
+			responses[i].depth = depth;
+		}
+		stats.depth = depth;
+	}
+	return NULL;
+}
+
+void ponder_start(state_t state, int (*heuristic) (state_t state), tt_table_t *tt) {
+	bitboard_t moves;
+	uint64_t table;
+	state_t child;
+	tt_entry_t entry;
+	int i, hash_pos = -1;
+	move_t move;
+	char opponent = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+
+	ponder_stop();
+	num_responses = 0;
+	stats.depth = 0;
+	evaluation = heuristic;
+	ponder_table = tt;
+
+	tt_use(tt);
+	if (tt_probe(bb_hash(state.board, state.player), &entry)) {
+		hash_pos = one_dimension(entry.move.row, entry.move.column, state.board.size);
+	}
+	tt_use(NULL);
+	moves = bb_moves(state);
+	table = (state.player == BLACK_STONE) ? moves.black : moves.white;
+	for (i = 0; i < (int) (state.board.size * state.board.size); i++) {
+		if (!get_bit(table, i))
+			continue;
+		move.row = i % state.board.size;
+		move.column = i / state.board.size;
+		child.board = bb_move(move, state);
+		/* the reply the engine itself would play is predicted first */
+		child.player = state.player;
+		responses[num_responses].order = (i == hash_pos) ? SCORE_INF : coin_parity_heuristic(child);
+		child.player = opponent;
+		responses[num_responses].state = child;
+		responses[num_responses].key = bb_hash(child.board, child.player);
+		responses[num_responses].depth = 0;
+		num_responses++;
+	}
+	qsort(responses, num_responses, sizeof(response_t), compare_responses);
+
+	if (num_responses == 0) {
+		return;
+	}
+	if (pthread_create(&thread, NULL, ponder_main, NULL) == 0) {
+		running = 1;
+	}
+}
+
+void ponder_stop(void) {
+	if (!running) {
+		return;
+	}
+	__atomic_store_n(&halt, 1, __ATOMIC_RELAXED);
+	pthread_join(thread, NULL);
+	halt = 0;
+	running = 0;
+}
+
+int ponder_lookup(state_t state, int depth, int (*heuristic) (state_t state), move_t *move) {
+	int i;
+	uint64_t key = bb_hash(state.board, state.player);
+
+	if (num_responses == 0) {
+		return 0;
+	}
+	for (i = 0; i < num_responses; i++) {
+		if (responses[i].key == key && responses[i].depth >= depth && heuristic == evaluation
+				&& bb_move(responses[i].move, state).size) {
+			*move = responses[i].move;
+			num_responses = 0;
+			stats.hits++;
+			return 1;
+		}
+	}
+	num_responses = 0;
+	stats.misses++;
+	return 0;
+}
+
+ponder_stats_t ponder_stats(void) {
+	return stats;
+}
@@ -0,0 +1,80 @@
+#include "../include/probcut.h"
+
+static probcut_t probcut;
+
+/* a quick check a quarter as deep, then one half as deep */
+int probcut_shallow(int depth, int check) {
+	return (check == 0) ? depth / 4 : depth / 2;
+}
+
+int probcut_phase(uint64_t occupied, size_t size) {
+	int phase = (__builtin_popcountll(occupied) - 4) * PROBCUT_PHASES / (int) (size * size - 4);
+	if (phase < 0)
+		return 0;
+	return (phase >= PROBCUT_PHASES) ? PROBCUT_PHASES - 1 : phase;
+}
+
+/* text file: one "phase depth check a b sigma" line per fitted pair */
+int probcut_load(const char *filename) {
+	FILE *f = fopen(filename, "r");
+	char line[256];
+	int phase, depth, check, n = 0;
+	probcut_param_t p;
+
+	if (f == NULL) {
+		return -1;
+	}
+	memset(probcut.params, 0, sizeof(probcut.params));
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#')
+			continue;
+		if (sscanf(line, "%d %d %d %lf %lf %lf", &phase, &depth, &check, &p.a, &p.b, &p.sigma) != 6
+			|| phase < 0 || phase >= PROBCUT_PHASES || depth < PROBCUT_MIN_DEPTH
+			|| depth > PROBCUT_MAX_DEPTH || check < 0 || check >= PROBCUT_CHECKS || p.a <= 0) {
+			fclose(f);
+			return -1;
+		}
+		probcut.params[phase][depth][check] = p;
+		n++;
+	}
+	fclose(f);
+	if (probcut.confidence[0] == 0)
+		probcut_set_confidence(PROBCUT_CONFIDENCE);
+	probcut.enabled = n > 0;
+	return 0;
+}
+
+int probcut_save(const char *filename, const probcut_t *params) {
+	FILE *f = fopen(filename, "w");
+	int phase, depth, check;
+	const probcut_param_t *p;
+
+	if (f == NULL) {
+		return -1;
+	}
+	fprintf(f, "# phase depth check a b sigma\n");
+	for (phase = 0; phase < PROBCUT_PHASES; phase++) {
+		for (depth = PROBCUT_MIN_DEPTH; depth <= PROBCUT_MAX_DEPTH; depth++) {
+			for (check = 0; check < PROBCUT_CHECKS; check++) {
+				p = &params->params[phase][depth][check];
+				if (p->a > 0)
+					fprintf(f, "%d %d %d %.4f %.4f %.4f\n", phase, depth, check, p->a, p->b, p->sigma);
+			}
+		}
+	}
+	return fclose(f);
+}
+
+void probcut_enable(int enabled) {
+	probcut.enabled = enabled;
+}
+
+/* the first, cheaper check asks for more confidence than the second */
+void probcut_set_confidence(double confidence) {
+	probcut.confidence[0] = confidence * 1.2;
+	probcut.confidence[1] = confidence;
+}
+
+const probcut_t *probcut_active(void) {
+	return probcut.enabled ? &probcut : NULL;
+}
@@ -0,0 +1,318 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/record.h"
+#include "../include/util.h"
+
+static const char POS_MAGIC[4] = { 'R', 'V', 'P', 'S' };
+static const char GAME_MAGIC[4] = { 'R', 'V', 'G', 'M' };
+
+static int write_header(FILE *f, const char *magic, uint64_t field) {
+	uint8_t header[RECORD_HEADER_SIZE];
+	memcpy(header, magic, 4);
+	header[4] = RECORD_VERSION;
+	header[5] = header[6] = header[7] = 0;
+	util_put64(header + 8, field);
+	if (fseek(f, 0, SEEK_SET) != 0 || fwrite(header, RECORD_HEADER_SIZE, 1, f) != 1) {
+		return -1;
+	}
+	return 0;
+}
+
+static int read_header(FILE *f, const char *magic, uint64_t *field) {
+	uint8_t header[RECORD_HEADER_SIZE];
+	if (fread(header, RECORD_HEADER_SIZE, 1, f) != 1) {
+		return -1;
+	}
+	if (memcmp(header, magic, 4) != 0 || header[4] != RECORD_VERSION) {
+		return -1;
+	}
+	*field = util_get64(header + 8);
+	return 0;
+}
+
+static int record_open(record_file_t *rf, const char *filename, int writing, int games) {
+	rf->f = fopen(filename, writing ? "w+b" : "rb");
+	rf->writing = writing;
+	rf->games = games;
+	rf->count = 0;
+	rf->next = 0;
+	rf->offsets = NULL;
+	rf->capacity = 0;
+	return rf->f ? 0 : -1;
+}
+
+void pos_encode(state_t state, uint8_t *buffer) {
+	util_put64(buffer, state.board.black);
+	util_put64(buffer + 8, state.board.white);
+	buffer[16] = state.player;
+	buffer[17] = state.board.size;
+}
+
+state_t pos_decode(const uint8_t *buffer) {
+	state_t state;
+	state.board.black = util_get64(buffer);
+	state.board.white = util_get64(buffer + 8);
+	state.player = buffer[16];
+	state.board.size = buffer[17];
+	return state;
+}
+
+/* a size the engine plays and a side to move, so that a damaged record is rejected */
+static int valid_state(state_t state) {
+	return state.board.size >= MIN_BOARD_SIZE && state.board.size <= MAX_BOARD_SIZE
+		&& (state.player == BLACK_STONE || state.player == WHITE_STONE);
+}
+
+int pos_writer_open(record_file_t *rf, const char *filename) {
+	if (record_open(rf, filename, 1, 0) != 0) {
+		return -1;
+	}
+	return write_header(rf->f, POS_MAGIC, 0);
+}
+
+int pos_write(record_file_t *rf, state_t state) {
+	uint8_t buffer[RECORD_POSITION_SIZE];
+	pos_encode(state, buffer);
+	if (fwrite(buffer, RECORD_POSITION_SIZE, 1, rf->f) != 1) {
+		return -1;
+	}
+	rf->count++;
+	return 0;
+}
+
+int pos_reader_open(record_file_t *rf, const char *filename) {
+	uint64_t count;
+	long length;
+
+	if (record_open(rf, filename, 0, 0) != 0) {
+		return -1;
+	}
+	if (read_header(rf->f, POS_MAGIC, &count) != 0 || fseek(rf->f, 0, SEEK_END) != 0) {
+		record_close(rf);
+		return -1;
+	}
+	/* trust the file length, the header count is only set on close */
+	length = ftell(rf->f);
+	rf->count = (length - RECORD_HEADER_SIZE) / RECORD_POSITION_SIZE;
+	return pos_seek(rf, 0);
+}
+
+int pos_read(record_file_t *rf, state_t *state) {
+	uint8_t buffer[RECORD_POSITION_SIZE];
+	if (rf->next >= rf->count) {
+		return 0;
+	}
+	if (fread(buffer, RECORD_POSITION_SIZE, 1, rf->f) != 1) {
+		return -1;
+	}
+	*state = pos_decode(buffer);
+	if (!valid_state(*state)) {
+		return -1;
+	}
+	rf->next++;
+	return 1;
+}
+
+int pos_seek(record_file_t *rf, uint64_t index) {
+	if (index > rf->count) {
+		return -1;
+	}
+	if (fseek(rf->f, RECORD_HEADER_SIZE + index * RECORD_POSITION_SIZE, SEEK_SET) != 0) {
+		return -1;
+	}
+	rf->next = index;
+	return 0;
+}
+
+int game_writer_open(record_file_t *rf, const char *filename) {
+	if (record_open(rf, filename, 1, 1) != 0) {
+		return -1;
+	}
+	return write_header(rf->f, GAME_MAGIC, 0);
+}
+
+int game_write(record_file_t *rf, const game_t *game) {
+	uint8_t header[RECORD_GAME_HEADER_SIZE], start[RECORD_POSITION_SIZE];
+	uint64_t *offsets;
+
+	if (rf->count == rf->capacity) {
+		rf->capacity = rf->capacity ? 2 * rf->capacity : 1024;
+		offsets = realloc(rf->offsets, rf->capacity * sizeof(uint64_t));
+		if (offsets == NULL) {
+			return -1;
+		}
+		rf->offsets = offsets;
+	}
+	rf->offsets[rf->count] = ftell(rf->f);
+
+	header[0] = game->size;
+	header[1] = game->num_moves;
+	header[2] = (uint8_t) game->score;
+	header[3] = game->flags;
+	if (fwrite(header, RECORD_GAME_HEADER_SIZE, 1, rf->f) != 1) {
+		return -1;
+	}
+	if (game->flags & GAME_CUSTOM_START) {
+		pos_encode(game->start, start);
+		if (fwrite(start, RECORD_POSITION_SIZE, 1, rf->f) != 1) {
+			return -1;
+		}
+	}
+	if (fwrite(game->moves, 1, game->num_moves, rf->f) != game->num_moves) {
+		return -1;
+	}
+	rf->count++;
+	return 0;
+}
+
+int game_reader_open(record_file_t *rf, const char *filename) {
+	uint64_t index_offset;
+	uint8_t buffer[8];
+	size_t i;
+
+	if (record_open(rf, filename, 0, 1) != 0) {
+		return -1;
+	}
+	if (read_header(rf->f, GAME_MAGIC, &index_offset) != 0) {
+		record_close(rf);
+		return -1;
+	}
+	if (index_offset == 0) {
+		/* never closed: the games can still be streamed, but not seeked */
+		rf->count = UINT64_MAX;
+		return 0;
+	}
+	if (fseek(rf->f, index_offset, SEEK_SET) != 0 || fread(buffer, 8, 1, rf->f) != 1) {
+		record_close(rf);
+		return -1;
+	}
+	rf->count = util_get64(buffer);
+	rf->offsets = malloc((rf->count ? rf->count : 1) * sizeof(uint64_t));
+	if (rf->offsets == NULL) {
+		record_close(rf);
+		return -1;
+	}
+	for (i = 0; i < rf->count; i++) {
+		if (fread(buffer, 8, 1, rf->f) != 1) {
+			record_close(rf);
+			return -1;
+		}
+		rf->offsets[i] = util_get64(buffer);
+	}
+	rf->capacity = rf->count;
+	return game_seek(rf, 0);
+}
+
+int game_read(record_file_t *rf, game_t *game) {
+	uint8_t header[RECORD_GAME_HEADER_SIZE], start[RECORD_POSITION_SIZE];
+	int i;
+
+	if (rf->next >= rf->count) {
+		return 0;
+	}
+	if (fread(header, RECORD_GAME_HEADER_SIZE, 1, rf->f) != 1) {
+		return feof(rf->f) && rf->offsets == NULL ? 0 : -1;
+	}
+	if (header[0] < MIN_BOARD_SIZE || header[0] > MAX_BOARD_SIZE || header[1] > RECORD_MAX_MOVES) {
+		return -1;
+	}
+	game_new(game, header[0]);
+	game->num_moves = header[1];
+	game->score = (int8_t) header[2];
+	game->flags = header[3];
+	if (game->flags & GAME_CUSTOM_START) {
+		if (fread(start, RECORD_POSITION_SIZE, 1, rf->f) != 1) {
+			return -1;
+		}
+		game->start = pos_decode(start);
+		if (!valid_state(game->start) || game->start.board.size != game->size) {
+			return -1;
+		}
+	}
+	if (fread(game->moves, 1, game->num_moves, rf->f) != game->num_moves) {
+		return -1;
+	}
+	for (i = 0; i < game->num_moves; i++) {
+		if (game->moves[i] >= game->size * game->size) {
+			return -1;
+		}
+	}
+	rf->next++;
+	return 1;
+}
+
+int game_seek(record_file_t *rf, uint64_t index) {
+	if (rf->offsets == NULL || index > rf->count) {
+		return -1;
+	}
+	if (index == rf->count) {
+		rf->next = index;
+		return 0;
+	}
+	if (fseek(rf->f, rf->offsets[index], SEEK_SET) != 0) {
+		return -1;
+	}
+	rf->next = index;
+	return 0;
+}
+
+int record_close(record_file_t *rf) {
+	uint8_t buffer[8];
+	uint64_t index_offset, i;
+	int res = 0;
+
+	if (rf->f == NULL) {
+		return -1;
+	}
+	if (rf->writing && rf->games) {
+		index_offset = ftell(rf->f);
+		util_put64(buffer, rf->count);
+		res |= fwrite(buffer, 8, 1, rf->f) != 1;
+		for (i = 0; i < rf->count; i++) {
+			util_put64(buffer, rf->offsets[i]);
+			res |= fwrite(buffer, 8, 1, rf->f) != 1;
+		}
+		res |= write_header(rf->f, GAME_MAGIC, index_offset);
+	} else if (rf->writing) {
+		res |= write_header(rf->f, POS_MAGIC, rf->count);
+	}
+	res |= fclose(rf->f) != 0;
+	free(rf->offsets);
+	rf->f = NULL;
+	rf->offsets = NULL;
+	return res ? -1 : 0;
+}
+
+void game_new(game_t *game, size_t size) {
+	game->size = size;
+	game->num_moves = 0;
+	game->score = 0;
+	game->flags = 0;
+	game->start.board = bb_init(size);
+	game->start.player = BLACK_STONE;
+}
+
+int game_replay(const game_t *game, state_t *states) {
+	state_t state = game->start;
+	move_t move;
+	bitboard_t next;
+	int i;
+
+	for (i = 0; i < game->num_moves; i++) {
+		move.row = game->moves[i] % game->size;
+		move.column = game->moves[i] / game->size;
+		next = bb_move(move, state);
+		if (!next.size) {
+			/* the side to move had to pass */
+			state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+			next = bb_move(move, state);
+			if (!next.size) {
+				return -1;
+			}
+		}
+		states[i] = state;
+		state.board = next;
+		state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	}
+	states[i] = state;
+	return 0;
+}
@@ -1,21 +1,57 @@
+#define _XOPEN_SOURCE 700
+#include <signal.h>
+#include <sys/time.h>
+#include "../include/libreversi.h"
+#include "../include/ponder.h"
+#include "../include/pcache.h"
+#include "../include/mcts.h"
+#include "../include/dfpn.h"
+#include "../include/wide.h"
+#include "../include/suite.h"
 
-#include "../include/bitboard.h"
-
-size_t board_size;
-bool verbose;
-int game_mode;
+/* the game is played through libreversi; proofs, suites and wide boards use the modules directly */
+static size_t board_size;
+static bool verbose;
+static bool ponder;
+static int game_mode;
+static size_t prove_nodes;
+static double suite_limit;
+static int analysis_depth;
+static int analysis_lines;
+static reversi_settings_t settings;
+static int move_time;
+static reversi_t *volatile thinking;
 
 static void usage(int status) {
 	if (status == EXIT_SUCCESS){
 		printf("Usage: reversi [OPTION] FILE\n"
 		"Play a reversi game interactively with humans and AIs\n"
-		"\n\t -s, --size SIZE\t board size (min=1, max=4 (default))\n"
+		"\n\t -s, --size SIZE\t board size (min=1, max=8, default=4)\n"
 		"\t -c, --contest\t enable 'contest mode'\n"
 		"\t -b, --black-ai\t set black player as an AI\n"
 		"\t -w, --white-ai\t set white player as an AI\n"
+		"\t -p, --ponder\t let the AI think during the human player's turn\n"
+		"\t -C, --cache FILE\t keep solved positions in a persistent cache\n"
+		"\t -e, --engine NAME\t AI search: 'alphabeta' (default) or 'mcts'\n"
+		"\t -t, --threads N\t number of MCTS search threads (default 1)\n"
+		"\t -S, --seed SEED\t deterministic MCTS with a fixed seed\n"
+		"\t -P, --probcut FILE\t prune with Multi-ProbCut parameters from FILE\n"
+		"\t -D, --database FILE\t play small boards from a perfect-play database\n"
+		"\t -n, --network FILE\t evaluate with the network weights in FILE\n"
+		"\t -r, --prove FILE\t prove the outcome of the board in FILE\n"
+		"\t -N, --nodes N\t stop proving after N nodes (default: no limit)\n"
+		"\t -B, --bench-suite FILE\t solve or search the positions of FILE and check the answers\n"
+		"\t -L, --limit SECONDS\t give up a suite position after SECONDS (default: no limit)\n"
+		"\t -A, --analyze FILE\t score every move of the board in FILE, depth after depth\n"
+		"\t -l, --lines N\t exact scores for the N best moves only, bounds for the others (default: all)\n"
+		"\t -d, --depth DEPTH\t search depth (default %d, %d when analyzing)\n"
+		"\t -T, --time MS\t stop an AI move or an analysis after MS milliseconds, with the best so far\n"
+		"\t -k, --clock SECONDS\t plan the depth of every AI move on a clock of SECONDS per player,\n"
+		"\t\t\t the time left on it in contest mode\n"
+		"\t -K, --schedule FILE\t plan with the schedule of 'rvschedule calibrate' instead of calibrating\n"
 		"\t -v, --verbose\t verbose output\n"
 		"\t -V, --version\t display version and exit\n"
-		"\t -h, --help\t display this help\n");
+		"\t -h, --help\t display this help\n", AI_DEPTH, ANALYSIS_DEPTH);
 	} else {
 		fprintf(stderr, "Try 'reversi --help' for more information\n");
 	}
@@ -40,472 +76,462 @@ char* trim_white_spaces(char* input) {
     return output;
 }
 
-static state_t board_init(size_t width) {
-	state_t state;
-	state.board = bb_init(board_size);
-	state.player = BLACK_STONE;
-	return state;
+static int print_error(reversi_t *ctx, int code) {
+	fprintf(stderr, "reversi: error: %s\n", ctx && *reversi_error(ctx) ? reversi_error(ctx) : reversi_strerror(code));
+	return EXIT_FAILURE;
 }
 
-static void board_delete(char** board) {
-	/*int i;
-	
-	if (board == NULL) {
-		return;
+/* a context with the options of the command line, on the board of filename if any */
+static int open_game(reversi_t **ctx, char *filename) {
+	uint64_t black, white;
+	char player;
+	int res, size;
+
+	if ((res = reversi_new(ctx, board_size, &settings)) != REVERSI_OK) {
+		return print_error(NULL, res);
 	}
-	
-	for (i = 0; i < board_size; i++) {
-		free(board[i]);
+	if (filename && (res = reversi_load_file(*ctx, filename)) != REVERSI_OK) {
+		print_error(*ctx, res);
+		reversi_free(*ctx);
+		return EXIT_FAILURE;
 	}
-	free(board);*/
+	reversi_position(*ctx, &black, &white, &player, &size);
+	board_size = size;
+	return EXIT_SUCCESS;
 }
 
-static score_t board_score(state_t state) {
-	return bb_score(state.board);
+/* Ctrl-C stops the AI that is thinking, and quits otherwise; the alarm only stops it */
+static void interrupt(int sig) {
+	reversi_t *ctx = thinking;
+
+	if (ctx) {
+		reversi_stop(ctx);
+	} else if (sig == SIGINT) {
+		signal(sig, SIG_DFL);
+		raise(sig);
+	}
 }
 
-static void board_print(state_t state) {
-	bb_print(state.board);
+/* until unwatch(), SIGINT stops ctx, and so does SIGALRM after the time of a move */
+static void watch(reversi_t *ctx) {
+	struct itimerval timer = { { 0, 0 }, { move_time / 1000, move_time % 1000 * 1000 } };
+
+	thinking = ctx;
+	if (move_time > 0) {
+		setitimer(ITIMER_REAL, &timer, NULL);
+	}
 }
 
-static void board_save(state_t state) {
+static void unwatch(void) {
+	struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+
+	setitimer(ITIMER_REAL, &timer, NULL);
+	thinking = NULL;
+}
+
+static int think(reversi_t *ctx, reversi_result_t *result) {
+	int res;
+
+	watch(ctx);
+	res = reversi_search(ctx, result);
+	unwatch();
+	return res;
+}
+
+static void print_score(reversi_t *ctx) {
+	int black, white;
+	reversi_score(ctx, &black, &white);
+	printf("Score:\n'O': %d, 'X': %d\n", white, black);
+}
+
+static char player(reversi_t *ctx) {
+	uint64_t black, white;
+	char player;
+	int size;
+	reversi_position(ctx, &black, &white, &player, &size);
+	return player;
+}
+
+static void board_save(reversi_t *ctx) {
 	char filename[50];
-	int i, j;
 	FILE * f;
-	
+
 	printf("Give a filename to save the game (default: 'board.txt'): ");
 	fgets(filename, 50, stdin);
 	strcpy(filename, trim_white_spaces(filename));
-	
+
 	if (strlen(filename) == 1) {
 		strcpy(filename, "board.txt");
 	}
-	
+
 	f = fopen(filename, "w");
 	if (f == NULL) {
 		printf("Could not save the board, please try later\n");
 		exit(EXIT_SUCCESS);
 	}
-	fprintf(f, "%c\n", state.player);
-	for(i = 0; i < state.board.size; i++) {
-		for (j = 0; j < state.board.size; j++) {
-			if (get_bit(state.board.black, one_dimension(j, i, state.board.size))) {
-				fprintf(f, "X ");
-			} else if (get_bit(state.board.white, one_dimension(j, i, state.board.size))) {
-				fprintf(f, "O ");
-			} else {
-				fprintf(f, "_ ");
-			}
-		}
-		fprintf(f, "\n");
+	if (reversi_write(ctx, f) != REVERSI_OK) {
+		printf("Could not save the board, please try later\n");
 	}
 	fclose(f);
 }
 
-static void old_print(char** board) {
-	int i, j;
-	char letter;
-	
-	printf("\t");
-	for (i = 0; i < board_size; i++) {
-		printf("%d ", i+1);
-	}
-	printf("\n");
-	for (i = 0; i < board_size; i++) {
-		switch(i) {
-			case 0:
-				letter = 'A';
-				break;
-			case 1:
-				letter = 'B';
-				break;
-			case 2:
-				letter = 'C';
-				break;
-			case 3:
-				letter = 'D';
-				break;
-			case 4:
-				letter = 'E';
-				break;
-			case 5:
-				letter = 'F';
-				break;
-			case 6:
-				letter = 'G';
-				break;
-			case 7:
-				letter = 'H';
-				break;
-		}
-		printf("%c\t", letter);
-		for (j = 0; j < board_size; j++) {
-			printf("%c ", board[i][j]);
-		}
-		printf("\n");
+void quit_program(reversi_t *ctx) {
+	char string[200];
+	int i = 0;
+	printf("Quitting, do you want to save the game (y/N)? ");
+	fgets(string, 200, stdin);
+	while(string[i] == ' ' && string[i] != 0) {
+		i++;
 	}
+	if (string[i] != 0 && string[i] == 'y' || string[i] == 'Y') {
+		board_save(ctx);
+	}
+	reversi_free(ctx);
+	exit(EXIT_SUCCESS);
 }
 
-static state_t board_load(char * filename) {
-	char unknown_char_regexp[] = "^[_OX \t]|O{2,}|X{2,}";
-	int res, num_char, num_line = 0, rows = 0, i, j;
-	char line[200], aux[200], read_char, **board;
-	size_t width = -1;
-	state_t state;
-	row_t row;
-	bitboard_t b;
-	FILE * f;
-	
-	state.player = 0;
-	
-	f = fopen(filename, "r");
-	
-	if (f == NULL) {
-		printf("File not found\n");
-		exit(EXIT_FAILURE);
-	}
-	
-	//CHECKING FIRST LINE TO BE A PLAYER'S TURN
-	do {
- 		num_line++;
-		fgets(line, 200, f);
-		
-		res = is_there_comment(line);
-		if (res != -1) {
-			strncpy(aux, line, res);
-			strcpy(line, aux);
-		}
-		if ((num_char = is_first_line_correct(line)) >= 0 && num_char < strlen(line)) {
-			fprintf(stderr, "reversi: error: wrong character '%c' at line %d\n", line[num_char], num_line);
-			return state;
-		}
-		state.player = read_current_player(line);
-	} while(!state.player);
-	
-	//NORMAL BOARD
-	do {
-		num_line++;
-		if (fgets(line, 200, f) == NULL) {
-			break;
-		}
-		
-		res = is_there_comment(line);
-		if (res != -1) {
-			if (res == 0)
-				continue;
-			strncpy(aux, line, res);
-			strcpy(line, aux);
-		}
-		if ((num_char = is_line_correct(line)) >= 0 && num_char < strlen(line)) {
-			fprintf(stderr, "reversi: error: wrong character '%c' at line %d\n",
-			line[num_char], num_line);
-			return state;
-		}
-		row = read_row(line, num_line);
-		if (row.width <= 0)
-			continue;
-		if (width == -1) {
-			width = row.width;
-			board = malloc(sizeof(char*)*width);
-			if (board == NULL) {
-				fprintf(stderr, "No memory available\n");
-				exit(EXIT_SUCCESS);
-			}
-		} else if (width != row.width) {
-			if (board) {
-				for (i = 0; i < rows; i++) {
-					free(board[i]);
-				}
-				if (width > row.width) {
-					fprintf(stderr, "reversi: error board is too short at line %d\n", num_line);
-				} else if (width < row.width) {
-					fprintf(stderr, "reversi: error board is too long at line %d\n", num_line);
-				}
-				free(board);
-			}
-			exit(EXIT_FAILURE);
-		}
-		board[rows] = malloc(sizeof(char)*width);
-		for (i = 0; i < width; i++) {
-			board[rows][i] = row.row[i];
-		}
-		rows++;
-	} while(rows != width);
-	if (rows > width) {
-		fprintf(stderr, "reversi: error: board has too few rows\n");
-		exit(EXIT_FAILURE);
-	} else if (rows < width) {
-		fprintf(stderr, "reversi: error: board has too many rows\n");
-		exit(EXIT_FAILURE);
-	}
-	b.size = width;
-	b.black = 0;
-	b.white = 0;
-	for (i = 0; i < width; i++) {
-		for (j = 0; j < width; j++) {
-			if (board[j][i] == BLACK_STONE) {
-				b.black = set_bit(b.black, one_dimension(i, j, width), width);
-			} else if (board[i][j] == WHITE_STONE) {
-				b.white = set_bit(b.white, one_dimension(i, j, width), width);
-			}
-		}
+static int square(move_t move) {
+	if (move.row >= board_size || move.column >= board_size) {
+		return -2;
 	}
-	state.board = b;
-	board_size = width;
-	return state;
+	return one_dimension(move.row, move.column, board_size);
 }
 
-row_t read_row(char * line, int num_line) {
-	row_t row;
-	int i, j;
-	row.width = -1;
-	row.row = malloc(sizeof(char)*8);
-	i = 0, j = 0;
-	while(line[i] != '\n' && line[i] != 0) {
-		if (line[i] != ' ') {
-			if (j >= 8) {
-				fprintf(stderr, "reversi: error: board width is too long at line %d\n", num_line);
-				exit(EXIT_FAILURE);
-			}
-			row.row[j] = line[i];
-			j++;
+static void human_player(reversi_t *ctx) {
+	char string[200];
+	print_score(ctx);
+
+	printf("'%c' player's turn.\n Give your move (e.g. 'A5' or 'a5'), press 'q' or 'Q' to quit: ", player(ctx));
+	memset(string,0,sizeof(string));
+	fgets(string, 199, stdin);
+	if (strstr(string, "q") || strstr(string, "Q")) {
+		quit_program(ctx);
+	}
+	while (reversi_play(ctx, square(read_move(string))) != REVERSI_OK) {
+		printf("Move not valid. Try again: ");
+		fgets(string, 199, stdin);
+		if (strstr(string, "q") || strstr(string, "Q")) {
+			quit_program(ctx);
 		}
-		i++;
 	}
-	row.width = j;
-	return row;
 }
 
-char read_current_player(char * line) {
-	char read_column_regexp[] = "[OX]";
-	regex_t reg;
-	regmatch_t matches[1];
+static int contest(char * line) {
+	reversi_t *ctx;
+	reversi_result_t result;
+	char name[BOARD_SQUARE_NAME];
 	int res;
-	res = regcomp(&reg, read_column_regexp, REG_EXTENDED);
-	if (res) {
-		fprintf(stderr, "Error defining regexp\n");
-		return -1;
-	}
-	res = regexec(&reg, line, 1, matches, 0);
-	if (!res) {
-		return line[(int)matches[0].rm_so];
-	}
-	return 0;
+
+	if (open_game(&ctx, line) != EXIT_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	if ((res = think(ctx, &result)) != REVERSI_OK) {
+		print_error(ctx, res);
+		reversi_free(ctx);
+		return EXIT_FAILURE;
+	}
+	if (verbose && result.stopped) {
+		fprintf(stderr, "stopped after %.3f s at depth %d\n", result.elapsed, result.depth);
+	}
+	if (verbose && settings.clock_ms) {
+		fprintf(stderr, "depth %d in %.3f s, %.3f s planned\n", result.depth, result.elapsed, result.planned);
+	}
+	board_square_name(result.square, board_size, name);
+	printf("%s\n", name);
+	if (verbose) {
+		pcache_stats_t stats = pcache_stats();
+		fprintf(stderr, "cache: %zu hits / %zu probes, %zu journal records\n",
+			stats.hits, stats.probes, stats.journal);
+	}
+	reversi_free(ctx);
+	reversi_close_cache();
+	return EXIT_SUCCESS;
 }
 
-int is_there_comment(char * line) {
-	char comment_regexp[] = "#";
-	regex_t reg;
-	regmatch_t matches[1];
-	int res;
-	res = regcomp(&reg, comment_regexp, REG_EXTENDED);
-	if (res) {
-		printf("Error defining regexp\n");
-		return -1;
-	}
-	res = regexec(&reg, line, 1, matches, REG_NOTBOL);
-	if (!res) {
-		return (int)matches[0].rm_so;
+static int prove(char *filename) {
+	static const char *outcomes[] = { "loses", "draws", "wins" };
+	reversi_t *ctx;
+	state_t state;
+	dfpn_t dfpn;
+	dfpn_result_t result;
+	int size;
+
+	if (open_game(&ctx, filename) != EXIT_SUCCESS) {
+		return EXIT_FAILURE;
+	}
+	reversi_position(ctx, &state.board.black, &state.board.white, &state.player, &size);
+	state.board.size = size;
+	reversi_free(ctx);
+	if (dfpn_init(&dfpn, DFPN_MEMORY) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	dfpn.max_nodes = prove_nodes;
+	dfpn_solve(&dfpn, state, &result);
+	if (result.outcome == DFPN_UNKNOWN) {
+		printf("Unknown, node limit reached\n");
+	} else if (result.outcome != DFPN_LOSS && result.move.row < state.board.size) {
+		printf("'%c' %s, playing %c%d\n", state.player, outcomes[result.outcome + 1],
+			(int) result.move.column + 'a', (int) result.move.row + 1);
+	} else {
+		printf("'%c' %s\n", state.player, outcomes[result.outcome + 1]);
 	}
-	return -1;
+	printf("proof tree: %zu nodes, %zu nodes searched in %.3f s (%.0f nodes/s), %zu collections\n",
+		result.tree, result.nodes, result.elapsed, result.nodes / result.elapsed, result.collections);
+	dfpn_free(&dfpn);
+	return EXIT_SUCCESS;
 }
 
+static int bench_suite(char *filename) {
+	static const char *statuses[] = { "ok", "WRONG MOVE", "WRONG SCORE", "timeout" };
+	suite_t suite;
+	suite_position_t *p;
+	suite_result_t r;
+	size_t nodes = 0;
+	double elapsed = 0;
+	int counts[SUITE_TIMEOUT + 1] = { 0 }, i, j;
+	char best[SUITE_MAX_BEST * 4 + 1], move[BOARD_SQUARE_NAME], depth[8];
 
-
-int is_line_correct(char * line) {
-	char correct_line_regexp[] = "^[OX_ ]|O{2,}|X{2,}|_{2,}";
-	regex_t reg;
-	regmatch_t matches[1];
-	int res;
-	res = regcomp(&reg, correct_line_regexp, REG_EXTENDED);
-	if (res) {
-		printf("Error defining regexp\n");
-		return -1;
-	}
-	res = regexec(&reg, line, 1, matches, REG_NOTBOL);
-	if (!res) {
-		return (int)matches[0].rm_so;
+	if (suite_load(filename, &suite) != 0) {
+		fprintf(stderr, "%s\n", suite.error);
+		return EXIT_FAILURE;
+	}
+	printf("%-10s %7s %5s %-11s %5s %-5s %5s %10s %12s %10s\n", "position", "empties", "depth",
+		"best", "score", "move", "score", "time (s)", "nodes", "nodes/s");
+	for (i = 0; i < suite.count; i++) {
+		p = &suite.positions[i];
+		best[0] = 0;
+		for (j = 0; j < p->num_best; j++) {
+			suite_square_name(p->best[j], p->state.board.size, move);
+			strcat(best, j ? "," : "");
+			strcat(best, move);
+		}
+		if (p->depth == SUITE_DEPTH_SOLVE) {
+			strcpy(depth, "solve");
+		} else {
+			sprintf(depth, "%d", p->depth);
+		}
+		suite_run(p, suite_limit, &r);
+		suite_square_name(r.move, p->state.board.size, move);
+		printf("%-10s %7d %5s %-11s %+5d %-5s %+5d %10.3f %12zu %10.0f  %s\n", p->name,
+			bb_empties(p->state.board), depth, best, p->score, move, r.score, r.elapsed, r.nodes,
+			r.nodes / r.elapsed, statuses[r.status]);
+		fflush(stdout);
+		counts[r.status]++;
+		if (r.status != SUITE_TIMEOUT) {
+			nodes += r.nodes;
+			elapsed += r.elapsed;
+		}
 	}
-	return -1;
+	printf("total: %d positions, %d ok, %d wrong, %d timeouts; %.3f s, %zu nodes, %.0f nodes/s\n",
+		suite.count, counts[SUITE_PASS], counts[SUITE_WRONG_MOVE] + counts[SUITE_WRONG_SCORE],
+		counts[SUITE_TIMEOUT], elapsed, nodes, elapsed > 0 ? nodes / elapsed : 0);
+	suite_free(&suite);
+	return counts[SUITE_WRONG_MOVE] + counts[SUITE_WRONG_SCORE] ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
-int is_first_line_correct(char * line) {
-	int i;
-	i = 0;
-	while(line[i] != '\n') {
-		if (line[i] != ' ' && line[i] != BLACK_STONE && line[i] != WHITE_STONE && line[i] != EMPTY_STONE) {
-			return i;
+/* prints the moves of every completed depth as soon as it is done */
+static void print_analysis(const reversi_analysis_t *a, void *arg) {
+	const reversi_line_t *line;
+	char name[BOARD_SQUARE_NAME], score[16];
+	int i, j;
+
+	(void) arg;
+	printf("%s %d: %d moves, %zu nodes, %.3f s\n", a->solved ? "solved" : "depth", a->depth, a->num_lines,
+		a->nodes, a->elapsed);
+	for (i = 0; i < a->num_lines; i++) {
+		line = &a->lines[i];
+		board_square_name(line->square, board_size, name);
+		sprintf(score, "%s%+d", line->bound == REVERSI_EXACT ? "" : "<=", line->score);
+		printf("  %-4s %6s ", name, score);
+		for (j = 1; j < line->pv_length; j++) {
+			board_square_name(line->pv[j], board_size, name);
+			printf(" %s", name);
 		}
-		i++;
+		printf("\n");
 	}
-	/*row.row = cur_row;
-	row.width = j;*/
-	return -1;
+	fflush(stdout);
 }
 
-int count_valid_moves(state_t state) {
-	bitboard_t a = bb_moves(state);
-	int i, count = 0;
-	uint64_t table;
-	if (state.player == BLACK_STONE) {
-		table = a.black;
-	} else {
-		table = a.white;
+static int analyze(char *filename) {
+	reversi_analysis_t analysis;
+	reversi_t *ctx;
+	int res;
+
+	if (open_game(&ctx, filename) != EXIT_SUCCESS) {
+		return EXIT_FAILURE;
 	}
-	for (i = 0; i < a.size * a.size; i++) {
-		if (get_bit(table, i))
-			count++;
+	watch(ctx);
+	res = reversi_analyze(ctx, analysis_depth, analysis_lines, print_analysis, NULL, &analysis);
+	unwatch();
+	if (res == REVERSI_OK && analysis.num_lines == 0) {
+		printf("pass\n");
 	}
-	return count;
-}
-
-bitboard_t board_play(state_t state, move_t move) {
-	return bb_move(move, state);
+	if (res != REVERSI_OK) {
+		print_error(ctx, res);
+	}
+	reversi_free(ctx);
+	reversi_close_cache();
+	return res == REVERSI_OK ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-static int is_game_over(char ** board) {
-	/*int i, j, count = 0;
-	for (i = 0; i < board_size; i++) {
-		for (j = 0; j < board_size; j++) {
-			if (board[i][j] != EMPTY_STONE)
-				count++;
-		}
+static bool is_ai(char player) {
+	if (player == BLACK_STONE) {
+		return game_mode == 1 || game_mode == 3;
 	}
-	if (count == board_size*board_size)
-		return 1;
-	else 
-		return 0;*/
+	return game_mode == 2 || game_mode == 3;
 }
 
-void quit_program(state_t state) {
-	char string[200];
-	int i = 0;
-	printf("Quitting, do you want to save the game (y/N)? ");
-	fgets(string, 200, stdin);
-	while(string[i] == ' ' && string[i] != 0) {
-		i++;			
+static int ai_move(reversi_t *ctx) {
+	reversi_result_t result;
+	double black, white;
+	int res;
+
+	if ((res = think(ctx, &result)) != REVERSI_OK) {
+		return res;
 	}
-	if (string[i] != 0 && string[i] == 'y' || string[i] == 'Y') {
-		board_save(state);
+	if (result.stopped) {
+		printf("Stopped after %.3f s, at depth %d\n", result.elapsed, result.depth);
 	}
-	/*board_delete(state.board);*/
-	exit(EXIT_SUCCESS);
+	if (verbose && settings.clock_ms) {
+		reversi_clock(ctx, &black, &white);
+		printf("Depth %d in %.3f s (%.3f s planned), clock: 'X' %.1f s, 'O' %.1f s\n", result.depth,
+			result.elapsed, result.planned, black, white);
+	}
+	if (verbose && result.source == REVERSI_SOURCE_PONDER) {
+		printf("Ponder hit\n");
+	} else if (verbose && result.source == REVERSI_SOURCE_MCTS) {
+		printf("MCTS: %zu playouts in %.3f s (%.0f playouts/s, %d threads), %zu nodes of %zu bytes, %zu reused\n",
+			result.nodes, result.elapsed, result.nodes / result.elapsed, settings.threads,
+			result.tree_nodes, sizeof(mcts_node_t), result.tree_reused);
+	}
+	return reversi_play(ctx, result.square);
 }
 
-static state_t human_player(state_t state) {
+/* boards above 8x8 are played on wide bitboards; they cannot be loaded or saved */
+static void wide_game(void) {
 	char string[200];
+	wide_state_t state;
 	move_t move;
-	//board_print(state);
-	score_t score = bb_score(state.board);
-	printf("Score:\n'O': %d, 'X': %d\n", score.white, score.black);
-	
-	printf("'%c' player's turn.\n Give your move (e.g. 'A5' or 'a5'), press 'q' or 'Q' to quit: ", state.player);
-	memset(string,0,sizeof(string));
-	fgets(string, 199, stdin);
-	if (strstr(string, "q") || strstr(string, "Q")) {
-		quit_program(state);
-	}
-	move = read_move(string);
+	int pos, passes = 0, black, white;
 
-	bitboard_t res = board_play(state, move);
-	while(!res.size) {
-		printf("Move not valid. Try again: ");
-		fgets(string, 199, stdin);
-		move = read_move(string);
-		if (strstr(string, "q") || strstr(string, "Q")) {
-			quit_program(state);
+	state.board = wide_init(board_size);
+	state.player = BLACK_STONE;
+	printf("Welcome to this reversi game!\n");
+	printf("Black player(X) is human and white player (O) is human.\n");
+	printf("Black player start\n");
+	while (1) {
+		if (wide_is_zero(wide_moves(state))) {
+			if (++passes == 2) {
+				break;
+			}
+			printf("'%c' Does not have moves, turn changes\n", state.player);
+			wide_play(&state, WIDE_PASS);
+			continue;
+		}
+		passes = 0;
+		wide_print(state.board);
+		if (is_ai(state.player)) {
+			printf("\n");
+			wide_play(&state, wide_search(state, WIDE_SEARCH_DEPTH, NULL, NULL));
+			continue;
+		}
+		printf("Score:\n'O': %d, 'X': %d\n", wide_popcount(state.board.white), wide_popcount(state.board.black));
+		printf("'%c' player's turn.\n Give your move (e.g. 'A5' or 'a5'), press 'q' or 'Q' to quit: ", state.player);
+		while (1) {
+			memset(string, 0, sizeof(string));
+			if (fgets(string, 199, stdin) == NULL || strstr(string, "q") || strstr(string, "Q")) {
+				exit(EXIT_SUCCESS);
+			}
+			move = read_move(string);
+			pos = (move.row < board_size && move.column < board_size) ? one_dimension(move.row, move.column, board_size) : -2;
+			if (wide_play(&state, pos) == 0) {
+				break;
+			}
+			printf("Move not valid. Try again: ");
 		}
-		res = board_play(state, move);
 	}
-	state.board = res;
-	return state;
+	black = wide_popcount(state.board.black);
+	white = wide_popcount(state.board.white);
+	printf("Game over\n");
+	if (white > black) {
+		printf("Player 'O' win the game\n");
+	} else if (white < black) {
+		printf("Player 'X' win the game\n");
+	} else {
+		printf("Draw game, no winner\n");
+	}
+	wide_print(state.board);
+	printf("Score:\n'O': %d, 'X': %d\n", white, black);
+	printf("Thanks for playing, see you soon!\n");
 }
 
-void contest(char * line) {
-	state_t state = board_load(line);
-	move_t move = ai_player(state);
-	printf("%c%d\n", move.column + 'a', move.row + 1);
-	exit(0);
-}
+static int game(char * line) {
+	reversi_t *ctx;
+	int moves[REVERSI_MAX_SQUARES], black, white, res;
+	char turn;
 
-void game(char * line) {
-	char string[200];
-	char temporary_player;
-	move_t move;
-	state_t state;
-	if(line) {
-		state = board_load(line);
-	} else {
-		state = board_init(board_size);
+	if (board_size > MAX_BOARD_SIZE) {
+		if (line) {
+			fprintf(stderr, "reversi: error: boards above %dx%d cannot be loaded\n", MAX_BOARD_SIZE, MAX_BOARD_SIZE);
+			return EXIT_FAILURE;
+		}
+		wide_game();
+		return EXIT_SUCCESS;
+	}
+	if (open_game(&ctx, line) != EXIT_SUCCESS) {
+		return EXIT_FAILURE;
 	}
-	score_t score_tmp = bb_score(state.board);
-	if (score_tmp.black < 2 && score_tmp.white < 2) {
+	reversi_score(ctx, &black, &white);
+	if (black < 2 && white < 2) {
 		fprintf(stderr, "Incorrect board\n");
-		exit(EXIT_FAILURE);
+		reversi_free(ctx);
+		return EXIT_FAILURE;
 	}
-	
+
 	printf("Welcome to this reversi game!\n");
 	printf("Black player(X) is human and white player (O) is human.\n");
 	printf("Black player start\n");
-	int i = 0;
-	while(1) {
-		i++;
-		if (i==13) {
-			printf("n\n");
-		}
-		score_t score = bb_score(state.board);
-		if (count_valid_moves(state)== 0) {
-			temporary_player = state.player;
-			if (state.player == WHITE_STONE) {
-				state.player = BLACK_STONE;
-			} else {
-				state.player = WHITE_STONE;
-			}
-			if (count_valid_moves(state) == 0) {
-				printf("Game over\n");
-				if (score.white > score.black) {
-					printf("Player 'O' win the game\n");
-				} else if (score.white < score.black) {
-					printf("Player 'X' win the game\n");
-				} else {
-					printf("Draw game, no winner\n");
-				}
-				board_print(state);
-				printf("Score:\n'O': %d, 'X': %d\n", score.white, score.black);
-				printf("Thanks for playing, see you soon!\n");
-				//board_delete(state.board);
-				return;
-			}
-			printf("'%c' Does not have moves, turn changes\n", temporary_player);
+	while (!reversi_game_over(ctx)) {
+		turn = player(ctx);
+		if (reversi_moves(ctx, moves, REVERSI_MAX_SQUARES) == 0) {
+			printf("'%c' Does not have moves, turn changes\n", turn);
+			reversi_play(ctx, REVERSI_PASS);
+			continue;
 		}
-		board_print(state);
-		if (state.player == BLACK_STONE && (game_mode == 1 || game_mode == 3)) {
-			printf("\n");
-			move_t move = ai_player(state);
-			bitboard_t res = board_play(state, move);
-			
-			state.board = res;
-			if (res.size == 0) {
-				bb_moves(state);
-			}
-		} else if (state.player == WHITE_STONE && (game_mode == 2 || game_mode == 3)) {
+		reversi_print(ctx);
+		if (is_ai(turn)) {
 			printf("\n");
-			move_t move = ai_player(state);
-			bitboard_t res = board_play(state, move);
-			state.board = res;
-			if (res.size == 0) {
-				bb_moves(state);
+			if ((res = ai_move(ctx)) != REVERSI_OK) {
+				print_error(ctx, res);
+				reversi_free(ctx);
+				return EXIT_FAILURE;
 			}
 		} else {
-			state = human_player(state);
-		}
-		
-		if (state.player == WHITE_STONE) {
-			state.player = BLACK_STONE;
-		} else {
-			state.player = WHITE_STONE;
+			if (ponder && is_ai(turn == BLACK_STONE ? WHITE_STONE : BLACK_STONE)) {
+				reversi_ponder(ctx, 1);
+			}
+			human_player(ctx);
 		}
 	}
+	reversi_score(ctx, &black, &white);
+	printf("Game over\n");
+	if (white > black) {
+		printf("Player 'O' win the game\n");
+	} else if (white < black) {
+		printf("Player 'X' win the game\n");
+	} else {
+		printf("Draw game, no winner\n");
+	}
+	reversi_print(ctx);
+	printf("Score:\n'O': %d, 'X': %d\n", white, black);
+	if (ponder && verbose) {
+		ponder_stats_t stats = ponder_stats();
+		printf("Ponder: %zu hits, %zu misses\n", stats.hits, stats.misses);
+	}
+	printf("Thanks for playing, see you soon!\n");
+	reversi_free(ctx);
+	return EXIT_SUCCESS;
 }
 
 move_t read_move(char * string) {
@@ -517,7 +543,7 @@ move_t read_move(char * string) {
 		letter++;
 	
 	y = tolower(letter[0]) - 'a';
-	if (y > 7 || y < 0) {
+	if (y >= (int) board_size || y < 0) {
 		move.column = -1;
 		move.row = -1;
 		return move;
@@ -529,7 +555,7 @@ move_t read_move(char * string) {
 	
 	if (isdigit(*letter)) {
 		x = atoi(letter);
-		if (x > 8) {
+		if (x > (int) board_size) {
 			move.column = -1;
 			move.row = -1;
 			return move;
@@ -551,11 +577,30 @@ int main(int argc, char *argv[]) {
 	int optc;
 	bool other_prev_options = false, end = false;
 	char *filename = NULL;
+	struct sigaction sa;
 	struct option long_opts[] = {
 		{"size", required_argument, NULL, 's'},
 		{"black-ai", no_argument, NULL, 'b'},
 		{"white-ai", no_argument, NULL, 'w'},
 		{"all-ai", no_argument, NULL, 'a'},
+		{"ponder", no_argument, NULL, 'p'},
+		{"cache", required_argument, NULL, 'C'},
+		{"engine", required_argument, NULL, 'e'},
+		{"threads", required_argument, NULL, 't'},
+		{"seed", required_argument, NULL, 'S'},
+		{"probcut", required_argument, NULL, 'P'},
+		{"database", required_argument, NULL, 'D'},
+		{"network", required_argument, NULL, 'n'},
+		{"prove", required_argument, NULL, 'r'},
+		{"nodes", required_argument, NULL, 'N'},
+		{"bench-suite", required_argument, NULL, 'B'},
+		{"limit", required_argument, NULL, 'L'},
+		{"analyze", required_argument, NULL, 'A'},
+		{"lines", required_argument, NULL, 'l'},
+		{"depth", required_argument, NULL, 'd'},
+		{"time", required_argument, NULL, 'T'},
+		{"clock", required_argument, NULL, 'k'},
+		{"schedule", required_argument, NULL, 'K'},
 		{"verbose", no_argument, NULL, 'v'},
 		{"Version", no_argument, NULL, 'V'},
 		{"contest", required_argument, NULL, 'c'},
@@ -564,8 +609,24 @@ int main(int argc, char *argv[]) {
 	};
 	board_size = 8;
 	verbose = false;
+	ponder = false;
 	game_mode = 0;
-	while(((optc = getopt_long (argc, argv, "s:bwavVc:h", long_opts, NULL)) != 1) && !end) {
+	reversi_default_settings(&settings);
+	prove_nodes = 0;
+	suite_limit = 0;
+	analysis_depth = ANALYSIS_DEPTH;
+	analysis_lines = 0;
+	move_time = 0;
+	/* sigaction keeps the handlers after the first signal, where signal() may reset them */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = interrupt;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGALRM, &sa, NULL);
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	while(((optc = getopt_long (argc, argv, "s:bwapC:e:t:S:P:D:n:r:N:B:L:A:l:d:T:k:K:vVc:h", long_opts, NULL)) != 1) && !end) {
 		switch(optc) {
 			case 's':
 				other_prev_options = 1;
@@ -574,10 +635,10 @@ int main(int argc, char *argv[]) {
 				else
 					board_size = 2*atoi(optarg);
 				if (board_size < 2) {
-					fprintf(stderr, "Board size too small (1-4)\n");
+					fprintf(stderr, "Board size too small (1-8)\n");
 					return EXIT_FAILURE;
-				} else if (board_size > 8) {
-					fprintf(stderr, "Board size too big (1-4)\n");
+				} else if (board_size > WIDE_MAX_SIZE) {
+					fprintf(stderr, "Board size too big (1-8)\n");
 					return EXIT_FAILURE;
 				}
 				optind += 1;
@@ -603,13 +664,114 @@ int main(int argc, char *argv[]) {
 				other_prev_options = 1;
 				game_mode = 2;
 				break;
+			case 'p':
+				other_prev_options = 1;
+				ponder = true;
+				break;
+			case 'e':
+				other_prev_options = 1;
+				if (strcmp(optarg, "mcts") == 0) {
+					settings.engine = REVERSI_MCTS;
+				} else if (strcmp(optarg, "alphabeta") == 0) {
+					settings.engine = REVERSI_ALPHABETA;
+				} else {
+					fprintf(stderr, "reversi: error: unknown engine '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 't':
+				other_prev_options = 1;
+				if (atoi(optarg) < 1) {
+					fprintf(stderr, "reversi: error: invalid number of threads '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				settings.threads = atoi(optarg) < MCTS_MAX_THREADS ? atoi(optarg) : MCTS_MAX_THREADS;
+				break;
+			case 'S':
+				other_prev_options = 1;
+				/* seed 0 leaves MCTS random; a fixed seed of 0 plays as seed 1 */
+				settings.seed = strtoull(optarg, NULL, 0) ? strtoull(optarg, NULL, 0) : 1;
+				break;
+			case 'P':
+				other_prev_options = 1;
+				if (reversi_load_probcut(optarg) != REVERSI_OK) {
+					fprintf(stderr, "reversi: error: cannot load ProbCut parameters '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'D':
+				other_prev_options = 1;
+				if (reversi_open_database(optarg) != REVERSI_OK) {
+					fprintf(stderr, "reversi: error: cannot open database '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'n':
+				other_prev_options = 1;
+				if (reversi_load_network(optarg) != REVERSI_OK) {
+					fprintf(stderr, "reversi: error: cannot load network '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'N':
+				other_prev_options = 1;
+				prove_nodes = strtoull(optarg, NULL, 0);
+				break;
+			case 'r':
+				return prove(optarg);
+			case 'L':
+				other_prev_options = 1;
+				suite_limit = atof(optarg);
+				break;
+			case 'B':
+				return bench_suite(optarg);
+			case 'l':
+				other_prev_options = 1;
+				analysis_lines = atoi(optarg);
+				break;
+			case 'd':
+				other_prev_options = 1;
+				if (atoi(optarg) < 1) {
+					fprintf(stderr, "reversi: error: invalid depth '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				settings.depth = analysis_depth = atoi(optarg);
+				break;
+			case 'T':
+				other_prev_options = 1;
+				move_time = atoi(optarg);
+				break;
+			case 'k':
+				other_prev_options = 1;
+				if (atof(optarg) <= 0) {
+					fprintf(stderr, "reversi: error: invalid clock '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				settings.clock_ms = (int) (atof(optarg) * 1000);
+				break;
+			case 'K':
+				other_prev_options = 1;
+				if (reversi_load_schedule(optarg) != REVERSI_OK) {
+					fprintf(stderr, "reversi: error: cannot load schedule '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'A':
+				return analyze(optarg);
+			case 'C':
+				other_prev_options = 1;
+				if (reversi_open_cache(optarg) != REVERSI_OK) {
+					fprintf(stderr, "reversi: error: cannot open cache '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
 			case '?':
 				usage(EXIT_FAILURE);
 				return EXIT_FAILURE;
 			case 'c':
 				filename = malloc(sizeof(char)*(strlen(argv[optind]) + 1));
 				strcpy(filename, argv[optind]);
-				contest(filename);
+				return contest(filename);
 			default:
 				if (argv[optind]) {
 					filename = malloc(sizeof(char)*(strlen(argv[optind]) + 1));
@@ -619,6 +781,5 @@ int main(int argc, char *argv[]) {
 				break;
 		}
 	}
-	game(filename);
-	return 0;
+	return game(filename);
 }
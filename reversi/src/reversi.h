@@ -5,7 +5,6 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
-#include <regex.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <ctype.h>
@@ -44,40 +43,8 @@ typedef struct {
 	bitboard_t board;
 } state_t;
 
-typedef struct {
-	char* row;
-	size_t width;
-} row_t;
-
-
-char read_column(char * line);
-
 char* trim_white_spaces(char* input);
 
-row_t read_row(char * line, int num_line);
-
-char read_current_player(char * line);
-
-static state_t board_init(size_t width);
-
-static void board_delete(char** board);
-
-static score_t board_score(state_t state);
-
-static void board_print(state_t state);
-
-static void board_save(state_t state);
-
-static state_t board_load(char * filename);
-
-int is_there_comment(char * line);
-
-int is_first_line_correct(char * line);
-
-int is_line_correct(char * line);
-
-char read_column(char * line);
-
 int is_move_valid(state_t state, move_t move);
 
 int is_up_valid(state_t state,int x,int y,char player);
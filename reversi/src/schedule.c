@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <time.h>
+#include "../include/schedule.h"
+#include "../include/tt.h"
+#include "../include/pcache.h"
+#include "../include/util.h"
+
+#define CALIBRATION_NODES 10000
+#define CALIBRATION_MIN_EMPTIES 6
+#define SOLVE_MIN_EMPTIES 6
+#define SOLVE_MAX_EMPTIES 20
+
+typedef struct {
+	double n, x, y, xx, xy;
+} fit_t;
+
+static uint64_t rng_next(uint64_t *s) {
+	uint64_t x = *s;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*s = x;
+	return x * 0x2545f4914f6cdd1dULL;
+}
+
+static uint64_t moves_of(state_t state) {
+	return (state.player == BLACK_STONE)
+		? bb_mobility(state.board.black, state.board.white, state.board.size)
+		: bb_mobility(state.board.white, state.board.black, state.board.size);
+}
+
+static int mobility(state_t state) {
+	int m = __builtin_popcountll(moves_of(state));
+	return m ? m : 1;
+}
+
+/* random moves from the start until empties are left, with moves for the side to move */
+static state_t random_position(uint64_t *rng, int empties) {
+	uint64_t *own, *opp, moves, flips;
+	state_t state;
+	int passes, n, square;
+
+	do {
+		state.board = bb_init(8);
+		state.player = BLACK_STONE;
+		passes = 0;
+		while (bb_empties(state.board) > empties && passes < 2) {
+			own = (state.player == BLACK_STONE) ? &state.board.black : &state.board.white;
+			opp = (state.player == BLACK_STONE) ? &state.board.white : &state.board.black;
+			if ((moves = moves_of(state)) != 0) {
+				for (n = rng_next(rng) % __builtin_popcountll(moves); n > 0; n--)
+					moves &= moves - 1;
+				square = __builtin_ctzll(moves);
+				flips = bb_flips(*own, *opp, square, 8);
+				*own |= flips | (uint64_t) 1 << square;
+				*opp &= ~flips;
+				passes = 0;
+			} else {
+				passes++;
+			}
+			state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		}
+	} while (passes || moves_of(state) == 0);
+	return state;
+}
+
+static void fit_add(fit_t *f, double x, double y) {
+	f->n++;
+	f->x += x;
+	f->y += y;
+	f->xx += x * x;
+	f->xy += x * y;
+}
+
+/* least squares of log(nodes / moves) over x: exp of the intercept and of the slope */
+static int fit_solve(const fit_t *f, double *base, double *growth) {
+	double det = f->n * f->xx - f->x * f->x, slope;
+
+	if (f->n < 3 || det <= 0) {
+		return -1;
+	}
+	slope = (f->n * f->xy - f->x * f->y) / det;
+	if (slope <= 0) {
+		return -1;
+	}
+	*growth = exp(slope);
+	*base = exp((f->y - slope * f->x) / f->n);
+	return 0;
+}
+
+/* rough figures for an unmeasured machine, from a debug build of the stability evaluation */
+void schedule_default(schedule_t *s) {
+	static const double base[SCHEDULE_PHASES] = { 1.35, 1.18, 1.43, 1.75 };
+	static const double ebf[SCHEDULE_PHASES] = { 3.05, 3.71, 3.11, 2.10 };
+	int p;
+
+	s->nps = 900000;
+	for (p = 0; p < SCHEDULE_PHASES; p++) {
+		s->base[p] = base[p];
+		s->ebf[p] = ebf[p];
+	}
+	s->solve_nps = 1200000;
+	s->solve_base = 0.30;
+	s->solve_ebf = 2.67;
+}
+
+/*
+ * Iterative deepening of random positions of every phase until an
+ * iteration passes CALIBRATION_NODES, for most of the time, then solves
+ * of more and more empties. Searches run on the transposition table of the
+ * caller, cleared for every position, and without the persistent cache,
+ * which would keep the random positions and time the next calibration's
+ * solves on cached nodes. Phases without enough samples keep the defaults.
+ */
+int schedule_calibrate(schedule_t *s, double seconds, int (*heuristic) (state_t state)) {
+	fit_t fits[SCHEDULE_PHASES] = { { 0 } }, solve = { 0 };
+	double start = util_now(), t, elapsed = 0, solve_elapsed = 0;
+	size_t nodes = 0, solve_nodes = 0, n;
+	uint64_t rng = 0x9e3779b97f4a7c15ULL;
+	state_t state;
+	int p, d, e, round, m, fitted = 0;
+
+	schedule_default(s);
+	pcache_bypass(1);
+	for (round = 0; util_now() - start < seconds * 0.7; round++) {
+		p = round % SCHEDULE_PHASES;
+		e = 60 - 15 * p - (int) (rng_next(&rng) % 15);
+		if (e < CALIBRATION_MIN_EMPTIES)
+			e = CALIBRATION_MIN_EMPTIES;
+		state = random_position(&rng, e);
+		m = mobility(state);
+		tt_clear();
+		for (d = 1, n = 0; d <= bb_empties(state.board) && n < CALIBRATION_NODES
+				&& util_now() - start < seconds * 0.7; d++) {
+			t = util_now();
+			negamax_alphabeta_search(state, d, heuristic);
+			elapsed += util_now() - t;
+			n = bb_search_nodes();
+			nodes += n;
+			if (n > 0)
+				fit_add(&fits[probcut_phase(state.board.black | state.board.white, 8)], d - 1, log((double) n / m));
+		}
+	}
+	for (e = SOLVE_MIN_EMPTIES; e <= SOLVE_MAX_EMPTIES && util_now() - start < seconds; e++) {
+		state = random_position(&rng, e);
+		t = util_now();
+		ai_solve(state, NULL);
+		t = util_now() - t;
+		solve_elapsed += t;
+		solve_nodes += bb_search_nodes();
+		fit_add(&solve, e - 1, log((double) bb_search_nodes() / mobility(state)));
+		/* the next empties would take more than the time left */
+		if (t * s->solve_ebf > seconds - (util_now() - start))
+			break;
+	}
+	pcache_bypass(0);
+
+	if (elapsed > 0 && nodes > 0)
+		s->nps = nodes / elapsed;
+	if (solve_elapsed > 0 && solve_nodes > 0)
+		s->solve_nps = solve_nodes / solve_elapsed;
+	for (p = 0; p < SCHEDULE_PHASES; p++)
+		fitted += fit_solve(&fits[p], &s->base[p], &s->ebf[p]) == 0;
+	fitted += fit_solve(&solve, &s->solve_base, &s->solve_ebf) == 0;
+	return fitted == SCHEDULE_PHASES + 1 ? 0 : -1;
+}
+
+/* text file: "nps N", "phase P BASE EBF" lines and "solve NPS BASE EBF" */
+int schedule_load(const char *filename, schedule_t *s) {
+	FILE *f = fopen(filename, "r");
+	char line[256];
+	schedule_t loaded;
+	double base, ebf;
+	int p, res = 0;
+
+	if (f == NULL) {
+		return -1;
+	}
+	schedule_default(&loaded);
+	while (res == 0 && fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "phase %d %lf %lf", &p, &base, &ebf) == 3) {
+			if (p < 0 || p >= SCHEDULE_PHASES || base <= 0 || ebf <= 1) {
+				res = -1;
+				break;
+			}
+			loaded.base[p] = base;
+			loaded.ebf[p] = ebf;
+		} else if (sscanf(line, "solve %lf %lf %lf", &loaded.solve_nps, &loaded.solve_base, &loaded.solve_ebf) == 3) {
+			res = (loaded.solve_nps > 0 && loaded.solve_base > 0 && loaded.solve_ebf > 1) ? 0 : -1;
+		} else if (sscanf(line, "nps %lf", &loaded.nps) == 1) {
+			res = loaded.nps > 0 ? 0 : -1;
+		} else {
+			res = -1;
+		}
+	}
+	fclose(f);
+	if (res == 0) {
+		*s = loaded;
+	}
+	return res;
+}
+
+int schedule_save(const char *filename, const schedule_t *s) {
+	FILE *f = fopen(filename, "w");
+	int p;
+
+	if (f == NULL) {
+		return -1;
+	}
+	fprintf(f, "# alpha-beta nodes per second, then per phase: phase P BASE EBF\n");
+	fprintf(f, "nps %.0f\n", s->nps);
+	for (p = 0; p < SCHEDULE_PHASES; p++)
+		fprintf(f, "phase %d %.4f %.4f\n", p, s->base[p], s->ebf[p]);
+	fprintf(f, "# solver: solve NPS BASE EBF\n");
+	fprintf(f, "solve %.0f %.4f %.4f\n", s->solve_nps, s->solve_base, s->solve_ebf);
+	return fclose(f);
+}
+
+/* seconds of every iteration up to depth */
+double schedule_search_time(const schedule_t *s, state_t state, int depth) {
+	int p = probcut_phase(state.board.black | state.board.white, state.board.size);
+	double ebf = s->ebf[p];
+
+	return mobility(state) * s->base[p] * (pow(ebf, depth) - 1) / (ebf - 1) / s->nps;
+}
+
+/* seconds to solve the position, as if it had empties left */
+double schedule_solve_time(const schedule_t *s, state_t state, int empties) {
+	return mobility(state) * s->solve_base * pow(s->solve_ebf, empties - 1) / s->solve_nps;
+}
+
+void schedule_plan(const schedule_t *s, state_t state, double clock, int max_depth, schedule_plan_t *plan) {
+	double usable = clock * (1 - SCHEDULE_RESERVE);
+	int empties = bb_empties(state.board), e, moves;
+
+	if (usable < 1e-3)
+		usable = 1e-3;
+	plan->solve_empties = 0;
+	for (e = empties; e > 0; e--) {
+		if (schedule_solve_time(s, state, e) <= SCHEDULE_SOLVE_SHARE * usable) {
+			plan->solve_empties = e;
+			break;
+		}
+	}
+	plan->solve = empties <= plan->solve_empties;
+	if (plan->solve) {
+		plan->depth = empties;
+		plan->budget = schedule_solve_time(s, state, empties);
+		plan->limit = usable;
+		return;
+	}
+	/* one move of ours in two plies until the solve */
+	moves = (empties - plan->solve_empties + 1) / 2;
+	plan->budget = usable * (1 - SCHEDULE_SOLVE_SHARE) / (moves > 1 ? moves : 1);
+	for (plan->depth = 1; plan->depth < max_depth && plan->depth < empties
+			&& schedule_search_time(s, state, plan->depth + 1) <= plan->budget; plan->depth++);
+	plan->limit = SCHEDULE_HARD_LIMIT * plan->budget < usable ? SCHEDULE_HARD_LIMIT * plan->budget : usable;
+}
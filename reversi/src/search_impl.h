@@ -0,0 +1,270 @@
+/*
+ * Search bodies, included by bitboard.c once per evaluator. Before each
+ * inclusion SEARCH_SUFFIX names the variant and SEARCH_EVAL(s, own, opp,
+ * player) evaluates a leaf for player, whose discs are own. With a static
+ * inline evaluator every leaf is inlined into the search loop. SEARCH_CACHE
+ * says whether leaf values may be kept in the evaluation cache.
+ */
+#define SEARCH_PASTE(name, suffix) name##_##suffix
+#define SEARCH_NAME(name, suffix) SEARCH_PASTE(name, suffix)
+#define SEARCH_FN(name) SEARCH_NAME(name, SEARCH_SUFFIX)
+
+/* leaf values are from the root player's point of view */
+static algo_t SEARCH_FN(minimax_aux)(search_t *s, int depth, char root) {
+	algo_t res, v;
+	uint64_t moves = search_moves(s);
+	int square, maximizing = (s->player == root);
+
+	res.move = search_move(s, SEARCH_PASS);
+	if (depth == 0 || moves == 0) {
+		res.v = (s->player == root) ? SEARCH_EVAL(s, s->own, s->opp, root)
+			: SEARCH_EVAL(s, s->opp, s->own, root);
+		return res;
+	}
+	res.v = maximizing ? INT_MIN : INT_MAX;
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		search_play(s, square);
+		v = SEARCH_FN(minimax_aux)(s, depth - 1, root);
+		search_undo(s);
+		if (maximizing ? v.v > res.v : v.v < res.v) {
+			res.v = v.v;
+			res.move = search_move(s, square);
+		}
+	}
+	return res;
+}
+
+static algo_t SEARCH_FN(negamax_aux)(search_t *s, int depth) {
+	algo_t res, v;
+	uint64_t moves = search_moves(s);
+	int square;
+
+	res.move = search_move(s, SEARCH_PASS);
+	if (depth == 0 || moves == 0) {
+		res.v = SEARCH_EVAL(s, s->own, s->opp, s->player);
+		return res;
+	}
+	res.v = INT_MIN;
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		search_play(s, square);
+		v = SEARCH_FN(negamax_aux)(s, depth - 1);
+		search_undo(s);
+		if (-v.v > res.v) {
+			res.v = -v.v;
+			res.move = search_move(s, square);
+		}
+	}
+	return res;
+}
+
+static algo_t SEARCH_FN(minimax_alphabeta_aux)(search_t *s, int depth, int alpha, int beta, char root) {
+	algo_t res, v;
+	uint64_t moves = search_moves(s);
+	int square, maximizing = (s->player == root);
+
+	res.move = search_move(s, SEARCH_PASS);
+	if (depth == 0 || moves == 0) {
+		res.v = (s->player == root) ? SEARCH_EVAL(s, s->own, s->opp, root)
+			: SEARCH_EVAL(s, s->opp, s->own, root);
+		return res;
+	}
+	res.v = maximizing ? INT_MIN : INT_MAX;
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		search_play(s, square);
+		v = SEARCH_FN(minimax_alphabeta_aux)(s, depth - 1, alpha, beta, root);
+		search_undo(s);
+		if (maximizing ? v.v > res.v : v.v < res.v) {
+			res.v = v.v;
+			res.move = search_move(s, square);
+		}
+		if (maximizing)
+			alpha = max(alpha, v.v);
+		else
+			beta = min(beta, v.v);
+		if (beta <= alpha)
+			break;
+	}
+	return res;
+}
+
+static algo_t SEARCH_FN(negamax_alphabeta_aux)(search_t *s, int depth, int alpha, int beta) {
+	algo_t res, v;
+	tt_entry_t entry;
+	const probcut_t *pc = probcut_active();
+	const probcut_param_t *p;
+	ecache_t *cache = NULL;
+	ecache_entry_t *slot = NULL;
+	int square, hash_square = -1, alpha_orig, flag, check, shallow, bound, phase;
+	uint64_t key, moves;
+
+	res.v = -SCORE_INF;
+	res.move = search_move(s, SEARCH_PASS);
+	if (bb_search_stopped()) {
+		return res;
+	}
+
+	key = search_key(s);
+	if (tt_probe(key, &entry)) {
+		if (entry.depth >= depth) {
+			if (entry.flag == TT_EXACT) {
+				res.v = entry.value;
+				res.move = entry.move;
+				return res;
+			} else if (entry.flag == TT_LOWER) {
+				alpha = max(alpha, entry.value);
+			} else {
+				beta = min(beta, entry.value);
+			}
+			if (alpha >= beta) {
+				res.v = entry.value;
+				res.move = entry.move;
+				return res;
+			}
+		}
+		if (entry.move.row < s->size && entry.move.column < s->size)
+			hash_square = one_dimension(entry.move.row, entry.move.column, s->size);
+	}
+	alpha_orig = alpha;
+
+	/* Multi-ProbCut: shallow null-window searches predict a deep cutoff */
+	for (check = 0; pc && depth >= PROBCUT_MIN_DEPTH && depth <= PROBCUT_MAX_DEPTH
+			&& check < PROBCUT_CHECKS; check++) {
+		p = &pc->params[probcut_phase(s->own | s->opp, s->size)][depth][check];
+		shallow = probcut_shallow(depth, check);
+		if (p->a <= 0 || shallow <= 0)
+			continue;
+		if (beta < SCORE_INF) {
+			bound = probcut_clamp(ceil((beta + pc->confidence[check] * p->sigma - p->b) / p->a));
+			if (SEARCH_FN(negamax_alphabeta_aux)(s, shallow, bound - 1, bound).v >= bound) {
+				res.v = beta;
+				return res;
+			}
+		}
+		if (alpha > -SCORE_INF) {
+			bound = probcut_clamp(floor((alpha - pc->confidence[check] * p->sigma - p->b) / p->a));
+			if (SEARCH_FN(negamax_alphabeta_aux)(s, shallow, bound, bound + 1).v <= bound) {
+				res.v = alpha;
+				return res;
+			}
+		}
+		if (bb_search_stopped()) {
+			return res;
+		}
+	}
+
+	phase = probcut_phase(s->own | s->opp, s->size);
+	if (ecache_enabled(phase) && (cache = ecache_get()) != NULL) {
+		slot = ecache_slot(cache, key);
+		cache->stats.probes[phase][0]++;
+	}
+	if (slot && ecache_has(cache, slot, ECACHE_MOVES)) {
+		moves = slot->moves;
+		cache->stats.hits[phase][0]++;
+	} else {
+		moves = search_moves(s);
+		if (slot) {
+			slot->moves = moves;
+			slot->flags |= ECACHE_MOVES;
+		}
+	}
+	if (depth == 0 || moves == 0) {
+		if (SEARCH_CACHE && slot) {
+			cache->stats.probes[phase][1]++;
+			if (ecache_has(cache, slot, ECACHE_VALUE)) {
+				cache->stats.hits[phase][1]++;
+				res.v = slot->value;
+				return res;
+			}
+		}
+		res.v = SEARCH_EVAL(s, s->own, s->opp, s->player);
+		if (SEARCH_CACHE && slot) {
+			slot->value = res.v;
+			slot->generation = cache->generation;
+			slot->flags |= ECACHE_VALUE;
+		}
+		return res;
+	}
+	if (hash_square >= 0 && !(moves >> hash_square & 1)) {
+		hash_square = -1;
+	}
+
+	/* the move stored in the table is tried first, then the rest in board order */
+	while (moves) {
+		if (hash_square >= 0) {
+			square = hash_square;
+			hash_square = -1;
+		} else {
+			square = __builtin_ctzll(moves);
+		}
+		moves &= ~((uint64_t) 1 << square);
+		search_play(s, square);
+		v = SEARCH_FN(negamax_alphabeta_aux)(s, depth - 1, -beta, -alpha);
+		search_undo(s);
+		if (bb_search_stopped()) {
+			return res;
+		}
+		v.v *= -1;
+		if (v.v > res.v) {
+			res.v = v.v;
+			res.move = search_move(s, square);
+		}
+		alpha = max(alpha, v.v);
+		if (alpha >= beta)
+			break;
+	}
+
+	if (res.v <= alpha_orig) {
+		flag = TT_UPPER;
+	} else if (res.v >= beta) {
+		flag = TT_LOWER;
+	} else {
+		flag = TT_EXACT;
+	}
+	tt_store(key, depth, res.v, flag, res.move);
+	return res;
+}
+
+/* principal variation search: null windows after the first move */
+static algo_t SEARCH_FN(negascout_aux)(search_t *s, int depth, int alpha, int beta) {
+	algo_t res, v;
+	uint64_t moves = search_moves(s);
+	int square, first = 1;
+
+	res.move = search_move(s, SEARCH_PASS);
+	if (depth == 0 || moves == 0) {
+		res.v = SEARCH_EVAL(s, s->own, s->opp, s->player);
+		return res;
+	}
+	res.v = -SCORE_INF;
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		search_play(s, square);
+		if (first) {
+			v = SEARCH_FN(negascout_aux)(s, depth - 1, -beta, -alpha);
+			first = 0;
+		} else {
+			v = SEARCH_FN(negascout_aux)(s, depth - 1, -alpha - 1, -alpha);
+			if (-v.v > alpha && -v.v < beta)
+				v = SEARCH_FN(negascout_aux)(s, depth - 1, -beta, -alpha);
+		}
+		search_undo(s);
+		if (-v.v > res.v) {
+			res.v = -v.v;
+			res.move = search_move(s, square);
+		}
+		alpha = max(alpha, res.v);
+		if (alpha >= beta)
+			break;
+	}
+	return res;
+}
+
+#undef SEARCH_FN
+#undef SEARCH_NAME
+#undef SEARCH_PASTE
+#undef SEARCH_EVAL
+#undef SEARCH_CACHE
+#undef SEARCH_SUFFIX
@@ -0,0 +1,238 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/solvedb.h"
+#include "../include/util.h"
+
+static uint8_t *map = NULL;
+static size_t map_length = 0;
+static size_t map_size = 0;
+static size_t map_count = 0;
+
+/* squares in key order, for each size and symmetry; centers come first */
+static int8_t orders[SOLVEDB_MAX_SIZE + 1][8][SOLVEDB_MAX_SIZE * SOLVEDB_MAX_SIZE];
+/* share of one row of the board in each symmetric key, by base 3 row index */
+static uint64_t row_keys[SOLVEDB_MAX_SIZE / 2 + 1][8][SOLVEDB_MAX_SIZE][729];
+static uint16_t base3[1 << SOLVEDB_MAX_SIZE];
+static int orders_ready = 0;
+static pthread_once_t orders_once = PTHREAD_ONCE_INIT;
+
+static int is_center(int pos, int size) {
+	int row = pos / size, col = pos % size;
+	return (row == size / 2 - 1 || row == size / 2) && (col == size / 2 - 1 || col == size / 2);
+}
+
+static void init_orders(void) {
+	uint64_t place[SOLVEDB_MAX_SIZE * SOLVEDB_MAX_SIZE], key;
+	int size, sym, pos, n, i, row, index, digit, col, x;
+
+	for (x = 0; x < (1 << SOLVEDB_MAX_SIZE); x++) {
+		for (i = SOLVEDB_MAX_SIZE - 1, base3[x] = 0; i >= 0; i--)
+			base3[x] = 3 * base3[x] + ((x >> i) & 1);
+	}
+	for (size = 2; size <= SOLVEDB_MAX_SIZE; size += 2) {
+		for (sym = 0; sym < 8; sym++) {
+			n = 0;
+			for (pos = 0; pos < size * size; pos++) {
+				if (is_center(pos, size))
+					orders[size][sym][n++] = bb_symmetry_square(pos, size, sym);
+			}
+			for (pos = 0; pos < size * size; pos++) {
+				if (!is_center(pos, size))
+					orders[size][sym][n++] = bb_symmetry_square(pos, size, sym);
+			}
+			/* a center holds a binary digit, set for the opponent */
+			for (i = n - 1, key = 1; i >= 0; i--) {
+				place[(int) orders[size][sym][i]] = key;
+				key *= (i >= 4) ? 3 : 2;
+			}
+			for (row = 0; row < size; row++) {
+				for (index = 0; index < 729; index++) {
+					key = 0;
+					for (col = 0, x = index; col < size; col++, x /= 3) {
+						digit = x % 3;
+						pos = row * size + col;
+						key += is_center(pos, size) ? (digit == 2) * place[pos] : digit * place[pos];
+					}
+					row_keys[size / 2][sym][row][index] = key;
+				}
+			}
+		}
+	}
+	__atomic_store_n(&orders_ready, 1, __ATOMIC_RELEASE);
+}
+
+/* built by one thread only; the flag saves the call once they are ready */
+static inline void need_orders(void) {
+	if (!__atomic_load_n(&orders_ready, __ATOMIC_ACQUIRE))
+		pthread_once(&orders_once, init_orders);
+}
+
+uint64_t solvedb_key(uint64_t own, uint64_t opp, size_t size) {
+	uint64_t keys[8] = { 0 }, best = UINT64_MAX, mask = (1 << size) - 1;
+	int sym, row, index;
+
+	need_orders();
+	for (row = 0; row < (int) size; row++) {
+		index = base3[(own >> (row * size)) & mask] + 2 * base3[(opp >> (row * size)) & mask];
+		for (sym = 0; sym < 8; sym++)
+			keys[sym] += row_keys[size / 2][sym][row][index];
+	}
+	for (sym = 0; sym < 8; sym++)
+		best = (keys[sym] < best) ? keys[sym] : best;
+	return best;
+}
+
+void solvedb_decode(uint64_t key, size_t size, uint64_t *own, uint64_t *opp) {
+	const int8_t *order;
+	int i, digit;
+
+	need_orders();
+	order = orders[size][0];
+	*own = *opp = 0;
+	for (i = size * size - 1; i >= 4; i--, key /= 3) {
+		digit = key % 3;
+		*own |= (uint64_t) (digit == 1) << order[i];
+		*opp |= (uint64_t) (digit == 2) << order[i];
+	}
+	for (; i >= 0; i--, key /= 2) {
+		*own |= (uint64_t) !(key & 1) << order[i];
+		*opp |= (uint64_t) (key & 1) << order[i];
+	}
+}
+
+int solvedb_write(const char *filename, size_t size, const uint64_t *records, size_t count) {
+	uint8_t header[SOLVEDB_HEADER_SIZE], buffer[8 * 1024];
+	char name[1024];
+	size_t i, n = 0;
+	int res = 0;
+	FILE *f;
+
+	snprintf(name, sizeof(name), "%s.tmp", filename);
+	f = fopen(name, "wb");
+	if (f == NULL) {
+		return -1;
+	}
+	memset(header, 0, sizeof(header));
+	memcpy(header, "RVSD", 4);
+	header[4] = SOLVEDB_VERSION;
+	header[5] = size;
+	util_put64(header + 8, count);
+	res |= fwrite(header, SOLVEDB_HEADER_SIZE, 1, f) != 1;
+	for (i = 0; i < count; i++) {
+		util_put64(buffer + n, records[i]);
+		n += 8;
+		if (n == sizeof(buffer) || i + 1 == count) {
+			res |= fwrite(buffer, n, 1, f) != 1;
+			n = 0;
+		}
+	}
+	res |= fflush(f) != 0 || fsync(fileno(f)) != 0;
+	res |= fclose(f) != 0;
+	if (res || rename(name, filename) != 0) {
+		remove(name);
+		return -1;
+	}
+	return 0;
+}
+
+int solvedb_open(const char *filename) {
+	struct stat st;
+	int fd;
+
+	solvedb_close();
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < SOLVEDB_HEADER_SIZE) {
+		close(fd);
+		return -1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		map = NULL;
+		return -1;
+	}
+	map_length = st.st_size;
+	map_size = map[5];
+	map_count = util_get64(map + 8);
+	if (memcmp(map, "RVSD", 4) != 0 || map[4] != SOLVEDB_VERSION || map_size < MIN_BOARD_SIZE
+			|| map_size > SOLVEDB_MAX_SIZE || SOLVEDB_HEADER_SIZE + map_count * 8 > map_length) {
+		solvedb_close();
+		return -1;
+	}
+	return 0;
+}
+
+void solvedb_close(void) {
+	if (map) {
+		munmap(map, map_length);
+	}
+	map = NULL;
+	map_length = 0;
+	map_count = 0;
+}
+
+size_t solvedb_count(void) {
+	return map_count;
+}
+
+int solvedb_probe(uint64_t own, uint64_t opp, size_t size, int *value) {
+	uint64_t key, record;
+	size_t lo = 0, hi = map_count, mid;
+
+	if (map == NULL || size != map_size) {
+		return 0;
+	}
+	key = solvedb_key(own, opp, size);
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		record = util_get64(map + SOLVEDB_HEADER_SIZE + mid * 8);
+		if ((record >> SOLVEDB_VALUE_BITS) == key) {
+			*value = (int) (record & ((1 << SOLVEDB_VALUE_BITS) - 1)) - SOLVEDB_VALUE_BIAS;
+			return 1;
+		} else if ((record >> SOLVEDB_VALUE_BITS) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return 0;
+}
+
+/* best move from the values of the children; every one of them must be known */
+int solvedb_move(state_t state, move_t *move, int *value) {
+	uint64_t own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	uint64_t opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	uint64_t moves, flips;
+	size_t size = state.board.size;
+	int square, v, best = -SCORE_INF;
+
+	if (map == NULL || size != map_size) {
+		return 0;
+	}
+	moves = bb_mobility(own, opp, size);
+	if (moves == 0) {
+		return 0;
+	}
+	for (; moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		flips = bb_flips(own, opp, square, size);
+		if (!solvedb_probe(opp & ~flips, own | flips | (uint64_t) 1 << square, size, &v)) {
+			return 0;
+		}
+		if (-v > best) {
+			best = -v;
+			move->row = square % size;
+			move->column = square / size;
+		}
+	}
+	if (value) {
+		*value = best;
+	}
+	return 1;
+}
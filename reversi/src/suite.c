@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/suite.h"
+#include "../include/tt.h"
+#include "../include/util.h"
+
+/* "d3" to its bit index, -1 when it is not a square of the board */
+int suite_square(const char *name, size_t size) {
+	int col = tolower((unsigned char) name[0]) - 'a', row = atoi(name + 1) - 1;
+
+	if (col < 0 || col >= (int) size || row < 0 || row >= (int) size || !isdigit((unsigned char) name[1])) {
+		return -1;
+	}
+	return row * size + col;
+}
+
+/* the suites name the column first: the board name of the transposed square */
+void suite_square_name(int square, size_t size, char name[BOARD_SQUARE_NAME]) {
+	board_square_name(square < 0 ? square : (int) ((square % size) * size + square / size), size, name);
+}
+
+/* the header of a position, 0 when the comment is not one */
+static int parse_header(const char *line, suite_position_t *position) {
+	char kind[8], moves[64], *move, *save;
+	int n;
+
+	if (sscanf(line, "# %31s %7s %n", position->name, kind, &n) != 2) {
+		return 0;
+	}
+	line += n;
+	if (strcmp(kind, "solve") == 0) {
+		position->depth = SUITE_DEPTH_SOLVE;
+	} else if (strcmp(kind, "depth") != 0 || sscanf(line, "%d %n", &position->depth, &n) != 1
+		|| position->depth < 1) {
+		return 0;
+	} else {
+		line += n;
+	}
+	if (sscanf(line, "%63s %d", moves, &position->score) != 2) {
+		return 0;
+	}
+	position->num_best = 0;
+	for (move = strtok_r(moves, ",", &save); move && position->num_best < SUITE_MAX_BEST;
+			move = strtok_r(NULL, ",", &save)) {
+		position->best[position->num_best++] = suite_square(move, MAX_BOARD_SIZE);
+	}
+	return position->num_best > 0;
+}
+
+int suite_load(const char *filename, suite_t *suite) {
+	board_file_t file;
+	board_reader_t reader;
+	suite_position_t position, *positions;
+	const char *p, *eol;
+	int res, header, capacity = 0, i;
+
+	suite->positions = NULL;
+	suite->count = 0;
+	suite->error[0] = 0;
+	if (board_file_open(filename, &file) != 0) {
+		snprintf(suite->error, sizeof(suite->error), "reversi: error: cannot open '%s'", filename);
+		return -1;
+	}
+	board_reader_init(&reader, file.data, file.length);
+	for (;;) {
+		/* the comments before the board, board_read skips them again */
+		header = 0;
+		for (p = reader.cur; p < reader.end; p = eol + 1) {
+			if ((eol = memchr(p, '\n', reader.end - p)) == NULL)
+				eol = reader.end;
+			while (p < eol && isspace((unsigned char) *p))
+				p++;
+			if (p < eol && *p != '#')
+				break;
+			if (p < eol && parse_header(p, &position))
+				header = 1;
+		}
+		res = board_read(&reader, &position.state);
+		if (res == BOARD_END) {
+			break;
+		} else if (res == BOARD_ERROR) {
+			memcpy(suite->error, reader.error, sizeof(suite->error));
+			break;
+		}
+		if (!header) {
+			snprintf(suite->error, sizeof(suite->error),
+				"reversi: error: board ending at line %d has no '# NAME solve|depth D MOVES SCORE' header",
+				reader.line);
+			res = BOARD_ERROR;
+			break;
+		}
+		/* squares were read for the largest board */
+		for (i = 0; i < position.num_best; i++) {
+			if (position.best[i] >= 0)
+				position.best[i] = position.best[i] / MAX_BOARD_SIZE * position.state.board.size
+					+ position.best[i] % MAX_BOARD_SIZE;
+		}
+		if (suite->count == capacity) {
+			capacity = capacity ? 2 * capacity : 64;
+			positions = realloc(suite->positions, capacity * sizeof(suite_position_t));
+			if (positions == NULL) {
+				snprintf(suite->error, sizeof(suite->error), "No memory available");
+				res = BOARD_ERROR;
+				break;
+			}
+			suite->positions = positions;
+		}
+		suite->positions[suite->count++] = position;
+	}
+	board_file_close(&file);
+	if (res == BOARD_ERROR) {
+		suite_free(suite);
+		return -1;
+	}
+	return 0;
+}
+
+void suite_free(suite_t *suite) {
+	free(suite->positions);
+	suite->positions = NULL;
+	suite->count = 0;
+}
+
+/* solve or search one position, with at most limit seconds when limit > 0 */
+int suite_run(const suite_position_t *position, double limit, suite_result_t *result) {
+	watchdog_t w;
+	algo_t res;
+	move_t move;
+	double start;
+	int i, stop = 0, timed = 0, fired = 0;
+
+	if (limit > 0) {
+		timed = watchdog_start(&w, limit, &stop) == 0;
+	}
+
+	tt_clear();
+	bb_search_flag(&stop);
+	start = util_now();
+	if (position->depth == SUITE_DEPTH_SOLVE) {
+		move = ai_solve(position->state, &result->score);
+	} else {
+		res = negamax_alphabeta_search(position->state, position->depth, stability_heuristic);
+		move = res.move;
+		result->score = res.v;
+	}
+	result->elapsed = util_now() - start;
+	result->nodes = bb_search_nodes();
+	result->move = (move.row < position->state.board.size && move.column < position->state.board.size)
+		? (int) one_dimension(move.row, move.column, position->state.board.size) : -1;
+
+	bb_search_flag(NULL);
+	if (timed) {
+		fired = watchdog_stop(&w);
+	}
+
+	if (fired) {
+		result->status = SUITE_TIMEOUT;
+	} else if (result->score != position->score) {
+		result->status = SUITE_WRONG_SCORE;
+	} else {
+		result->status = SUITE_WRONG_MOVE;
+		for (i = 0; i < position->num_best; i++) {
+			if (position->best[i] == result->move)
+				result->status = SUITE_PASS;
+		}
+	}
+	return result->status;
+}
@@ -0,0 +1,130 @@
+#include "../include/tt.h"
+
+/*
+ * Shared transposition table. Each slot keeps the key xor'ed with its data
+ * word, so a slot torn by two threads writing at once fails the key check
+ * instead of returning a wrong entry, and no lock is needed. A thread may
+ * switch to a table of its own with tt_use.
+ */
+static tt_table_t shared = { NULL, 0 };
+static __thread tt_table_t *local = NULL;
+
+static inline tt_table_t *current(void) {
+	return local ? local : &shared;
+}
+
+static uint64_t mix(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+uint64_t tt_key(uint64_t black, uint64_t white, size_t size, char player) {
+	uint64_t key;
+	key = mix(black) ^ mix(white ^ 0x9e3779b97f4a7c15ULL);
+	key ^= mix(size << 8 | (player == BLACK_STONE));
+	return key;
+}
+
+uint64_t bb_hash(bitboard_t board, char player) {
+	return tt_key(board.black, board.white, board.size, player);
+}
+
+uint64_t bb_canonical_hash(bitboard_t board, char player, int *sym) {
+	uint64_t key, best = UINT64_MAX;
+	int i;
+	for (i = 0; i < 8; i++) {
+		key = bb_hash(bb_symmetry(board, i), player);
+		if (key < best) {
+			best = key;
+			if (sym)
+				*sym = i;
+		}
+	}
+	return best;
+}
+
+int tt_table_init(tt_table_t *t, int bits) {
+	t->slots = calloc((size_t) 1 << bits, sizeof(tt_slot_t));
+	if (t->slots == NULL) {
+		t->mask = 0;
+		return -1;
+	}
+	t->mask = ((uint64_t) 1 << bits) - 1;
+	return 0;
+}
+
+void tt_table_free(tt_table_t *t) {
+	free(t->slots);
+	t->slots = NULL;
+	t->mask = 0;
+}
+
+void tt_use(tt_table_t *t) {
+	local = t;
+}
+
+int tt_init(int bits) {
+	tt_free();
+	return tt_table_init(&shared, bits);
+}
+
+void tt_free(void) {
+	tt_table_free(&shared);
+}
+
+void tt_clear(void) {
+	tt_table_t *t = current();
+	if (t->slots) {
+		memset(t->slots, 0, (t->mask + 1) * sizeof(tt_slot_t));
+	}
+}
+
+int tt_probe(uint64_t key, tt_entry_t *entry) {
+	tt_table_t *t = current();
+	tt_slot_t *slot;
+	uint64_t check, data;
+
+	if (t->slots == NULL) {
+		return 0;
+	}
+	slot = &t->slots[key & t->mask];
+	check = __atomic_load_n(&slot->check, __ATOMIC_RELAXED);
+	data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+	if (data == 0 || (check ^ data) != key) {
+		return 0;
+	}
+	entry->value = (int32_t) (uint32_t) data;
+	entry->depth = (data >> 32) & 0xff;
+	entry->flag = (data >> 40) & 0x7f;
+	entry->move.row = (data >> 48) & 0xff;
+	entry->move.column = (data >> 56) & 0xff;
+	return 1;
+}
+
+void tt_store(uint64_t key, int depth, int value, int flag, move_t move) {
+	tt_table_t *t = current();
+	tt_slot_t *slot;
+	uint64_t data;
+	tt_entry_t old;
+
+	if (t->slots == NULL) {
+		return;
+	}
+	slot = &t->slots[key & t->mask];
+	/* keep the deeper result for the same position */
+	if (tt_probe(key, &old) && old.depth > depth) {
+		return;
+	}
+	data = (uint64_t) (uint32_t) value;
+	data |= (uint64_t) (depth & 0xff) << 32;
+	data |= (uint64_t) (flag & 0x7f) << 40;
+	data |= (uint64_t) 1 << 47; /* slot in use */
+	data |= (uint64_t) (move.row & 0xff) << 48;
+	data |= (uint64_t) (move.column & 0xff) << 56;
+	__atomic_store_n(&slot->check, key ^ data, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+}
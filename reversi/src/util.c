@@ -0,0 +1,54 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include "../include/util.h"
+
+static void *watchdog_main(void *arg) {
+	watchdog_t *w = arg;
+	int res = 0;
+
+	pthread_mutex_lock(&w->lock);
+	while (!w->done && res != ETIMEDOUT)
+		res = pthread_cond_timedwait(&w->done_cond, &w->lock, &w->deadline);
+	if (!w->done) {
+		w->fired = 1;
+		__atomic_store_n(w->stop, 1, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&w->lock);
+	return NULL;
+}
+
+int watchdog_start(watchdog_t *w, double seconds, int *stop) {
+	pthread_condattr_t attr;
+
+	w->done = w->fired = 0;
+	w->stop = stop;
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&w->done_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	clock_gettime(CLOCK_MONOTONIC, &w->deadline);
+	w->deadline.tv_sec += (time_t) seconds;
+	w->deadline.tv_nsec += (long) ((seconds - (time_t) seconds) * 1e9);
+	if (w->deadline.tv_nsec >= 1000000000) {
+		w->deadline.tv_sec++;
+		w->deadline.tv_nsec -= 1000000000;
+	}
+	if (pthread_create(&w->thread, NULL, watchdog_main, w) != 0) {
+		pthread_cond_destroy(&w->done_cond);
+		pthread_mutex_destroy(&w->lock);
+		return -1;
+	}
+	return 0;
+}
+
+int watchdog_stop(watchdog_t *w) {
+	pthread_mutex_lock(&w->lock);
+	w->done = 1;
+	pthread_cond_signal(&w->done_cond);
+	pthread_mutex_unlock(&w->lock);
+	pthread_join(w->thread, NULL);
+	pthread_cond_destroy(&w->done_cond);
+	pthread_mutex_destroy(&w->lock);
+	return w->fired;
+}
@@ -0,0 +1,202 @@
+#include "../include/wide.h"
+
+static wide_t wide_masks[WIDE_MAX_SIZE + 1][3];
+static int wide_masks_ready = 0;
+
+/* full board, all but the first column, all but the last column */
+static void init_wide_masks(void) {
+	size_t size, i;
+	for (size = 1; size <= WIDE_MAX_SIZE; size++) {
+		wide_masks[size][0] = wide_zero();
+		for (i = 0; i < size * size; i++)
+			wide_masks[size][0] = wide_or(wide_masks[size][0], wide_bit(i));
+		wide_masks[size][1] = wide_masks[size][2] = wide_masks[size][0];
+		for (i = 0; i < size; i++) {
+			wide_masks[size][1] = wide_andnot(wide_masks[size][1], wide_bit(i * size));
+			wide_masks[size][2] = wide_andnot(wide_masks[size][2], wide_bit(i * size + size - 1));
+		}
+	}
+	__atomic_store_n(&wide_masks_ready, 1, __ATOMIC_RELEASE);
+}
+
+static inline const wide_t *masks_of(size_t size) {
+	if (!__atomic_load_n(&wide_masks_ready, __ATOMIC_ACQUIRE))
+		init_wide_masks();
+	return wide_masks[size];
+}
+
+static inline wide_t shift(wide_t x, int dir, size_t size, const wide_t *masks) {
+	switch (dir) {
+	case 0:
+		return wide_shl(wide_and(x, masks[2]), 1);
+	case 1:
+		return wide_shr(wide_and(x, masks[1]), 1);
+	case 2:
+		return wide_and(wide_shl(x, size), masks[0]);
+	case 3:
+		return wide_shr(x, size);
+	case 4:
+		return wide_and(wide_shl(wide_and(x, masks[2]), size + 1), masks[0]);
+	case 5:
+		return wide_and(wide_shl(wide_and(x, masks[1]), size - 1), masks[0]);
+	case 6:
+		return wide_shr(wide_and(x, masks[2]), size - 1);
+	default:
+		return wide_shr(wide_and(x, masks[1]), size + 1);
+	}
+}
+
+wide_t wide_mobility(wide_t own, wide_t opp, size_t size) {
+	const wide_t *masks = masks_of(size);
+	wide_t empty, moves = wide_zero(), t;
+	int dir, i;
+
+	empty = wide_andnot(masks[0], wide_or(own, opp));
+	for (dir = 0; dir < 8; dir++) {
+		t = wide_and(shift(own, dir, size, masks), opp);
+		for (i = 3; i < (int) size; i++) {
+			t = wide_or(t, wide_and(shift(t, dir, size, masks), opp));
+		}
+		moves = wide_or(moves, wide_and(shift(t, dir, size, masks), empty));
+	}
+	return moves;
+}
+
+wide_t wide_flips(wide_t own, wide_t opp, int pos, size_t size) {
+	const wide_t *masks = masks_of(size);
+	wide_t flips = wide_zero(), line, x;
+	int dir;
+
+	for (dir = 0; dir < 8; dir++) {
+		line = wide_zero();
+		x = shift(wide_bit(pos), dir, size, masks);
+		while (!wide_is_zero(wide_and(x, opp))) {
+			line = wide_or(line, x);
+			x = shift(x, dir, size, masks);
+		}
+		if (!wide_is_zero(wide_and(x, own)))
+			flips = wide_or(flips, line);
+	}
+	return flips;
+}
+
+wide_board_t wide_init(size_t size) {
+	wide_board_t board;
+	int first = (size / 2 - 1) * size + size / 2 - 1;
+
+	board.size = size;
+	board.white = wide_or(wide_bit(first), wide_bit(first + size + 1));
+	board.black = wide_or(wide_bit(first + 1), wide_bit(first + size));
+	return board;
+}
+
+void wide_print(wide_board_t board) {
+	int i, width = (board.size > 9) ? 3 : 2;
+
+	printf("\t");
+	for (i = 0; i < (int) board.size; i++) {
+		printf("%-*d", width, i + 1);
+	}
+	for (i = 0; i < (int) (board.size * board.size); i++) {
+		if (i % board.size == 0) {
+			printf("\n%c\t", 'A' + (int) (i / board.size));
+		}
+		if (wide_test(board.white, i)) {
+			printf("%-*c", width, 'O');
+		} else if (wide_test(board.black, i)) {
+			printf("%-*c", width, 'X');
+		} else {
+			printf("%-*c", width, '_');
+		}
+	}
+	printf("\n");
+}
+
+wide_t wide_moves(wide_state_t state) {
+	if (state.player == BLACK_STONE) {
+		return wide_mobility(state.board.black, state.board.white, state.board.size);
+	}
+	return wide_mobility(state.board.white, state.board.black, state.board.size);
+}
+
+/* plays pos (or passes) for the side to move and hands over the turn; -1 if illegal */
+int wide_play(wide_state_t *state, int pos) {
+	wide_t *own = (state->player == BLACK_STONE) ? &state->board.black : &state->board.white;
+	wide_t *opp = (state->player == BLACK_STONE) ? &state->board.white : &state->board.black;
+	wide_t flips;
+
+	if (pos != WIDE_PASS) {
+		if (pos < 0 || pos >= (int) (state->board.size * state->board.size)
+				|| !wide_test(wide_mobility(*own, *opp, state->board.size), pos)) {
+			return -1;
+		}
+		flips = wide_flips(*own, *opp, pos, state->board.size);
+		*own = wide_or(wide_xor(*own, flips), wide_bit(pos));
+		*opp = wide_xor(*opp, flips);
+	}
+	state->player = (state->player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	return 0;
+}
+
+#define BOARD_SUFFIX narrow
+#define BOARD_T uint64_t
+#define BOARD_MOBILITY(own, opp, size) bb_mobility(own, opp, size)
+#define BOARD_FLIPS(own, opp, pos, size) bb_flips(own, opp, pos, size)
+#define BOARD_XOR(a, b) ((a) ^ (b))
+#define BOARD_OR(a, b) ((a) | (b))
+#define BOARD_BIT(pos) ((uint64_t) 1 << (pos))
+#define BOARD_IS_ZERO(x) ((x) == 0)
+#define BOARD_FIRST(x) __builtin_ctzll(x)
+#define BOARD_CLEAR_FIRST(x) ((x) & ((x) - 1))
+#define BOARD_COUNT(x) __builtin_popcountll(x)
+#include "board_impl.h"
+
+#define BOARD_SUFFIX words
+#define BOARD_T wide_t
+#define BOARD_MOBILITY(own, opp, size) wide_mobility(own, opp, size)
+#define BOARD_FLIPS(own, opp, pos, size) wide_flips(own, opp, pos, size)
+#define BOARD_XOR(a, b) wide_xor(a, b)
+#define BOARD_OR(a, b) wide_or(a, b)
+#define BOARD_BIT(pos) wide_bit(pos)
+#define BOARD_IS_ZERO(x) wide_is_zero(x)
+#define BOARD_FIRST(x) wide_first(x)
+#define BOARD_CLEAR_FIRST(x) wide_clear_first(x)
+#define BOARD_COUNT(x) wide_popcount(x)
+#include "board_impl.h"
+
+uint64_t wide_perft(wide_state_t state, int depth) {
+	wide_t own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	wide_t opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+
+	if (state.board.size <= MAX_BOARD_SIZE) {
+		return perft_narrow(own.w[0], opp.w[0], state.board.size, depth, 0);
+	}
+	return perft_words(own, opp, state.board.size, depth, 0);
+}
+
+uint64_t wide_perft_words(wide_state_t state, int depth) {
+	wide_t own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	wide_t opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	return perft_words(own, opp, state.board.size, depth, 0);
+}
+
+/* best square for the side to move, WIDE_PASS if it has none */
+int wide_search(wide_state_t state, int depth, int *value, size_t *nodes) {
+	wide_t own = (state.player == BLACK_STONE) ? state.board.black : state.board.white;
+	wide_t opp = (state.player == BLACK_STONE) ? state.board.white : state.board.black;
+	size_t count = 0;
+	int best, v;
+
+	if (state.board.size <= MAX_BOARD_SIZE) {
+		v = alphabeta_narrow(own.w[0], opp.w[0], state.board.size, depth, -SCORE_INF, SCORE_INF, &best, &count);
+	} else {
+		v = alphabeta_words(own, opp, state.board.size, depth, -SCORE_INF, SCORE_INF, &best, &count);
+	}
+	if (value) {
+		*value = v;
+	}
+	if (nodes) {
+		*nodes = count;
+	}
+	return best;
+}
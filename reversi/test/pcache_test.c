@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <sys/wait.h>
+#include "../include/pcache.h"
+
+#define RECORDS PCACHE_BATCH
+#define THREADS 4
+#define THREAD_RECORDS 1000
+#define CACHE "pcache_test.cache"
+
+/*
+ * Two processes on one cache: a child appends its results and exits, then
+ * this process appends its own. Its next refresh must see every result
+ * of the child, though its own batch landed after them in the journal.
+ * Then threads of this process store and probe at once, as parallel
+ * solves do, and every result must stay in the cache.
+ */
+
+static state_t position(int i, int owner) {
+	state_t state;
+
+	state.board.size = 8;
+	state.board.black = 0x0000000810000000ULL | (uint64_t) (i + 1) << 1;
+	state.board.white = 0x0000001008000000ULL | (uint64_t) owner << 60;
+	state.player = BLACK_STONE;
+	return state;
+}
+
+static void store(int owner) {
+	move_t move = { 0, 0 };
+	int i;
+
+	for (i = 0; i < RECORDS; i++) {
+		pcache_store(position(i, owner), PCACHE_MIN_EMPTIES, i, i, move);
+	}
+}
+
+static void *store_probe(void *arg) {
+	int owner = 2 + (int) (intptr_t) arg;
+	move_t move = { 0, 0 };
+	pcache_entry_t entry;
+	int i;
+
+	for (i = 0; i < THREAD_RECORDS; i++) {
+		pcache_store(position(i, owner), PCACHE_MIN_EMPTIES, i % 64, i % 64, move);
+		pcache_probe(position(i / 2, owner), &entry);
+		if (i % 100 == 0) {
+			pcache_refresh();
+		}
+	}
+	return NULL;
+}
+
+static int threads(void) {
+	pthread_t thread[THREADS];
+	pcache_entry_t entry;
+	int i, t, found = 0;
+
+	for (t = 0; t < THREADS; t++) {
+		pthread_create(&thread[t], NULL, store_probe, (void *) (intptr_t) t);
+	}
+	for (t = 0; t < THREADS; t++) {
+		pthread_join(thread[t], NULL);
+	}
+	for (t = 0; t < THREADS; t++) {
+		for (i = 0; i < THREAD_RECORDS; i++) {
+			found += pcache_probe(position(i, 2 + t), &entry) && entry.lower == i % 64;
+		}
+	}
+	printf("pcache_test: %d of %d results stored by %d threads at once\n", found, THREADS * THREAD_RECORDS, THREADS);
+	return found == THREADS * THREAD_RECORDS;
+}
+
+int main(void) {
+	pcache_entry_t entry;
+	pid_t pid;
+	int i, status, ok, found = 0;
+
+	remove(CACHE);
+	remove(CACHE ".log");
+	if (pcache_open(CACHE) != 0) {
+		fprintf(stderr, "pcache_test: error: cannot open '%s'\n", CACHE);
+		return EXIT_FAILURE;
+	}
+	pid = fork();
+	if (pid == 0) {
+		pcache_close();
+		if (pcache_open(CACHE) != 0) {
+			_exit(EXIT_FAILURE);
+		}
+		store(1);
+		pcache_close();
+		_exit(EXIT_SUCCESS);
+	}
+	if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+		fprintf(stderr, "pcache_test: error: the writing process failed\n");
+		return EXIT_FAILURE;
+	}
+	store(0);
+	pcache_refresh();
+	for (i = 0; i < RECORDS; i++) {
+		found += pcache_probe(position(i, 1), &entry) && entry.lower == i;
+	}
+	printf("pcache_test: %d of %d results of the other process after a refresh\n", found, RECORDS);
+	ok = found == RECORDS && threads();
+	pcache_close();
+	remove(CACHE);
+	remove(CACHE ".log");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,60 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include "../include/libreversi.h"
+#include "../include/ponder.h"
+
+#define SIZE 6
+#define PONDER_MS 1000
+
+/*
+ * A ponder miss still pays: the context searches deeper than pondering
+ * goes, so the response cache misses, but the pondered entries are in the
+ * context's table and the search needs fewer nodes than on a fresh one.
+ */
+
+/* the first move of each side, pondering the second for ponder ms, and the search after it */
+static int search_reply(reversi_t *ctx, int ponder, reversi_result_t *result) {
+	struct timespec pause = { ponder / 1000, (ponder % 1000) * 1000000L };
+	int squares[REVERSI_MAX_SQUARES];
+
+	reversi_moves(ctx, squares, REVERSI_MAX_SQUARES);
+	if (reversi_play(ctx, squares[0]) != REVERSI_OK) {
+		return -1;
+	}
+	if (ponder) {
+		reversi_ponder(ctx, 1);
+		nanosleep(&pause, NULL);
+	}
+	reversi_moves(ctx, squares, REVERSI_MAX_SQUARES);
+	if (reversi_play(ctx, squares[0]) != REVERSI_OK || reversi_search(ctx, result) != REVERSI_OK) {
+		return -1;
+	}
+	return 0;
+}
+
+int main(void) {
+	reversi_settings_t settings;
+	reversi_result_t pondered, fresh;
+	reversi_t *a, *b;
+
+	reversi_default_settings(&settings);
+	settings.evaluator = REVERSI_EVAL_STABILITY;
+	settings.depth = PONDER_MAX_DEPTH + 1;
+	if (reversi_new(&a, SIZE, &settings) != REVERSI_OK || reversi_new(&b, SIZE, &settings) != REVERSI_OK) {
+		fprintf(stderr, "ponder_test: error: no memory available\n");
+		return EXIT_FAILURE;
+	}
+	if (search_reply(a, PONDER_MS, &pondered) != 0 || search_reply(b, 0, &fresh) != 0) {
+		fprintf(stderr, "ponder_test: error: %s\n", reversi_error(a));
+		return EXIT_FAILURE;
+	}
+	reversi_free(a);
+	reversi_free(b);
+	printf("ponder_test: depth %d after a ponder miss in %zu nodes, %zu without pondering\n", pondered.depth,
+		pondered.nodes, fresh.nodes);
+	if (pondered.source == REVERSI_SOURCE_PONDER || pondered.nodes >= fresh.nodes) {
+		fprintf(stderr, "ponder_test: error: the search did not reuse the pondered table\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+#include "../include/pcache.h"
+
+static void usage(void) {
+	printf("Usage: rvcache compact CACHE [OTHER_CACHE...]\n"
+	"       rvcache stats CACHE\n"
+	"Maintain persistent result caches written by 'reversi -C CACHE'\n"
+	"\n\t compact\t fold the journal of CACHE, and every other cache given,\n"
+	"\t\t\t into a fresh table for CACHE\n"
+	"\t stats\t\t print the table and journal sizes of CACHE\n");
+}
+
+int main(int argc, char *argv[]) {
+	pcache_stats_t stats;
+
+	if (argc >= 3 && strcmp(argv[1], "compact") == 0) {
+		if (pcache_compact(argv[2], argv + 3, argc - 3) != 0) {
+			fprintf(stderr, "rvcache: cannot compact '%s'\n", argv[2]);
+			return EXIT_FAILURE;
+		}
+		argv[1] = "stats";
+	}
+	if (argc >= 3 && strcmp(argv[1], "stats") == 0) {
+		if (pcache_open(argv[2]) != 0) {
+			fprintf(stderr, "rvcache: cannot open '%s'\n", argv[2]);
+			return EXIT_FAILURE;
+		}
+		stats = pcache_stats();
+		printf("%s: %zu positions in %zu slots, %zu journal records\n", argv[2],
+			stats.used, stats.slots, stats.journal);
+		pcache_close();
+		return EXIT_SUCCESS;
+	}
+	usage();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,348 @@
+#include "../include/board_io.h"
+#include "../include/record.h"
+
+#define WTHOR_HEADER_SIZE 16
+#define WTHOR_GAME_SIZE 68
+#define WTHOR_MOVES 60
+
+static void usage(void) {
+	printf("Usage: rvconvert COMMAND INPUT OUTPUT\n"
+	"Convert positions and games between formats\n"
+	"\n\t text2pos\t text boards to binary positions\n"
+	"\t pos2text\t binary positions to text boards\n"
+	"\t wthor\t\t WTHOR archive (.wtb) to binary games\n"
+	"\t ggf\t\t GGF archive to binary games\n"
+	"\t games2ggf\t binary games to GGF\n"
+	"\t games2pos\t every position of binary games to binary positions\n"
+	"\t games2text\t every position of binary games to text boards\n");
+}
+
+static int game_finish(game_t *game) {
+	state_t states[RECORD_MAX_MOVES + 1];
+	score_t score;
+
+	if (game_replay(game, states) != 0) {
+		return -1;
+	}
+	score = bb_score(states[game->num_moves].board);
+	game->score = (int) score.black - (int) score.white;
+	return 0;
+}
+
+/* standard notation has the letter on columns, this program on rows */
+static int square(int letter, int digit, size_t size) {
+	return letter * size + digit;
+}
+
+static int text_to_pos(const char *input, const char *output) {
+	board_file_t file;
+	board_reader_t reader;
+	record_file_t rf;
+	state_t state;
+	int res;
+
+	if (board_file_open(input, &file) != 0) {
+		fprintf(stderr, "rvconvert: cannot open '%s'\n", input);
+		return -1;
+	}
+	if (pos_writer_open(&rf, output) != 0) {
+		fprintf(stderr, "rvconvert: cannot create '%s'\n", output);
+		board_file_close(&file);
+		return -1;
+	}
+	board_reader_init(&reader, file.data, file.length);
+	while ((res = board_read(&reader, &state)) == BOARD_OK) {
+		pos_write(&rf, state);
+	}
+	if (res == BOARD_ERROR) {
+		fprintf(stderr, "%s\n", reader.error);
+	}
+	printf("%llu positions\n", (unsigned long long) rf.count);
+	board_file_close(&file);
+	return record_close(&rf) || res == BOARD_ERROR ? -1 : 0;
+}
+
+static int pos_to_text(const char *input, const char *output) {
+	record_file_t rf;
+	state_t state;
+	FILE *f;
+	int res;
+
+	if (pos_reader_open(&rf, input) != 0) {
+		fprintf(stderr, "rvconvert: cannot read positions from '%s'\n", input);
+		return -1;
+	}
+	f = fopen(output, "w");
+	if (f == NULL) {
+		fprintf(stderr, "rvconvert: cannot create '%s'\n", output);
+		record_close(&rf);
+		return -1;
+	}
+	while ((res = pos_read(&rf, &state)) == 1) {
+		board_write(f, state);
+	}
+	record_close(&rf);
+	fclose(f);
+	return res;
+}
+
+static int wthor_to_games(const char *input, const char *output) {
+	board_file_t file;
+	record_file_t rf;
+	game_t game;
+	const uint8_t *p;
+	uint32_t count, i, bad = 0;
+	int j, m;
+
+	if (board_file_open(input, &file) != 0 || file.length < WTHOR_HEADER_SIZE) {
+		fprintf(stderr, "rvconvert: cannot read WTHOR file '%s'\n", input);
+		return -1;
+	}
+	p = (const uint8_t *) file.data;
+	count = p[4] | p[5] << 8 | p[6] << 16 | (uint32_t) p[7] << 24;
+	if (p[12] != 0 && p[12] != 8) {
+		fprintf(stderr, "rvconvert: only 8x8 WTHOR files are supported\n");
+		board_file_close(&file);
+		return -1;
+	}
+	if (WTHOR_HEADER_SIZE + (size_t) count * WTHOR_GAME_SIZE > file.length) {
+		count = (file.length - WTHOR_HEADER_SIZE) / WTHOR_GAME_SIZE;
+	}
+	if (game_writer_open(&rf, output) != 0) {
+		fprintf(stderr, "rvconvert: cannot create '%s'\n", output);
+		board_file_close(&file);
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		p = (const uint8_t *) file.data + WTHOR_HEADER_SIZE + (size_t) i * WTHOR_GAME_SIZE;
+		game_new(&game, 8);
+		/* moves are 10 * row + column, both from 1, and 0 ends the game */
+		for (j = 0; j < WTHOR_MOVES && p[8 + j]; j++) {
+			m = p[8 + j];
+			game.moves[game.num_moves++] = square(m % 10 - 1, m / 10 - 1, 8);
+		}
+		if (game_finish(&game) != 0) {
+			bad++;
+			continue;
+		}
+		game_write(&rf, &game);
+	}
+	printf("%llu games, %u rejected\n", (unsigned long long) rf.count, bad);
+	board_file_close(&file);
+	return record_close(&rf);
+}
+
+static const char *ggf_board(const char *p, const char *end, game_t *game) {
+	int size = 0, k = 0, cells;
+	char c;
+
+	while (p < end && isdigit(*p)) {
+		size = size * 10 + (*p++ - '0');
+	}
+	if (size < MIN_BOARD_SIZE || size > MAX_BOARD_SIZE) {
+		return NULL;
+	}
+	game_new(game, size);
+	game->start.board.black = game->start.board.white = 0;
+	cells = size * size;
+	for (; p < end && *p != ']'; p++) {
+		c = *p;
+		if (c != '-' && c != '*' && c != 'O') {
+			continue;
+		}
+		if (k == cells) {
+			game->start.player = (c == 'O') ? WHITE_STONE : BLACK_STONE;
+			continue;
+		}
+		if (c == '*') {
+			game->start.board.black |= (uint64_t) 1 << square(k % size, k / size, size);
+		} else if (c == 'O') {
+			game->start.board.white |= (uint64_t) 1 << square(k % size, k / size, size);
+		}
+		k++;
+	}
+	if (k != cells) {
+		return NULL;
+	}
+	if (game->start.board.black != bb_init(size).black || game->start.board.white != bb_init(size).white
+			|| game->start.player != BLACK_STONE) {
+		game->flags |= GAME_CUSTOM_START;
+	}
+	return p;
+}
+
+static int ggf_to_games(const char *input, const char *output) {
+	board_file_t file;
+	record_file_t rf;
+	game_t game;
+	const char *p, *end, *value;
+	char tag[4];
+	int len, in_game = 0, bad = 0, letter, digit;
+
+	if (board_file_open(input, &file) != 0) {
+		fprintf(stderr, "rvconvert: cannot read GGF file '%s'\n", input);
+		return -1;
+	}
+	if (game_writer_open(&rf, output) != 0) {
+		fprintf(stderr, "rvconvert: cannot create '%s'\n", output);
+		board_file_close(&file);
+		return -1;
+	}
+	p = file.data;
+	end = p + file.length;
+	while (p < end) {
+		if (p + 1 < end && p[0] == '(' && p[1] == ';') {
+			game_new(&game, 8);
+			in_game = 1;
+			p += 2;
+			continue;
+		}
+		if (p + 1 < end && p[0] == ';' && p[1] == ')') {
+			if (in_game && game_finish(&game) == 0) {
+				game_write(&rf, &game);
+			} else if (in_game) {
+				bad++;
+			}
+			in_game = 0;
+			p += 2;
+			continue;
+		}
+		if (!in_game || !isupper(*p)) {
+			p++;
+			continue;
+		}
+		for (len = 0; p < end && isupper(*p); p++) {
+			if (len < 3) {
+				tag[len++] = *p;
+			}
+		}
+		tag[len] = 0;
+		if (p >= end || *p != '[') {
+			continue;
+		}
+		value = ++p;
+		if (strcmp(tag, "BO") == 0) {
+			p = ggf_board(value, end, &game);
+			if (p == NULL) {
+				in_game = 0;
+				bad++;
+				p = value;
+			}
+		} else if ((strcmp(tag, "B") == 0 || strcmp(tag, "W") == 0) && end - value >= 2) {
+			letter = tolower(value[0]) - 'a';
+			digit = value[1] - '1';
+			/* passes ("pa") are implied by the replay */
+			if (letter >= 0 && letter < game.size && digit >= 0 && digit < game.size
+					&& game.num_moves < RECORD_MAX_MOVES) {
+				game.moves[game.num_moves++] = square(letter, digit, game.size);
+			}
+		}
+		while (p < end && *p != ']')
+			p++;
+	}
+	printf("%llu games, %d rejected\n", (unsigned long long) rf.count, bad);
+	board_file_close(&file);
+	return record_close(&rf);
+}
+
+static void ggf_write(FILE *f, const game_t *game, const state_t *states) {
+	size_t size = game->size, r, c;
+	int i;
+
+	fprintf(f, "(;GM[Othello]PC[rvconvert]TY[%zu]RE[%+d]BO[%zu ", size, game->score, size);
+	for (r = 0; r < size; r++) {
+		for (c = 0; c < size; c++) {
+			if (get_bit(game->start.board.black, square(c, r, size))) {
+				fputc('*', f);
+			} else if (get_bit(game->start.board.white, square(c, r, size))) {
+				fputc('O', f);
+			} else {
+				fputc('-', f);
+			}
+		}
+	}
+	fprintf(f, " %c]", game->start.player == BLACK_STONE ? '*' : 'O');
+	for (i = 0; i < game->num_moves; i++) {
+		if (i > 0 && states[i].player == states[i - 1].player) {
+			fprintf(f, "%c[PA]", states[i].player == BLACK_STONE ? 'W' : 'B');
+		}
+		fprintf(f, "%c[%c%d]", states[i].player == BLACK_STONE ? 'B' : 'W',
+			'a' + game->moves[i] / (int) size, game->moves[i] % (int) size + 1);
+	}
+	fprintf(f, ";)\n");
+}
+
+static int games_export(const char *input, const char *output, int format) {
+	record_file_t rf, out;
+	game_t game;
+	state_t states[RECORD_MAX_MOVES + 1];
+	FILE *f = NULL;
+	int i, res;
+
+	if (game_reader_open(&rf, input) != 0) {
+		fprintf(stderr, "rvconvert: cannot read games from '%s'\n", input);
+		return -1;
+	}
+	if (format == 'p') {
+		res = pos_writer_open(&out, output);
+	} else {
+		f = fopen(output, "w");
+		res = f ? 0 : -1;
+	}
+	if (res != 0) {
+		fprintf(stderr, "rvconvert: cannot create '%s'\n", output);
+		record_close(&rf);
+		return -1;
+	}
+	while ((res = game_read(&rf, &game)) == 1) {
+		if (game_replay(&game, states) != 0) {
+			continue;
+		}
+		if (format == 'g') {
+			ggf_write(f, &game, states);
+			continue;
+		}
+		for (i = 0; i <= game.num_moves; i++) {
+			if (format == 'p') {
+				pos_write(&out, states[i]);
+			} else {
+				board_write(f, states[i]);
+			}
+		}
+	}
+	record_close(&rf);
+	if (format == 'p') {
+		record_close(&out);
+	} else {
+		fclose(f);
+	}
+	return res;
+}
+
+int main(int argc, char *argv[]) {
+	int res;
+
+	if (argc != 4) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (strcmp(argv[1], "text2pos") == 0) {
+		res = text_to_pos(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "pos2text") == 0) {
+		res = pos_to_text(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "wthor") == 0) {
+		res = wthor_to_games(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "ggf") == 0) {
+		res = ggf_to_games(argv[2], argv[3]);
+	} else if (strcmp(argv[1], "games2ggf") == 0) {
+		res = games_export(argv[2], argv[3], 'g');
+	} else if (strcmp(argv[1], "games2pos") == 0) {
+		res = games_export(argv[2], argv[3], 'p');
+	} else if (strcmp(argv[1], "games2text") == 0) {
+		res = games_export(argv[2], argv[3], 't');
+	} else {
+		usage();
+		return EXIT_FAILURE;
+	}
+	return res ? EXIT_FAILURE : EXIT_SUCCESS;
+}
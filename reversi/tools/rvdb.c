@@ -0,0 +1,457 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <time.h>
+#include "../include/tt.h"
+#include "../include/board_io.h"
+#include "../include/record.h"
+#include "../include/util.h"
+
+/*
+ * Game database index: one 16 byte entry (canonical position key, game,
+ * file, ply) for every position of every game, sorted by key. Building
+ * runs one worker per games file; each worker sorts bounded runs in
+ * memory and spills them to disk, then the runs are merged into the index.
+ * Queries map the index and binary search the key of the position.
+ */
+
+#define DB_VERSION 1
+#define DB_HEADER_SIZE 32
+#define DB_ENTRY_SIZE 16
+#define DB_MAX_FILES 65535
+#define DB_DEFAULT_MEMORY 256
+
+typedef struct {
+	uint64_t key;
+	uint32_t game;
+	uint16_t file;
+	uint8_t ply;
+} db_entry_t;
+
+typedef struct {
+	FILE *f;
+	db_entry_t entry;
+} db_run_t;
+
+typedef struct {
+	size_t count;
+	size_t games;
+	size_t wins;
+	size_t draws;
+	size_t losses;
+	long discs;
+} db_stats_t;
+
+static char **files;
+static int num_files;
+static const char *index_name;
+static size_t run_entries;
+static int next_file = 0;
+static int num_runs = 0;
+static size_t total_games = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void usage(void) {
+	printf("Usage: rvdb build [-m MB] [-j THREADS] INDEX GAMES...\n"
+	"       rvdb query INDEX BOARD\n"
+	"Index binary game files by position and search them\n");
+}
+
+static void put_entry(uint8_t *p, const db_entry_t *e) {
+	util_put64(p, e->key);
+	util_put(p + 8, e->game, 4);
+	util_put(p + 12, e->file, 2);
+	p[14] = e->ply;
+	p[15] = 0;
+}
+
+static void get_entry(const uint8_t *p, db_entry_t *e) {
+	e->key = util_get64(p);
+	e->game = util_get(p + 8, 4);
+	e->file = util_get(p + 12, 2);
+	e->ply = p[14];
+}
+
+static int compare_entries(const void *a, const void *b) {
+	const db_entry_t *x = a, *y = b;
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+	if (x->file != y->file)
+		return x->file < y->file ? -1 : 1;
+	if (x->game != y->game)
+		return x->game < y->game ? -1 : 1;
+	return x->ply - y->ply;
+}
+
+static void run_name(char *name, size_t length, int run) {
+	snprintf(name, length, "%s.run%d", index_name, run);
+}
+
+static int flush_run(db_entry_t *entries, size_t count) {
+	char name[512];
+	uint8_t buffer[DB_ENTRY_SIZE];
+	FILE *f;
+	size_t i;
+	int run;
+
+	if (count == 0) {
+		return 0;
+	}
+	qsort(entries, count, sizeof(db_entry_t), compare_entries);
+	pthread_mutex_lock(&lock);
+	run = num_runs++;
+	pthread_mutex_unlock(&lock);
+	run_name(name, sizeof(name), run);
+	f = fopen(name, "wb");
+	if (f == NULL) {
+		return -1;
+	}
+	for (i = 0; i < count; i++) {
+		put_entry(buffer, &entries[i]);
+		fwrite(buffer, DB_ENTRY_SIZE, 1, f);
+	}
+	return fclose(f);
+}
+
+static void *build_worker(void *arg) {
+	db_entry_t *entries;
+	record_file_t rf;
+	game_t game;
+	state_t states[RECORD_MAX_MOVES + 1];
+	size_t count = 0, games = 0;
+	uint32_t id;
+	int file, ply, res;
+
+	(void) arg;
+	entries = malloc(run_entries * sizeof(db_entry_t));
+	if (entries == NULL) {
+		return (void *) -1;
+	}
+	while ((file = __atomic_fetch_add(&next_file, 1, __ATOMIC_RELAXED)) < num_files) {
+		if (game_reader_open(&rf, files[file]) != 0) {
+			fprintf(stderr, "rvdb: cannot read games from '%s'\n", files[file]);
+			continue;
+		}
+		for (id = 0; (res = game_read(&rf, &game)) == 1; id++) {
+			if (game_replay(&game, states) != 0) {
+				continue;
+			}
+			games++;
+			for (ply = 0; ply <= game.num_moves; ply++) {
+				if (count == run_entries) {
+					flush_run(entries, count);
+					count = 0;
+				}
+				entries[count].key = bb_canonical_hash(states[ply].board, states[ply].player, NULL);
+				entries[count].game = id;
+				entries[count].file = file;
+				entries[count].ply = ply;
+				count++;
+			}
+		}
+		record_close(&rf);
+	}
+	flush_run(entries, count);
+	free(entries);
+	pthread_mutex_lock(&lock);
+	total_games += games;
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+static int run_next(db_run_t *run) {
+	uint8_t buffer[DB_ENTRY_SIZE];
+	if (fread(buffer, DB_ENTRY_SIZE, 1, run->f) != 1) {
+		return 0;
+	}
+	get_entry(buffer, &run->entry);
+	return 1;
+}
+
+static void heap_down(db_run_t **heap, int size, int i) {
+	int child;
+	db_run_t *tmp;
+	while ((child = 2 * i + 1) < size) {
+		if (child + 1 < size && compare_entries(&heap[child + 1]->entry, &heap[child]->entry) < 0)
+			child++;
+		if (compare_entries(&heap[i]->entry, &heap[child]->entry) <= 0)
+			break;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+static int merge_runs(FILE *out, uint64_t *count) {
+	db_run_t *runs, **heap;
+	uint8_t buffer[DB_ENTRY_SIZE];
+	char name[512];
+	int i, size = 0;
+
+	runs = calloc(num_runs ? num_runs : 1, sizeof(db_run_t));
+	heap = calloc(num_runs ? num_runs : 1, sizeof(db_run_t *));
+	if (runs == NULL || heap == NULL) {
+		return -1;
+	}
+	for (i = 0; i < num_runs; i++) {
+		run_name(name, sizeof(name), i);
+		runs[i].f = fopen(name, "rb");
+		if (runs[i].f && run_next(&runs[i])) {
+			heap[size++] = &runs[i];
+		}
+	}
+	for (i = size / 2 - 1; i >= 0; i--) {
+		heap_down(heap, size, i);
+	}
+	*count = 0;
+	while (size > 0) {
+		put_entry(buffer, &heap[0]->entry);
+		fwrite(buffer, DB_ENTRY_SIZE, 1, out);
+		(*count)++;
+		if (!run_next(heap[0])) {
+			heap[0] = heap[--size];
+		}
+		heap_down(heap, size, 0);
+	}
+	for (i = 0; i < num_runs; i++) {
+		if (runs[i].f)
+			fclose(runs[i].f);
+		run_name(name, sizeof(name), i);
+		remove(name);
+	}
+	free(runs);
+	free(heap);
+	return 0;
+}
+
+static void put_header(uint8_t *header, uint64_t count, uint64_t offset) {
+	memset(header, 0, DB_HEADER_SIZE);
+	memcpy(header, "RVDX", 4);
+	header[4] = DB_VERSION;
+	util_put64(header + 8, count);
+	util_put64(header + 16, offset);
+	util_put(header + 24, num_files, 2);
+}
+
+static int build(int argc, char *argv[]) {
+	pthread_t *threads;
+	uint8_t header[DB_HEADER_SIZE];
+	uint64_t count, offset;
+	size_t memory = DB_DEFAULT_MEMORY, length;
+	long threads_num = sysconf(_SC_NPROCESSORS_ONLN);
+	double start = util_now();
+	FILE *out;
+	int i, optc;
+
+	while ((optc = getopt(argc, argv, "m:j:")) != -1) {
+		if (optc == 'm') {
+			memory = atol(optarg);
+		} else if (optc == 'j') {
+			threads_num = atol(optarg);
+		} else {
+			usage();
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc - optind < 2) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	index_name = argv[optind];
+	files = argv + optind + 1;
+	num_files = argc - optind - 1;
+	if (num_files > DB_MAX_FILES) {
+		fprintf(stderr, "rvdb: too many games files\n");
+		return EXIT_FAILURE;
+	}
+	if (threads_num > num_files)
+		threads_num = num_files;
+	if (threads_num < 1)
+		threads_num = 1;
+	run_entries = (memory << 20) / threads_num / sizeof(db_entry_t);
+	if (run_entries < 1024)
+		run_entries = 1024;
+
+	threads = malloc(threads_num * sizeof(pthread_t));
+	if (threads == NULL) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < threads_num; i++) {
+		pthread_create(&threads[i], NULL, build_worker, NULL);
+	}
+	for (i = 0; i < threads_num; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	out = fopen(index_name, "wb");
+	if (out == NULL) {
+		fprintf(stderr, "rvdb: cannot create '%s'\n", index_name);
+		return EXIT_FAILURE;
+	}
+	fwrite(header, DB_HEADER_SIZE, 1, out);
+	offset = DB_HEADER_SIZE;
+	for (i = 0; i < num_files; i++) {
+		length = strlen(files[i]);
+		header[0] = length & 0xff;
+		header[1] = length >> 8;
+		fwrite(header, 2, 1, out);
+		fwrite(files[i], 1, length, out);
+		offset += 2 + length;
+	}
+	memset(header, 0, DB_ENTRY_SIZE);
+	fwrite(header, 1, (DB_ENTRY_SIZE - offset % DB_ENTRY_SIZE) % DB_ENTRY_SIZE, out);
+	offset += (DB_ENTRY_SIZE - offset % DB_ENTRY_SIZE) % DB_ENTRY_SIZE;
+	if (merge_runs(out, &count) != 0) {
+		fprintf(stderr, "No memory available\n");
+		fclose(out);
+		return EXIT_FAILURE;
+	}
+	put_header(header, count, offset);
+	fseek(out, 0, SEEK_SET);
+	fwrite(header, DB_HEADER_SIZE, 1, out);
+	fclose(out);
+	printf("%zu games, %llu positions, %d runs, %ld threads, %.2f s\n", total_games,
+		(unsigned long long) count, num_runs, threads_num, util_now() - start);
+	return EXIT_SUCCESS;
+}
+
+static int query(const char *index, const char *board) {
+	board_file_t file, db;
+	board_reader_t reader;
+	record_file_t *games;
+	state_t state, states[RECORD_MAX_MOVES + 1];
+	db_entry_t e;
+	db_stats_t stats[MAX_BOARD_SIZE * MAX_BOARD_SIZE], total;
+	game_t game;
+	const uint8_t *p, *entries;
+	uint64_t key, count, offset, lo, hi, mid;
+	int i, sym, sq, result, nfiles;
+	size_t len;
+	double start;
+	char **names;
+	char name[BOARD_SQUARE_NAME];
+
+	if (board_file_open(board, &file) != 0) {
+		fprintf(stderr, "rvdb: cannot open '%s'\n", board);
+		return EXIT_FAILURE;
+	}
+	board_reader_init(&reader, file.data, file.length);
+	if (board_read(&reader, &state) != BOARD_OK) {
+		fprintf(stderr, "%s\n", reader.error[0] ? reader.error : "rvdb: no board found");
+		return EXIT_FAILURE;
+	}
+	board_file_close(&file);
+	if (board_file_open(index, &db) != 0 || db.length < DB_HEADER_SIZE || memcmp(db.data, "RVDX", 4) != 0) {
+		fprintf(stderr, "rvdb: cannot read index '%s'\n", index);
+		return EXIT_FAILURE;
+	}
+
+	start = util_now();
+	p = (const uint8_t *) db.data;
+	count = util_get64(p + 8);
+	offset = util_get64(p + 16);
+	nfiles = util_get(p + 24, 2);
+	names = calloc(nfiles ? nfiles : 1, sizeof(char *));
+	games = calloc(nfiles ? nfiles : 1, sizeof(record_file_t));
+	p += DB_HEADER_SIZE;
+	for (i = 0; i < nfiles; i++) {
+		len = p[0] | p[1] << 8;
+		names[i] = strndup((const char *) p + 2, len);
+		p += 2 + len;
+	}
+	entries = (const uint8_t *) db.data + offset;
+
+	key = bb_canonical_hash(state.board, state.player, NULL);
+	lo = 0;
+	hi = count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		get_entry(entries + mid * DB_ENTRY_SIZE, &e);
+		if (e.key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	memset(stats, 0, sizeof(stats));
+	memset(&total, 0, sizeof(total));
+	for (; lo < count; lo++) {
+		get_entry(entries + lo * DB_ENTRY_SIZE, &e);
+		if (e.key != key)
+			break;
+		if (games[e.file].f == NULL && game_reader_open(&games[e.file], names[e.file]) != 0)
+			continue;
+		if (game_seek(&games[e.file], e.game) != 0 || game_read(&games[e.file], &game) != 1
+				|| game_replay(&game, states) != 0)
+			continue;
+		/* find how the game position maps onto the query position */
+		for (sym = 0; sym < 8; sym++) {
+			bitboard_t b = bb_symmetry(states[e.ply].board, sym);
+			if (b.black == state.board.black && b.white == state.board.white
+					&& states[e.ply].player == state.player)
+				break;
+		}
+		if (sym == 8)
+			continue;
+		result = (state.player == BLACK_STONE) ? game.score : -game.score;
+		total.games++;
+		total.wins += result > 0;
+		total.draws += result == 0;
+		total.losses += result < 0;
+		total.discs += result;
+		if (e.ply == game.num_moves)
+			continue;
+		sq = bb_symmetry_square(game.moves[e.ply], game.size, sym);
+		stats[sq].count++;
+		stats[sq].wins += result > 0;
+		stats[sq].draws += result == 0;
+		stats[sq].losses += result < 0;
+		stats[sq].discs += result;
+	}
+
+	printf("'%c' to move, reached in %zu games (%.3f ms)\n", state.player, total.games,
+		(util_now() - start) * 1e3);
+	if (total.games) {
+		printf("all\t%zu\t+%zu =%zu -%zu\t%+.2f\n", total.games, total.wins, total.draws,
+			total.losses, (double) total.discs / total.games);
+	}
+	for (;;) {
+		/* moves by decreasing frequency */
+		size_t best = 0;
+		sq = -1;
+		for (i = 0; i < MAX_BOARD_SIZE * MAX_BOARD_SIZE; i++) {
+			if (stats[i].count > best) {
+				best = stats[i].count;
+				sq = i;
+			}
+		}
+		if (sq < 0)
+			break;
+		board_square_name(sq, state.board.size, name);
+		printf("%s\t%zu\t+%zu =%zu -%zu\t%+.2f\n", name, stats[sq].count, stats[sq].wins, stats[sq].draws,
+			stats[sq].losses, (double) stats[sq].discs / stats[sq].count);
+		stats[sq].count = 0;
+	}
+	for (i = 0; i < nfiles; i++) {
+		if (games[i].f)
+			record_close(&games[i]);
+		free(names[i]);
+	}
+	free(names);
+	free(games);
+	board_file_close(&db);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc >= 2 && strcmp(argv[1], "build") == 0) {
+		return build(argc - 1, argv + 1);
+	}
+	if (argc == 4 && strcmp(argv[1], "query") == 0) {
+		return query(argv[2], argv[3]);
+	}
+	usage();
+	return EXIT_FAILURE;
+}
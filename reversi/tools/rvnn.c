@@ -0,0 +1,512 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <time.h>
+#include "../include/record.h"
+#include "../include/tt.h"
+#include "../include/nn.h"
+#include "../include/util.h"
+
+#define SELFPLAY_GAMES 1000
+#define SELFPLAY_RANDOM 10
+#define TRAIN_EPOCHS 10
+#define TRAIN_RATE 0.002
+#define VALID_SHARE 20
+#define MATCH_GAMES 20
+#define MATCH_MS 200
+#define MAX_DEPTH 24
+#define OPENING_PLIES 8
+#define W1_LIMIT 2.0
+#define W_LIMIT ((double) NN_ACTIVATION_MAX / (1 << NN_SHIFT))
+
+/* a position from the side to move, and its final disc difference / NN_SQUARES */
+typedef struct {
+	uint64_t own;
+	uint64_t opp;
+	float target;
+} sample_t;
+
+/* the float network trained here, quantized into nn_weights_t */
+typedef struct {
+	float w1[NN_INPUTS][NN_HIDDEN1];
+	float b1[NN_HIDDEN1];
+	float w2[NN_HIDDEN2][NN_HIDDEN1];
+	float b2[NN_HIDDEN2];
+	float w3[NN_HIDDEN2];
+	float b3;
+} model_t;
+
+static void usage(void) {
+	printf("Usage: rvnn selfplay [-g GAMES] [-r PERCENT] [-n NET] GAMES_FILE\n"
+	"       rvnn train [-e EPOCHS] [-l RATE] GAMES_FILE NET\n"
+	"       rvnn match [-t MS] [-g GAMES] NET\n"
+	"Train and measure the evaluation network\n"
+	"\n\t selfplay\t play GAMES games with PERCENT random moves before the\n"
+	"\t\t\t exact endgame, evaluating with NET if given\n"
+	"\t train\t\t fit a network to the final scores of GAMES_FILE\n"
+	"\t match\t\t self-play of NET against the stability evaluator at\n"
+	"\t\t\t MS per move\n");
+}
+
+static state_t play(state_t state, int square) {
+	uint64_t *own = (state.player == BLACK_STONE) ? &state.board.black : &state.board.white;
+	uint64_t *opp = (state.player == BLACK_STONE) ? &state.board.white : &state.board.black;
+	uint64_t flips;
+
+	if (square >= 0) {
+		flips = bb_flips(*own, *opp, square, state.board.size);
+		*own |= flips | (uint64_t) 1 << square;
+		*opp &= ~flips;
+	}
+	state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	return state;
+}
+
+static uint64_t moves_of(state_t state) {
+	return (state.player == BLACK_STONE)
+		? bb_mobility(state.board.black, state.board.white, state.board.size)
+		: bb_mobility(state.board.white, state.board.black, state.board.size);
+}
+
+/* a random legal move, -1 to pass */
+static int random_move(state_t state) {
+	uint64_t moves = moves_of(state);
+	int n;
+	if (moves == 0)
+		return -1;
+	for (n = rand() % __builtin_popcountll(moves); n > 0; n--)
+		moves &= moves - 1;
+	return __builtin_ctzll(moves);
+}
+
+static state_t random_position(int plies) {
+	state_t state;
+	int i;
+	state.board = bb_init(8);
+	state.player = BLACK_STONE;
+	for (i = 0; i < plies; i++)
+		state = play(state, random_move(state));
+	return state;
+}
+
+static int disc_diff(state_t state) {
+	return __builtin_popcountll(state.board.black) - __builtin_popcountll(state.board.white);
+}
+
+static int cmd_selfplay(int argc, char *argv[]) {
+	record_file_t rf;
+	game_t game;
+	state_t state;
+	move_t move;
+	double start = util_now();
+	int opt, games = SELFPLAY_GAMES, random = SELFPLAY_RANDOM, g, square, passes;
+
+	while ((opt = getopt(argc, argv, "g:r:n:")) != -1) {
+		if (opt == 'g') {
+			games = atoi(optarg);
+		} else if (opt == 'r') {
+			random = atoi(optarg);
+		} else if (opt == 'n') {
+			if (nn_load(optarg) != 0) {
+				fprintf(stderr, "rvnn: error: cannot load network '%s'\n", optarg);
+				return EXIT_FAILURE;
+			}
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind + 1 != argc || games < 1) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (game_writer_open(&rf, argv[optind]) != 0) {
+		fprintf(stderr, "rvnn: error: cannot create '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	srand(3);
+	for (g = 0; g < games; g++) {
+		game_new(&game, 8);
+		state = game.start;
+		for (passes = 0; passes < 2 && game.num_moves < RECORD_MAX_MOVES;) {
+			if (moves_of(state) == 0) {
+				passes++;
+				state = play(state, -1);
+				continue;
+			}
+			passes = 0;
+			if (game.num_moves < OPENING_PLIES
+					|| (bb_empties(state.board) > ENDGAME_EMPTIES && rand() % 100 < random)) {
+				square = random_move(state);
+			} else {
+				tt_clear();
+				move = ai_player(state);
+				square = one_dimension(move.row, move.column, state.board.size);
+			}
+			game.moves[game.num_moves++] = square;
+			state = play(state, square);
+		}
+		game.score = disc_diff(state);
+		if (game_write(&rf, &game) != 0) {
+			fprintf(stderr, "rvnn: error: cannot write '%s'\n", argv[optind]);
+			record_close(&rf);
+			return EXIT_FAILURE;
+		}
+	}
+	if (record_close(&rf) != 0) {
+		fprintf(stderr, "rvnn: error: cannot write '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	printf("%d games in %.1f s\n", games, util_now() - start);
+	return EXIT_SUCCESS;
+}
+
+/* every position of every 8x8 game, labeled with the final score */
+static sample_t *read_samples(const char *filename, size_t *count) {
+	static state_t states[RECORD_MAX_MOVES + 1];
+	record_file_t rf;
+	game_t game;
+	sample_t *samples = NULL, *bigger;
+	size_t n = 0, capacity = 0;
+	int i, res, diff;
+
+	if (game_reader_open(&rf, filename) != 0) {
+		return NULL;
+	}
+	while ((res = game_read(&rf, &game)) == 1) {
+		if (game.size != 8 || game_replay(&game, states) != 0)
+			continue;
+		for (i = 0; i <= game.num_moves; i++) {
+			if (n == capacity) {
+				capacity = capacity ? 2 * capacity : 65536;
+				bigger = realloc(samples, capacity * sizeof(sample_t));
+				if (bigger == NULL) {
+					free(samples);
+					record_close(&rf);
+					return NULL;
+				}
+				samples = bigger;
+			}
+			diff = (states[i].player == BLACK_STONE) ? game.score : -game.score;
+			samples[n].own = (states[i].player == BLACK_STONE) ? states[i].board.black : states[i].board.white;
+			samples[n].opp = (states[i].player == BLACK_STONE) ? states[i].board.white : states[i].board.black;
+			samples[n].target = (float) diff / NN_SQUARES;
+			n++;
+		}
+	}
+	record_close(&rf);
+	if (res < 0) {
+		free(samples);
+		return NULL;
+	}
+	*count = n;
+	return samples;
+}
+
+static float uniform(float limit) {
+	return limit * (2.0f * rand() / RAND_MAX - 1.0f);
+}
+
+static void model_init(model_t *m) {
+	int i, k;
+	for (i = 0; i < NN_INPUTS; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			m->w1[i][k] = uniform(0.15f);
+	}
+	for (k = 0; k < NN_HIDDEN1; k++)
+		m->b1[k] = 0.5f;
+	for (i = 0; i < NN_HIDDEN2; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			m->w2[i][k] = uniform(0.25f);
+		m->b2[i] = 0.1f;
+		m->w3[i] = uniform(0.3f);
+	}
+	m->b3 = 0;
+}
+
+static inline float clip(float x, float limit) {
+	return (x < -limit) ? -limit : (x > limit) ? limit : x;
+}
+
+static inline float activation(float x) {
+	return (x < 0) ? 0 : (x > W_LIMIT) ? W_LIMIT : x;
+}
+
+/* active inputs of a sample: own discs, opponent discs, mobility */
+static int inputs(const sample_t *sample, int *index) {
+	uint64_t own = sample->own, opp = sample->opp, moves = bb_mobility(sample->own, sample->opp, 8);
+	int n = 0;
+	for (; own; own &= own - 1)
+		index[n++] = __builtin_ctzll(own);
+	for (; opp; opp &= opp - 1)
+		index[n++] = NN_SQUARES + __builtin_ctzll(opp);
+	for (; moves; moves &= moves - 1)
+		index[n++] = 2 * NN_SQUARES + __builtin_ctzll(moves);
+	return n;
+}
+
+/* one SGD step on the squared error (none at rate 0); returns the prediction before the step */
+static float train_step(model_t *m, const sample_t *sample, float rate) {
+	float h1[NN_HIDDEN1], a1[NN_HIDDEN1], h2[NN_HIDDEN2], a2[NN_HIDDEN2];
+	float g1[NN_HIDDEN1], g2[NN_HIDDEN2], y, g;
+	int index[NN_INPUTS], n, i, j, k;
+
+	n = inputs(sample, index);
+	for (k = 0; k < NN_HIDDEN1; k++)
+		h1[k] = m->b1[k];
+	for (i = 0; i < n; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			h1[k] += m->w1[index[i]][k];
+	}
+	for (k = 0; k < NN_HIDDEN1; k++)
+		a1[k] = activation(h1[k]);
+	y = m->b3;
+	for (j = 0; j < NN_HIDDEN2; j++) {
+		h2[j] = m->b2[j];
+		for (k = 0; k < NN_HIDDEN1; k++)
+			h2[j] += m->w2[j][k] * a1[k];
+		a2[j] = activation(h2[j]);
+		y += m->w3[j] * a2[j];
+	}
+
+	g = y - sample->target;
+	for (k = 0; k < NN_HIDDEN1; k++)
+		g1[k] = 0;
+	for (j = 0; j < NN_HIDDEN2; j++) {
+		g2[j] = (h2[j] > 0 && h2[j] < W_LIMIT) ? g * m->w3[j] : 0;
+		m->w3[j] = clip(m->w3[j] - rate * g * a2[j], W_LIMIT);
+		if (g2[j] == 0)
+			continue;
+		for (k = 0; k < NN_HIDDEN1; k++) {
+			g1[k] += g2[j] * m->w2[j][k];
+			m->w2[j][k] = clip(m->w2[j][k] - rate * g2[j] * a1[k], W_LIMIT);
+		}
+		m->b2[j] -= rate * g2[j];
+	}
+	m->b3 -= rate * g;
+	for (k = 0; k < NN_HIDDEN1; k++) {
+		if (h1[k] <= 0 || h1[k] >= W_LIMIT)
+			g1[k] = 0;
+		m->b1[k] = clip(m->b1[k] - rate * g1[k], W1_LIMIT);
+	}
+	for (i = 0; i < n; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			m->w1[index[i]][k] = clip(m->w1[index[i]][k] - rate * g1[k], W1_LIMIT);
+	}
+	return y;
+}
+
+static int quantize(float x, float scale, int limit) {
+	long v = lrintf(x * scale);
+	return (v < -limit) ? -limit : (v > limit) ? limit : (int) v;
+}
+
+static void model_quantize(const model_t *m, nn_weights_t *w) {
+	const float one = 1 << NN_SHIFT, out = 1 << 2 * NN_SHIFT;
+	int i, k;
+
+	w->size = 8;
+	for (i = 0; i < NN_INPUTS; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			w->w1[i][k] = quantize(m->w1[i][k], one, INT16_MAX);
+	}
+	for (k = 0; k < NN_HIDDEN1; k++)
+		w->b1[k] = quantize(m->b1[k], one, INT16_MAX);
+	for (i = 0; i < NN_HIDDEN2; i++) {
+		for (k = 0; k < NN_HIDDEN1; k++)
+			w->w2[i][k] = quantize(m->w2[i][k], one, INT8_MAX);
+		w->b2[i] = quantize(m->b2[i], out, INT32_MAX);
+		w->w3[i] = quantize(m->w3[i], one, INT8_MAX);
+	}
+	w->b3 = quantize(m->b3, out, INT32_MAX);
+}
+
+/* the same symmetry of both bitboards; mobility is symmetric too */
+static sample_t transform(const sample_t *sample, int sym) {
+	sample_t t = *sample;
+	bitboard_t board;
+	board.size = 8;
+	board.black = sample->own;
+	board.white = sample->opp;
+	board = bb_symmetry(board, sym);
+	t.own = board.black;
+	t.opp = board.white;
+	return t;
+}
+
+static int cmd_train(int argc, char *argv[]) {
+	static model_t model;
+	static nn_weights_t weights;
+	sample_t *samples, tmp, s;
+	size_t n, valid, i, j;
+	double rate = TRAIN_RATE, err, verr, qerr, start = util_now();
+	int opt, epochs = TRAIN_EPOCHS, e;
+
+	while ((opt = getopt(argc, argv, "e:l:")) != -1) {
+		if (opt == 'e') {
+			epochs = atoi(optarg);
+		} else if (opt == 'l') {
+			rate = atof(optarg);
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind + 2 != argc || epochs < 1 || rate <= 0) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	samples = read_samples(argv[optind], &n);
+	if (samples == NULL || n < 2 * VALID_SHARE) {
+		fprintf(stderr, "rvnn: error: cannot read games from '%s'\n", argv[optind]);
+		free(samples);
+		return EXIT_FAILURE;
+	}
+	/* the last games are held out for validation */
+	valid = n / VALID_SHARE;
+	srand(4);
+	model_init(&model);
+	printf("%zu training positions, %zu validation positions\n", n - valid, valid);
+	printf("epoch  rate     train RMSE  valid RMSE  quantized (discs)\n");
+	for (e = 0; e < epochs; e++) {
+		for (i = n - valid - 1; i > 0; i--) {
+			j = rand() % (i + 1);
+			tmp = samples[i];
+			samples[i] = samples[j];
+			samples[j] = tmp;
+		}
+		err = 0;
+		for (i = 0; i < n - valid; i++) {
+			s = transform(&samples[i], rand() % 8);
+			err += pow(train_step(&model, &s, rate) - s.target, 2);
+		}
+		err = sqrt(err / (n - valid)) * NN_SQUARES;
+
+		model_quantize(&model, &weights);
+		nn_set(&weights);
+		verr = qerr = 0;
+		for (i = n - valid; i < n; i++) {
+			verr += pow(train_step(&model, &samples[i], 0) - samples[i].target, 2);
+			qerr += pow((double) nn_eval(samples[i].own, samples[i].opp, 8) / NN_VALUE_SCALE
+				- samples[i].target * NN_SQUARES, 2);
+		}
+		verr = sqrt(verr / valid) * NN_SQUARES;
+		qerr = sqrt(qerr / valid);
+		printf("%5d  %.5f  %10.2f  %10.2f  %9.2f\n", e + 1, rate, err, verr, qerr);
+		rate *= 0.7;
+	}
+	if (nn_save(argv[optind + 1], &weights) != 0) {
+		fprintf(stderr, "rvnn: error: cannot write '%s'\n", argv[optind + 1]);
+		free(samples);
+		return EXIT_FAILURE;
+	}
+	printf("trained in %.1f s\n", util_now() - start);
+	free(samples);
+	return EXIT_SUCCESS;
+}
+
+/* iterative deepening until the next iteration would not fit in the budget */
+static int timed_move(state_t state, double budget, int (*heuristic) (state_t state), int *depth) {
+	double start = util_now(), elapsed, last = 0;
+	move_t move;
+	int d;
+
+	tt_clear();
+	if (bb_empties(state.board) <= ENDGAME_EMPTIES) {
+		*depth = bb_empties(state.board);
+		move = ai_solve(state, NULL);
+		return one_dimension(move.row, move.column, state.board.size);
+	}
+	for (d = 1; d <= MAX_DEPTH; d++) {
+		move = negamax_alphabeta(state, d, heuristic);
+		*depth = d;
+		elapsed = util_now() - start;
+		if (elapsed + 4 * (elapsed - last) > budget)
+			break;
+		last = elapsed;
+	}
+	return one_dimension(move.row, move.column, state.board.size);
+}
+
+/* game from an opening, the network moves first if first; disc difference for the network */
+static int match_game(state_t state, int first, double budget, long *depths, long *moves) {
+	int passes = 0, depth, side = first ? 0 : 1, diff, midgame;
+	char starter = state.player;
+
+	while (passes < 2) {
+		if (moves_of(state) == 0) {
+			passes++;
+			state = play(state, -1);
+			side ^= 1;
+			continue;
+		}
+		passes = 0;
+		midgame = bb_empties(state.board) > ENDGAME_EMPTIES;
+		state = play(state, timed_move(state, budget, side == 0 ? nn_heuristic : stability_heuristic, &depth));
+		if (midgame) {
+			depths[side] += depth;
+			moves[side]++;
+		}
+		side ^= 1;
+	}
+	diff = disc_diff(state);
+	if (starter == WHITE_STONE)
+		diff = -diff;
+	return first ? diff : -diff;
+}
+
+static int cmd_match(int argc, char *argv[]) {
+	long depths[2] = { 0, 0 }, moves[2] = { 0, 0 }, total = 0;
+	int opt, games = MATCH_GAMES, ms = MATCH_MS, g, r, wins = 0, draws = 0, losses = 0;
+	state_t opening;
+
+	while ((opt = getopt(argc, argv, "t:g:")) != -1) {
+		if (opt == 't') {
+			ms = atoi(optarg);
+		} else if (opt == 'g') {
+			games = atoi(optarg);
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (nn_load(argv[optind]) != 0 || !nn_ready(8)) {
+		fprintf(stderr, "rvnn: error: cannot load network '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	srand(2);
+	for (g = 0; g < games; g++) {
+		if (g % 2 == 0)
+			opening = random_position(OPENING_PLIES);
+		r = match_game(opening, g % 2 == 0, ms / 1000.0, depths, moves);
+		total += r;
+		if (r > 0) {
+			wins++;
+		} else if (r < 0) {
+			losses++;
+		} else {
+			draws++;
+		}
+	}
+	printf("network against stability, %d ms per move: %d wins, %d draws, %d losses, %+.1f discs per game\n",
+		ms, wins, draws, losses, (double) total / games);
+	printf("average midgame depth: %.2f with the network, %.2f with stability\n",
+		moves[0] ? (double) depths[0] / moves[0] : 0, moves[1] ? (double) depths[1] / moves[1] : 0);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	if (argc >= 2 && strcmp(argv[1], "selfplay") == 0) {
+		return cmd_selfplay(argc - 1, argv + 1);
+	} else if (argc >= 2 && strcmp(argv[1], "train") == 0) {
+		return cmd_train(argc - 1, argv + 1);
+	} else if (argc >= 2 && strcmp(argv[1], "match") == 0) {
+		return cmd_match(argc - 1, argv + 1);
+	}
+	usage();
+	return EXIT_FAILURE;
+}
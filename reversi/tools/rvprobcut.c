@@ -0,0 +1,331 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <time.h>
+#include "../include/record.h"
+#include "../include/tt.h"
+#include "../include/probcut.h"
+#include "../include/util.h"
+
+#define LOG_DEPTH 6
+#define MAX_SAMPLES 100000
+#define MIN_SAMPLES 10
+#define MATCH_GAMES 20
+#define MATCH_MS 200
+#define OPENING_PLIES 8
+
+typedef struct {
+	int phase;
+	int values[PROBCUT_MAX_DEPTH + 1];
+} sample_t;
+
+static void usage(void) {
+	printf("Usage: rvprobcut log [-d DEPTH] [-r N] [POSITIONS] LOG\n"
+	"       rvprobcut fit LOG PARAMS\n"
+	"       rvprobcut match [-t MS] [-g GAMES] [-c CONFIDENCE] PARAMS\n"
+	"Fit and measure Multi-ProbCut parameters\n"
+	"\n\t log\t\t search each position of POSITIONS (or N random ones)\n"
+	"\t\t\t at every depth up to DEPTH and write the values to LOG\n"
+	"\t fit\t\t fit the per-phase, per-depth regressions of LOG\n"
+	"\t match\t\t self-play with and without ProbCut at MS per move\n");
+}
+
+static state_t play(state_t state, int square) {
+	uint64_t *own = (state.player == BLACK_STONE) ? &state.board.black : &state.board.white;
+	uint64_t *opp = (state.player == BLACK_STONE) ? &state.board.white : &state.board.black;
+	uint64_t flips;
+
+	if (square >= 0) {
+		flips = bb_flips(*own, *opp, square, state.board.size);
+		*own |= flips | (uint64_t) 1 << square;
+		*opp &= ~flips;
+	}
+	state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+	return state;
+}
+
+static uint64_t moves_of(state_t state) {
+	return (state.player == BLACK_STONE)
+		? bb_mobility(state.board.black, state.board.white, state.board.size)
+		: bb_mobility(state.board.white, state.board.black, state.board.size);
+}
+
+/* a random legal move, -1 to pass */
+static int random_move(state_t state) {
+	uint64_t moves = moves_of(state);
+	int n;
+	if (moves == 0)
+		return -1;
+	for (n = rand() % __builtin_popcountll(moves); n > 0; n--)
+		moves &= moves - 1;
+	return __builtin_ctzll(moves);
+}
+
+static state_t random_position(int plies) {
+	state_t state;
+	int i;
+	state.board = bb_init(8);
+	state.player = BLACK_STONE;
+	for (i = 0; i < plies; i++)
+		state = play(state, random_move(state));
+	return state;
+}
+
+static int log_position(FILE *out, state_t state, int depth) {
+	int d;
+	if (moves_of(state) == 0)
+		return 0;
+	tt_clear();
+	fprintf(out, "%d", probcut_phase(state.board.black | state.board.white, state.board.size));
+	for (d = 0; d <= depth; d++)
+		fprintf(out, " %d", negamax_alphabeta_value(state, d, stability_heuristic));
+	fprintf(out, "\n");
+	return 1;
+}
+
+static int cmd_log(int argc, char *argv[]) {
+	record_file_t rf;
+	state_t state;
+	FILE *out;
+	int opt, depth = LOG_DEPTH, random = 0, n = 0, res;
+
+	while ((opt = getopt(argc, argv, "d:r:")) != -1) {
+		if (opt == 'd') {
+			depth = atoi(optarg);
+		} else if (opt == 'r') {
+			random = atoi(optarg);
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (depth < 1 || depth > PROBCUT_MAX_DEPTH || optind + (random ? 1 : 2) != argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	out = fopen(argv[argc - 1], "w");
+	if (out == NULL) {
+		fprintf(stderr, "rvprobcut: error: cannot create '%s'\n", argv[argc - 1]);
+		return EXIT_FAILURE;
+	}
+	probcut_enable(0);
+	fprintf(out, "# phase value[0..%d]\n", depth);
+	if (random) {
+		srand(1);
+		while (n < random)
+			n += log_position(out, random_position(10 + rand() % 40), depth);
+	} else {
+		if (pos_reader_open(&rf, argv[optind]) != 0) {
+			fprintf(stderr, "rvprobcut: error: cannot open '%s'\n", argv[optind]);
+			fclose(out);
+			return EXIT_FAILURE;
+		}
+		while ((res = pos_read(&rf, &state)) == 1)
+			n += log_position(out, state, depth);
+		record_close(&rf);
+		if (res < 0) {
+			fprintf(stderr, "rvprobcut: error: cannot read '%s'\n", argv[optind]);
+		}
+	}
+	fclose(out);
+	printf("%d positions searched to depth %d\n", n, depth);
+	return EXIT_SUCCESS;
+}
+
+static int read_log(const char *filename, sample_t *samples, int *depth) {
+	FILE *f = fopen(filename, "r");
+	char line[1024], *p, *end;
+	int n = 0, d;
+
+	if (f == NULL) {
+		return -1;
+	}
+	*depth = PROBCUT_MAX_DEPTH;
+	while (n < MAX_SAMPLES && fgets(line, sizeof(line), f)) {
+		if (line[0] == '#')
+			continue;
+		samples[n].phase = strtol(line, &p, 10);
+		for (d = 0; d <= PROBCUT_MAX_DEPTH; d++, p = end) {
+			samples[n].values[d] = strtol(p, &end, 10);
+			if (end == p)
+				break;
+		}
+		if (samples[n].phase < 0 || samples[n].phase >= PROBCUT_PHASES || d == 0) {
+			fclose(f);
+			return -1;
+		}
+		*depth = (d - 1 < *depth) ? d - 1 : *depth;
+		n++;
+	}
+	fclose(f);
+	return n;
+}
+
+/* least squares fit of deep = a * shallow + b over one phase */
+static int fit(const sample_t *samples, int n, int phase, int deep, int shallow, probcut_param_t *p) {
+	double sx = 0, sy = 0, sxx = 0, sxy = 0, r, rr = 0;
+	int i, count = 0;
+
+	for (i = 0; i < n; i++) {
+		if (samples[i].phase != phase)
+			continue;
+		sx += samples[i].values[shallow];
+		sy += samples[i].values[deep];
+		sxx += (double) samples[i].values[shallow] * samples[i].values[shallow];
+		sxy += (double) samples[i].values[shallow] * samples[i].values[deep];
+		count++;
+	}
+	if (count < MIN_SAMPLES || count * sxx - sx * sx <= 0)
+		return 0;
+	p->a = (count * sxy - sx * sy) / (count * sxx - sx * sx);
+	p->b = (sy - p->a * sx) / count;
+	for (i = 0; i < n; i++) {
+		if (samples[i].phase != phase)
+			continue;
+		r = samples[i].values[deep] - (p->a * samples[i].values[shallow] + p->b);
+		rr += r * r;
+	}
+	p->sigma = sqrt(rr / count);
+	return p->a > 0 ? count : 0;
+}
+
+static int cmd_fit(int argc, char *argv[]) {
+	static sample_t samples[MAX_SAMPLES];
+	static probcut_t params;
+	probcut_param_t *p;
+	int n, depth, phase, deep, check, count;
+
+	if (argc != 4) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	n = read_log(argv[2], samples, &depth);
+	if (n < 0) {
+		fprintf(stderr, "rvprobcut: error: cannot read log '%s'\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	printf("phase depth shallow samples      a       b   sigma\n");
+	for (phase = 0; phase < PROBCUT_PHASES; phase++) {
+		for (deep = PROBCUT_MIN_DEPTH; deep <= depth; deep++) {
+			for (check = 0; check < PROBCUT_CHECKS; check++) {
+				p = &params.params[phase][deep][check];
+				if (probcut_shallow(deep, check) <= 0)
+					continue;
+				count = fit(samples, n, phase, deep, probcut_shallow(deep, check), p);
+				if (count == 0) {
+					p->a = 0;
+					continue;
+				}
+				printf("%5d %5d %7d %7d %7.3f %7.2f %7.2f\n", phase, deep,
+					probcut_shallow(deep, check), count, p->a, p->b, p->sigma);
+			}
+		}
+	}
+	if (probcut_save(argv[3], &params) != 0) {
+		fprintf(stderr, "rvprobcut: error: cannot write '%s'\n", argv[3]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/* iterative deepening until the next iteration would not fit in the budget */
+static int timed_move(state_t state, double budget, int *depth) {
+	double start = util_now(), elapsed, last = 0;
+	move_t move;
+	int d, square = -1;
+
+	tt_clear();
+	for (d = 1; d <= 2 * PROBCUT_MAX_DEPTH; d++) {
+		move = negamax_alphabeta(state, d, stability_heuristic);
+		square = one_dimension(move.row, move.column, state.board.size);
+		*depth = d;
+		elapsed = util_now() - start;
+		if (elapsed + 4 * (elapsed - last) > budget)
+			break;
+		last = elapsed;
+	}
+	return square;
+}
+
+/* game from an opening, probcut moves first if first; disc difference for probcut */
+static int match_game(state_t state, int first, double budget, long *depths, long *moves) {
+	int passes = 0, depth, side = first ? 0 : 1;
+	char starter = state.player;
+
+	while (passes < 2) {
+		if (moves_of(state) == 0) {
+			passes++;
+			state = play(state, -1);
+			side ^= 1;
+			continue;
+		}
+		passes = 0;
+		probcut_enable(side == 0);
+		state = play(state, timed_move(state, budget, &depth));
+		depths[side] += depth;
+		moves[side]++;
+		side ^= 1;
+	}
+	depth = __builtin_popcountll(state.board.black) - __builtin_popcountll(state.board.white);
+	if (starter == WHITE_STONE)
+		depth = -depth;
+	return first ? depth : -depth;
+}
+
+static int cmd_match(int argc, char *argv[]) {
+	long depths[2] = { 0, 0 }, moves[2] = { 0, 0 };
+	int opt, games = MATCH_GAMES, ms = MATCH_MS, g, r, wins = 0, draws = 0, losses = 0;
+	state_t opening;
+
+	while ((opt = getopt(argc, argv, "t:g:c:")) != -1) {
+		if (opt == 't') {
+			ms = atoi(optarg);
+		} else if (opt == 'g') {
+			games = atoi(optarg);
+		} else if (opt == 'c') {
+			probcut_set_confidence(atof(optarg));
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (probcut_load(argv[optind]) != 0) {
+		fprintf(stderr, "rvprobcut: error: cannot load parameters '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	srand(2);
+	for (g = 0; g < games; g++) {
+		if (g % 2 == 0)
+			opening = random_position(OPENING_PLIES);
+		r = match_game(opening, g % 2 == 0, ms / 1000.0, depths, moves);
+		if (r > 0) {
+			wins++;
+		} else if (r < 0) {
+			losses++;
+		} else {
+			draws++;
+		}
+	}
+	printf("ProbCut against full width, %d ms per move: %d wins, %d draws, %d losses\n",
+		ms, wins, draws, losses);
+	printf("average depth: %.2f with ProbCut, %.2f without\n",
+		moves[0] ? (double) depths[0] / moves[0] : 0, moves[1] ? (double) depths[1] / moves[1] : 0);
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	if (argc >= 2 && strcmp(argv[1], "log") == 0) {
+		return cmd_log(argc - 1, argv + 1);
+	} else if (argc >= 2 && strcmp(argv[1], "fit") == 0) {
+		return cmd_fit(argc, argv);
+	} else if (argc >= 2 && strcmp(argv[1], "match") == 0) {
+		return cmd_match(argc - 1, argv + 1);
+	}
+	usage();
+	return EXIT_FAILURE;
+}
@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/tt.h"
+#include "../include/nn.h"
+#include "../include/schedule.h"
+
+#define CLOCK_SECONDS 60
+
+static const char *phases[SCHEDULE_PHASES] = { "opening", "early", "middle", "late" };
+
+static void usage(void) {
+	printf("Usage: rvschedule calibrate [-t SECONDS] [-n NETWORK] SCHEDULE\n"
+	"       rvschedule plan [-c SECONDS] [SCHEDULE]\n"
+	"Measure this machine's search speed and plan the time of a game\n"
+	"\n\t calibrate\t measure nodes per second and the effective branching factor of\n"
+	"\t\t\t every phase for SECONDS (default %.0f), and write them to SCHEDULE\n"
+	"\t plan\t\t the depth, time and solve of every move of a game on a clock of\n"
+	"\t\t\t SECONDS per player (default %d), from SCHEDULE or the defaults\n",
+	SCHEDULE_CALIBRATION, CLOCK_SECONDS);
+}
+
+static int moves_of(state_t state) {
+	return __builtin_popcountll((state.player == BLACK_STONE)
+		? bb_mobility(state.board.black, state.board.white, state.board.size)
+		: bb_mobility(state.board.white, state.board.black, state.board.size));
+}
+
+static void print_schedule(const schedule_t *s) {
+	int p;
+
+	printf("alpha-beta: %.0f nodes/s\n", s->nps);
+	printf("%-8s %8s %8s\n", "phase", "base", "ebf");
+	for (p = 0; p < SCHEDULE_PHASES; p++)
+		printf("%-8s %8.3f %8.3f\n", phases[p], s->base[p], s->ebf[p]);
+	printf("solver: %.0f nodes/s, base %.3f, ebf %.3f per empty\n", s->solve_nps, s->solve_base, s->solve_ebf);
+}
+
+static int cmd_calibrate(int argc, char *argv[]) {
+	schedule_t s;
+	double seconds = SCHEDULE_CALIBRATION;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:n:")) != -1) {
+		switch (opt) {
+			case 't':
+				seconds = atof(optarg);
+				break;
+			case 'n':
+				if (nn_load(optarg) != 0) {
+					fprintf(stderr, "rvschedule: error: cannot load network '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || seconds <= 0) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (schedule_calibrate(&s, seconds, nn_ready(8) ? nn_heuristic : stability_heuristic) != 0) {
+		fprintf(stderr, "rvschedule: warning: too few samples, some figures are the defaults\n");
+	}
+	print_schedule(&s);
+	if (schedule_save(argv[optind], &s) != 0) {
+		fprintf(stderr, "rvschedule: error: cannot write '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/* both players follow the plan, every move taking its predicted time and the moves of a shallow search */
+static int cmd_plan(int argc, char *argv[]) {
+	schedule_plan_t plan;
+	schedule_t s;
+	state_t state;
+	move_t move;
+	double clock[2], used;
+	char depth[8];
+	int opt, side = 0, passes = 0, solved[2] = { 0 };
+
+	schedule_default(&s);
+	clock[0] = CLOCK_SECONDS;
+	while ((opt = getopt(argc, argv, "c:")) != -1) {
+		switch (opt) {
+			case 'c':
+				clock[0] = atof(optarg);
+				break;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind < argc - 1 || clock[0] <= 0) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	if (optind == argc - 1 && schedule_load(argv[optind], &s) != 0) {
+		fprintf(stderr, "rvschedule: error: cannot load schedule '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	clock[1] = clock[0];
+	state.board = bb_init(8);
+	state.player = BLACK_STONE;
+	printf("%-7s %7s %5s %-8s %5s %10s %10s %10s\n", "player", "empties", "moves", "phase", "depth", "budget (s)",
+		"time (s)", "clock (s)");
+	while (passes < 2) {
+		move = ai_search(state, 1);
+		if (move.row >= state.board.size) {
+			passes++;
+		} else {
+			passes = 0;
+			if (!solved[side]) {
+				schedule_plan(&s, state, clock[side], SCHEDULE_MAX_DEPTH, &plan);
+				used = plan.solve ? plan.budget : schedule_search_time(&s, state, plan.depth);
+				used = used < plan.limit ? used : plan.limit;
+				clock[side] -= used;
+				solved[side] = plan.solve;
+				if (plan.solve) {
+					strcpy(depth, "solve");
+				} else {
+					sprintf(depth, "%d", plan.depth);
+				}
+				printf("%-7c %7d %5d %-8s %5s %10.3f %10.3f %10.3f\n", state.player, bb_empties(state.board),
+					moves_of(state), phases[probcut_phase(state.board.black | state.board.white, 8)], depth,
+					plan.budget, used, clock[side]);
+			}
+			state.board = bb_move(move, state);
+		}
+		state.player = (state.player == BLACK_STONE) ? WHITE_STONE : BLACK_STONE;
+		side = !side;
+	}
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	if (argc >= 2 && strcmp(argv[1], "calibrate") == 0) {
+		return cmd_calibrate(argc - 1, argv + 1);
+	} else if (argc >= 2 && strcmp(argv[1], "plan") == 0) {
+		return cmd_plan(argc - 1, argv + 1);
+	}
+	usage();
+	return EXIT_FAILURE;
+}
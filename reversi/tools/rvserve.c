@@ -0,0 +1,621 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "../include/libreversi.h"
+#include "../include/board_io.h"
+#include "../src/reversi.h"
+#include "../include/util.h"
+
+#define MAX_EVENTS 64
+#define LINE_MAX_LENGTH 512
+#define OUT_MAX_LENGTH 4096
+#define LATENCY_SAMPLES 8192
+#define TICK_MS 100
+
+/*
+ * Engine server. Each connection is a session holding one libreversi
+ * context, with a transposition table of its own bounded by -m, and plays
+ * one game at a time. The main thread multiplexes every session with
+ * epoll and answers the cheap commands itself. "go" is queued for a pool
+ * of worker threads. A full queue is refused with "error busy" at once.
+ * The main thread stops searches past their deadline, which answer their
+ * best move so far; a search that waited past its deadline in the queue
+ * answers at once. Network, ProbCut parameters and database are loaded
+ * once and shared read-only.
+ *
+ * Protocol: one command per line, one reply line per command.
+ *   new [SIZE]                ok
+ *   position PLAYER SQUARES   ok; SQUARES is every row of X, O and _ in one word
+ *   play MOVE|pass            ok
+ *   moves                     moves [MOVE...]
+ *   go [MS]                   move MOVE|pass score S nodes N time T depth D [stopped],
+ *                             or error ...; MS is the deadline, 0 for none
+ *   stop                      the running search answers its best move so far"
+ *   stats                     stats key=value...
+ *   quit
+ * Moves are in the notation of 'reversi': row letter, column number.
+ * While a search runs, only stop, stats and quit are accepted.
+ */
+
+typedef struct session {
+	int fd;
+	reversi_t *ctx;
+	int searching;
+	int stopped;
+	int closed;
+	int result;
+	reversi_result_t found;
+	double arrival;
+	double deadline;
+	struct session *next_done;
+	size_t in_length;
+	size_t out_length;
+	char in[LINE_MAX_LENGTH];
+	char out[OUT_MAX_LENGTH];
+} session_t;
+
+typedef struct {
+	size_t sessions;
+	size_t served;
+	size_t busy;
+	size_t timeouts;
+	size_t errors;
+} counters_t;
+
+static reversi_settings_t settings;
+static double default_deadline = 1000;
+static session_t **sessions;
+static int max_sessions = 256;
+static int num_sessions = 0;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static session_t **queue;
+static int queue_capacity;
+static int queue_head = 0, queue_count = 0, running = 0, stopping = 0;
+static session_t *done = NULL;
+static int done_fd;
+
+static double latencies[LATENCY_SAMPLES];
+static size_t num_latencies = 0;
+static counters_t counters;
+static double started;
+static volatile sig_atomic_t interrupted = 0;
+
+static void usage(void) {
+	printf("Usage: rvserve [-j WORKERS] [-q QUEUE] [-m KB] [-c SESSIONS] [-T MS] [-e ENGINE] [-d DEPTH]\n"
+	"               [-n NETWORK] [-P PROBCUT] [-D DATABASE] SOCKET\n"
+	"Serve engine sessions on the Unix socket SOCKET\n"
+	"\n\t -j\t\t search threads (default: one per CPU)\n"
+	"\t -q\t\t searches waiting at most, beyond that 'go' is refused (default: 2 per thread)\n"
+	"\t -m\t\t transposition table per session, in KB (default 1024)\n"
+	"\t -c\t\t sessions at most (default 256)\n"
+	"\t -T\t\t deadline of a search without one, in ms, 0 for none (default 1000)\n"
+	"\t -e, -d\t\t engine ('alphabeta' or 'mcts') and alpha-beta depth of the sessions\n"
+	"\t -n, -P, -D\t network, ProbCut parameters and database shared by all sessions\n");
+}
+
+static void on_signal(int sig) {
+	(void) sig;
+	interrupted = 1;
+}
+
+static void *worker(void *arg) {
+	session_t *s;
+	uint64_t one = 1;
+
+	(void) arg;
+	while (1) {
+		pthread_mutex_lock(&queue_lock);
+		while (queue_count == 0 && !stopping) {
+			pthread_cond_wait(&queue_ready, &queue_lock);
+		}
+		if (queue_count == 0) {
+			pthread_mutex_unlock(&queue_lock);
+			return NULL;
+		}
+		s = queue[queue_head];
+		queue_head = (queue_head + 1) % queue_capacity;
+		queue_count--;
+		running++;
+		pthread_mutex_unlock(&queue_lock);
+
+		/* past its deadline in the queue: the search stops at once and answers what the table knows */
+		if (s->deadline && util_now() > s->deadline) {
+			reversi_stop(s->ctx);
+		}
+		s->result = reversi_search(s->ctx, &s->found);
+
+		pthread_mutex_lock(&queue_lock);
+		running--;
+		s->next_done = done;
+		done = s;
+		pthread_mutex_unlock(&queue_lock);
+		if (write(done_fd, &one, sizeof(one)) < 0) {
+			perror("rvserve: eventfd");
+		}
+	}
+}
+
+static void flush(session_t *s) {
+	ssize_t n;
+
+	while (s->out_length) {
+		n = write(s->fd, s->out, s->out_length);
+		if (n <= 0) {
+			return;
+		}
+		memmove(s->out, s->out + n, s->out_length - n);
+		s->out_length -= n;
+	}
+}
+
+static void reply(session_t *s, const char *format, ...) {
+	va_list ap;
+	int n;
+
+	va_start(ap, format);
+	n = vsnprintf(s->out + s->out_length, OUT_MAX_LENGTH - s->out_length, format, ap);
+	va_end(ap);
+	if (n < 0 || s->out_length + n + 1 >= OUT_MAX_LENGTH) {
+		/* a client that does not read its replies is dropped */
+		s->closed = 1;
+		return;
+	}
+	s->out_length += n;
+	s->out[s->out_length++] = '\n';
+	flush(s);
+}
+
+static int board_size(session_t *s) {
+	uint64_t black, white;
+	char player;
+	int size;
+	reversi_position(s->ctx, &black, &white, &player, &size);
+	return size;
+}
+
+static int parse_square(const char *name, int size) {
+	int letter = tolower((unsigned char) name[0]) - 'a', number = atoi(name + 1);
+	if (strcmp(name, "pass") == 0) {
+		return REVERSI_PASS;
+	}
+	if (letter < 0 || letter >= size || number < 1 || number > size) {
+		return -2;
+	}
+	return letter * size + number - 1;
+}
+
+static void record_latency(double latency) {
+	latencies[num_latencies++ % LATENCY_SAMPLES] = latency;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+	double x = *(const double *) a, y = *(const double *) b;
+	return (x > y) - (x < y);
+}
+
+/* latency percentiles of the last LATENCY_SAMPLES searches, in ms */
+static void stats(session_t *s) {
+	static double sorted[LATENCY_SAMPLES];
+	size_t n = num_latencies < LATENCY_SAMPLES ? num_latencies : LATENCY_SAMPLES;
+	double uptime = util_now() - started, p[4] = { 0, 0, 0, 0 };
+	int queued, busy;
+
+	if (n) {
+		memcpy(sorted, latencies, n * sizeof(double));
+		qsort(sorted, n, sizeof(double), compare_doubles);
+		p[0] = sorted[n / 2];
+		p[1] = sorted[n * 90 / 100];
+		p[2] = sorted[n * 99 / 100];
+		p[3] = sorted[n - 1];
+	}
+	pthread_mutex_lock(&queue_lock);
+	queued = queue_count;
+	busy = running;
+	pthread_mutex_unlock(&queue_lock);
+	reply(s, "stats sessions=%d total_sessions=%zu queued=%d running=%d served=%zu busy=%zu"
+		" timeouts=%zu errors=%zu rate=%.1f p50=%.3f p90=%.3f p99=%.3f max=%.3f",
+		num_sessions, counters.sessions, queued, busy, counters.served, counters.busy,
+		counters.timeouts, counters.errors, counters.served / uptime,
+		p[0] * 1e3, p[1] * 1e3, p[2] * 1e3, p[3] * 1e3);
+}
+
+static void search(session_t *s, const char *arg) {
+	double deadline = (*arg ? atof(arg) : default_deadline) / 1e3;
+
+	s->arrival = util_now();
+	s->deadline = deadline > 0 ? s->arrival + deadline : 0;
+	/* a stop or deadline that came after the worker returned the last search is not for this one */
+	reversi_clear_stop(s->ctx);
+	pthread_mutex_lock(&queue_lock);
+	if (queue_count == queue_capacity) {
+		pthread_mutex_unlock(&queue_lock);
+		counters.busy++;
+		reply(s, "error busy");
+		return;
+	}
+	queue[(queue_head + queue_count) % queue_capacity] = s;
+	queue_count++;
+	s->searching = 1;
+	s->stopped = 0;
+	pthread_cond_signal(&queue_ready);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/* the answer of a finished search */
+static void answer(session_t *s) {
+	char name[BOARD_SQUARE_NAME];
+
+	s->searching = 0;
+	record_latency(util_now() - s->arrival);
+	if (s->result == REVERSI_OK) {
+		counters.served++;
+		board_square_name(s->found.square, board_size(s), name);
+		if (s->found.stopped && s->deadline && util_now() >= s->deadline) {
+			counters.timeouts++;
+		}
+		reply(s, "move %s score %d nodes %zu time %.6f depth %d%s", name, s->found.score, s->found.nodes,
+			s->found.elapsed, s->found.depth, s->found.stopped ? " stopped" : "");
+	} else {
+		counters.errors++;
+		reply(s, "error %s", reversi_error(s->ctx));
+	}
+}
+
+static void command(session_t *s, char *line) {
+	char *name = strtok(line, " \t\r"), *arg = strtok(NULL, " \t\r"), *arg2 = strtok(NULL, " \t\r");
+	char text[8 + 4 * REVERSI_MAX_SQUARES], *p = text, move[BOARD_SQUARE_NAME];
+	int squares[REVERSI_MAX_SQUARES], n, i, size, res;
+
+	if (name == NULL) {
+		return;
+	}
+	if (strcmp(name, "quit") == 0) {
+		s->closed = 1;
+		return;
+	}
+	if (strcmp(name, "stats") == 0) {
+		stats(s);
+		return;
+	}
+	if (strcmp(name, "stop") == 0) {
+		if (s->searching) {
+			reversi_stop(s->ctx);
+			s->stopped = 1;
+		}
+		return;
+	}
+	if (s->searching) {
+		reply(s, "error searching");
+		return;
+	}
+	size = board_size(s);
+	if (strcmp(name, "new") == 0) {
+		res = reversi_reset(s->ctx, arg ? atoi(arg) : size);
+	} else if (strcmp(name, "position") == 0 && arg && arg2) {
+		for (n = 1; n * n < (int) strlen(arg2); n++);
+		if (n * n != (int) strlen(arg2) || n > MAX_BOARD_SIZE || strlen(arg) != 1) {
+			reply(s, "error expected a player and every square of a board");
+			return;
+		}
+		p += sprintf(p, "%s\n", arg);
+		for (i = 0; i < n * n; i++) {
+			*p++ = arg2[i];
+			*p++ = (i % n == n - 1) ? '\n' : ' ';
+		}
+		res = reversi_load(s->ctx, text, p - text);
+	} else if (strcmp(name, "play") == 0 && arg) {
+		res = reversi_play(s->ctx, parse_square(arg, size));
+	} else if (strcmp(name, "moves") == 0) {
+		n = reversi_moves(s->ctx, squares, REVERSI_MAX_SQUARES);
+		p += sprintf(p, "moves");
+		for (i = 0; i < n; i++) {
+			board_square_name(squares[i], size, move);
+			p += sprintf(p, " %s", move);
+		}
+		reply(s, "%s", text);
+		return;
+	} else if (strcmp(name, "go") == 0) {
+		search(s, arg ? arg : "");
+		return;
+	} else {
+		reply(s, "error unknown command '%s'", name);
+		return;
+	}
+	if (res == REVERSI_OK) {
+		reply(s, "ok");
+	} else {
+		reply(s, "error %s", reversi_error(s->ctx));
+	}
+}
+
+static void receive(session_t *s) {
+	ssize_t n;
+	char *end;
+
+	while (!s->closed) {
+		n = read(s->fd, s->in + s->in_length, LINE_MAX_LENGTH - s->in_length);
+		if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+			s->closed = 1;
+			return;
+		}
+		if (n < 0) {
+			return;
+		}
+		s->in_length += n;
+		while (!s->closed && (end = memchr(s->in, '\n', s->in_length))) {
+			*end = 0;
+			command(s, s->in);
+			s->in_length -= end + 1 - s->in;
+			memmove(s->in, end + 1, s->in_length);
+		}
+		if (s->in_length == LINE_MAX_LENGTH) {
+			reply(s, "error line too long");
+			s->closed = 1;
+		}
+	}
+}
+
+static session_t *open_session(int fd) {
+	session_t *s = calloc(1, sizeof(session_t));
+	int i;
+
+	if (s == NULL || reversi_new(&s->ctx, MAX_BOARD_SIZE, &settings) != REVERSI_OK) {
+		free(s);
+		return NULL;
+	}
+	s->fd = fd;
+	for (i = 0; sessions[i]; i++);
+	sessions[i] = s;
+	num_sessions++;
+	counters.sessions++;
+	return s;
+}
+
+static void close_session(session_t *s) {
+	s->closed = 1;
+	if (s->fd >= 0) {
+		close(s->fd);
+		s->fd = -1;
+	}
+	if (s->searching) {
+		reversi_stop(s->ctx);
+	}
+}
+
+/* closed sessions are freed between two batches of events, once their search has come back */
+static void sweep(void) {
+	int i;
+
+	for (i = 0; i < max_sessions; i++) {
+		if (sessions[i] && sessions[i]->closed && !sessions[i]->searching) {
+			close_session(sessions[i]);
+			reversi_free(sessions[i]->ctx);
+			free(sessions[i]);
+			sessions[i] = NULL;
+			num_sessions--;
+		}
+	}
+}
+
+static void accept_sessions(int listener, int epoll) {
+	struct epoll_event ev;
+	session_t *s;
+	int fd;
+
+	while ((fd = accept(listener, NULL, NULL)) >= 0) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		if (num_sessions == max_sessions || (s = open_session(fd)) == NULL) {
+			if (write(fd, "error full\n", 11) < 0) {
+				/* closed anyway */
+			}
+			close(fd);
+			continue;
+		}
+		ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+		ev.data.ptr = s;
+		epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+static void finish_searches(void) {
+	session_t *s, *next;
+	uint64_t count;
+
+	if (read(done_fd, &count, sizeof(count)) < 0) {
+		return;
+	}
+	pthread_mutex_lock(&queue_lock);
+	s = done;
+	done = NULL;
+	pthread_mutex_unlock(&queue_lock);
+	for (; s; s = next) {
+		next = s->next_done;
+		if (s->closed) {
+			s->searching = 0;
+			continue;
+		}
+		answer(s);
+	}
+}
+
+/* stops the searches past their deadline, and returns the ms until the next one */
+static int check_deadlines(void) {
+	double t = util_now(), next = t + TICK_MS / 1e3;
+	int i;
+
+	for (i = 0; i < max_sessions; i++) {
+		session_t *s = sessions[i];
+		if (s == NULL || !s->searching || s->stopped || s->deadline == 0) {
+			continue;
+		}
+		if (t >= s->deadline) {
+			reversi_stop(s->ctx);
+			s->stopped = 1;
+		} else if (s->deadline < next) {
+			next = s->deadline;
+		}
+	}
+	return (int) ((next - t) * 1e3) + 1;
+}
+
+int main(int argc, char *argv[]) {
+	struct sockaddr_un addr;
+	struct epoll_event ev, events[MAX_EVENTS];
+	struct sigaction sa;
+	pthread_t *threads;
+	session_t *s;
+	int opt, listener, epoll, n, i, workers = sysconf(_SC_NPROCESSORS_ONLN), kb = 1024, timeout;
+	size_t slots;
+
+	reversi_default_settings(&settings);
+	queue_capacity = 0;
+	while ((opt = getopt(argc, argv, "j:q:m:c:T:e:d:n:P:D:")) != -1) {
+		switch (opt) {
+			case 'j':
+				workers = atoi(optarg);
+				break;
+			case 'q':
+				queue_capacity = atoi(optarg);
+				break;
+			case 'm':
+				kb = atoi(optarg);
+				break;
+			case 'c':
+				max_sessions = atoi(optarg);
+				break;
+			case 'T':
+				default_deadline = atof(optarg);
+				break;
+			case 'e':
+				settings.engine = strcmp(optarg, "mcts") == 0 ? REVERSI_MCTS : REVERSI_ALPHABETA;
+				break;
+			case 'd':
+				settings.depth = atoi(optarg);
+				break;
+			case 'n':
+				if (reversi_load_network(optarg) != REVERSI_OK) {
+					fprintf(stderr, "rvserve: error: cannot load network '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'P':
+				if (reversi_load_probcut(optarg) != REVERSI_OK) {
+					fprintf(stderr, "rvserve: error: cannot load ProbCut parameters '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'D':
+				if (reversi_open_database(optarg) != REVERSI_OK) {
+					fprintf(stderr, "rvserve: error: cannot open database '%s'\n", optarg);
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				usage();
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1 || workers < 1 || max_sessions < 1 || kb < 1
+			|| strlen(argv[optind]) >= sizeof(addr.sun_path)) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	queue_capacity = queue_capacity > 0 ? queue_capacity : 2 * workers;
+	/* the largest table of 16 byte slots within kb */
+	slots = (size_t) kb * 1024 / 16;
+	for (settings.tt_bits = 1; (size_t) 2 << settings.tt_bits <= slots; settings.tt_bits++);
+
+	sessions = calloc(max_sessions + 1, sizeof(session_t *));
+	queue = calloc(queue_capacity, sizeof(session_t *));
+	threads = calloc(workers, sizeof(pthread_t));
+	if (sessions == NULL || queue == NULL || threads == NULL) {
+		fprintf(stderr, "rvserve: error: no memory available\n");
+		return EXIT_FAILURE;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, argv[optind]);
+	unlink(addr.sun_path);
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0 || bind(listener, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+		fprintf(stderr, "rvserve: error: cannot listen on '%s': %s\n", addr.sun_path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+	done_fd = eventfd(0, EFD_NONBLOCK);
+	epoll = epoll_create1(0);
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listener;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &ev);
+	ev.data.ptr = &done_fd;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, done_fd, &ev);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	for (i = 0; i < workers; i++) {
+		if (pthread_create(&threads[i], NULL, worker, NULL) != 0) {
+			fprintf(stderr, "rvserve: error: cannot start %d threads\n", workers);
+			return EXIT_FAILURE;
+		}
+	}
+	started = util_now();
+	fprintf(stderr, "rvserve: listening on %s, %d threads, queue of %d, %d sessions of %zu KB at most\n",
+		addr.sun_path, workers, queue_capacity, max_sessions, ((size_t) 16 << settings.tt_bits) >> 10);
+
+	timeout = TICK_MS;
+	while (!interrupted) {
+		n = epoll_wait(epoll, events, MAX_EVENTS, timeout);
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr == &listener) {
+				accept_sessions(listener, epoll);
+			} else if (events[i].data.ptr == &done_fd) {
+				finish_searches();
+			} else {
+				s = events[i].data.ptr;
+				if (events[i].events & EPOLLOUT) {
+					flush(s);
+				}
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+					receive(s);
+				}
+				if (s->closed) {
+					close_session(s);
+				}
+			}
+		}
+		sweep();
+		timeout = check_deadlines();
+	}
+
+	pthread_mutex_lock(&queue_lock);
+	stopping = 1;
+	pthread_cond_broadcast(&queue_ready);
+	pthread_mutex_unlock(&queue_lock);
+	for (i = 0; i < max_sessions; i++) {
+		if (sessions[i] && sessions[i]->searching) {
+			reversi_stop(sessions[i]->ctx);
+		}
+	}
+	for (i = 0; i < workers; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	unlink(addr.sun_path);
+	fprintf(stderr, "rvserve: %zu sessions, %zu searches served, %zu refused as busy, %zu timeouts\n",
+		counters.sessions, counters.served, counters.busy, counters.timeouts);
+	return EXIT_SUCCESS;
+}
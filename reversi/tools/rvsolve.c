@@ -0,0 +1,338 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "../include/tt.h"
+#include "../include/solvedb.h"
+#include "../include/util.h"
+
+#define SOLVE_THREADS 4
+#define SOLVE_GAMES 100
+#define CHECK_POSITIONS 200
+#define MAX_SQUARES (SOLVEDB_MAX_SIZE * SOLVEDB_MAX_SIZE)
+#define VALUE_MASK ((1 << SOLVEDB_VALUE_BITS) - 1)
+
+/* every reachable position with a given number of discs */
+typedef struct {
+	uint64_t *keys;
+	size_t count;
+	size_t capacity;
+} layer_t;
+
+typedef struct {
+	int disc;
+	size_t begin;
+	size_t end;
+} job_t;
+
+static layer_t layers[MAX_SQUARES + 2];
+static size_t size;
+
+static void usage(void) {
+	printf("Usage: rvsolve build [-s SIZE] [-e EMPTIES] [-g GAMES] [-j THREADS] DB\n"
+	"       rvsolve check [-n N] DB\n"
+	"Solve small boards exactly and check the database\n"
+	"\n\t build\t\t enumerate every position reachable from the start of a\n"
+	"\t\t\t SIZE x SIZE board (4 by default), or from GAMES random\n"
+	"\t\t\t games stopped at EMPTIES empties, and solve them backwards\n"
+	"\t check\t\t compare N random records with the exact solver\n");
+}
+
+static int push(layer_t *layer, uint64_t key) {
+	uint64_t *keys;
+	if (layer->count == layer->capacity) {
+		layer->capacity = layer->capacity ? 2 * layer->capacity : 1024;
+		keys = realloc(layer->keys, layer->capacity * sizeof(uint64_t));
+		if (keys == NULL) {
+			return -1;
+		}
+		layer->keys = keys;
+	}
+	layer->keys[layer->count++] = key;
+	return 0;
+}
+
+static int compare_keys(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+static void unique(layer_t *layer) {
+	size_t i, n = 0;
+	qsort(layer->keys, layer->count, sizeof(uint64_t), compare_keys);
+	for (i = 0; i < layer->count; i++) {
+		if (n == 0 || layer->keys[i] != layer->keys[n - 1])
+			layer->keys[n++] = layer->keys[i];
+	}
+	layer->count = n;
+}
+
+/* a position that has to pass comes with the one after the pass */
+static int add_position(uint64_t own, uint64_t opp) {
+	layer_t *layer = &layers[__builtin_popcountll(own | opp)];
+	if (push(layer, solvedb_key(own, opp, size)) != 0) {
+		return -1;
+	}
+	if (bb_mobility(own, opp, size) == 0 && bb_mobility(opp, own, size) != 0) {
+		return push(layer, solvedb_key(opp, own, size));
+	}
+	return 0;
+}
+
+static int enumerate(int first) {
+	uint64_t own, opp, moves, flips;
+	size_t i;
+	int disc, square;
+
+	for (disc = first; disc <= (int) (size * size); disc++) {
+		unique(&layers[disc]);
+		for (i = 0; i < layers[disc].count; i++) {
+			solvedb_decode(layers[disc].keys[i], size, &own, &opp);
+			for (moves = bb_mobility(own, opp, size); moves; moves &= moves - 1) {
+				square = __builtin_ctzll(moves);
+				flips = bb_flips(own, opp, square, size);
+				if (add_position(opp & ~flips, own | flips | (uint64_t) 1 << square) != 0) {
+					return -1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+static int lookup(const layer_t *layer, uint64_t key) {
+	size_t lo = 0, hi = layer->count, mid;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if ((layer->keys[mid] >> SOLVEDB_VALUE_BITS) < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return (int) (layer->keys[lo] & VALUE_MASK) - SOLVEDB_VALUE_BIAS;
+}
+
+static int best_child(uint64_t own, uint64_t opp, const layer_t *next) {
+	uint64_t moves, flips;
+	int square, v, best = -SCORE_INF;
+	for (moves = bb_mobility(own, opp, size); moves; moves &= moves - 1) {
+		square = __builtin_ctzll(moves);
+		flips = bb_flips(own, opp, square, size);
+		v = -lookup(next, solvedb_key(opp & ~flips, own | flips | (uint64_t) 1 << square, size));
+		best = (v > best) ? v : best;
+	}
+	return best;
+}
+
+/* every child of a layer is in the next one, which is already solved */
+static void *solve_range(void *arg) {
+	job_t *job = arg;
+	layer_t *layer = &layers[job->disc], *next = &layers[job->disc + 1];
+	uint64_t own, opp;
+	size_t i;
+	int v;
+
+	for (i = job->begin; i < job->end; i++) {
+		solvedb_decode(layer->keys[i], size, &own, &opp);
+		if (bb_mobility(own, opp, size)) {
+			v = best_child(own, opp, next);
+		} else if (bb_mobility(opp, own, size)) {
+			v = -best_child(opp, own, next);
+		} else {
+			v = __builtin_popcountll(own) - __builtin_popcountll(opp);
+		}
+		layer->keys[i] = layer->keys[i] << SOLVEDB_VALUE_BITS | (v + SOLVEDB_VALUE_BIAS);
+	}
+	return NULL;
+}
+
+static void solve(int first, int threads) {
+	pthread_t ids[64];
+	job_t jobs[64];
+	size_t count;
+	int disc, t;
+
+	for (disc = size * size; disc >= first; disc--) {
+		count = layers[disc].count;
+		for (t = 0; t < threads; t++) {
+			jobs[t].disc = disc;
+			jobs[t].begin = count * t / threads;
+			jobs[t].end = count * (t + 1) / threads;
+			pthread_create(&ids[t], NULL, solve_range, &jobs[t]);
+		}
+		for (t = 0; t < threads; t++)
+			pthread_join(ids[t], NULL);
+	}
+}
+
+/* random games from the start, stopped at the given number of empties */
+static int random_roots(int empties, int games) {
+	uint64_t own, opp, moves, tmp, flips;
+	bitboard_t board;
+	int g, n, added = 0;
+
+	srand(1);
+	for (g = 0; g < games; g++) {
+		board = bb_init(size);
+		own = board.black;
+		opp = board.white;
+		while ((int) (size * size) - __builtin_popcountll(own | opp) > empties) {
+			moves = bb_mobility(own, opp, size);
+			if (moves == 0 && bb_mobility(opp, own, size) == 0)
+				break;
+			if (moves) {
+				for (n = rand() % __builtin_popcountll(moves); n > 0; n--)
+					moves &= moves - 1;
+				flips = bb_flips(own, opp, __builtin_ctzll(moves), size);
+				own |= flips | (moves & -moves);
+				opp &= ~flips;
+			}
+			tmp = own;
+			own = opp;
+			opp = tmp;
+		}
+		if ((int) (size * size) - __builtin_popcountll(own | opp) == empties) {
+			if (add_position(own, opp) != 0)
+				return -1;
+			added++;
+		}
+	}
+	return added;
+}
+
+static int cmd_build(int argc, char *argv[]) {
+	struct rusage usage_stats;
+	bitboard_t board;
+	uint64_t *records;
+	double start, enumerated, solved;
+	size_t total = 0, n;
+	int opt, roots, empties = -1, games = SOLVE_GAMES, threads = SOLVE_THREADS, first, disc, v;
+
+	size = 4;
+	while ((opt = getopt(argc, argv, "s:e:g:j:")) != -1) {
+		if (opt == 's') {
+			size = atoi(optarg);
+		} else if (opt == 'e') {
+			empties = atoi(optarg);
+		} else if (opt == 'g') {
+			games = atoi(optarg);
+		} else if (opt == 'j') {
+			threads = atoi(optarg);
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (size < MIN_BOARD_SIZE || size > SOLVEDB_MAX_SIZE || size % 2 || threads < 1 || threads > 64
+			|| empties > (int) (size * size) - 4 || optind + 1 != argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	start = util_now();
+	if (empties < 0) {
+		board = bb_init(size);
+		first = 4;
+		roots = (add_position(board.black, board.white) == 0) ? 1 : -1;
+	} else {
+		first = size * size - empties;
+		roots = random_roots(empties, games);
+	}
+	if (roots <= 0 || enumerate(first) != 0) {
+		fprintf(stderr, "rvsolve: error: %s\n", roots == 0 ? "no position to solve" : "no memory available");
+		return EXIT_FAILURE;
+	}
+	enumerated = util_now() - start;
+	solve(first, threads);
+	solved = util_now() - start - enumerated;
+
+	for (disc = first; disc <= (int) (size * size); disc++)
+		total += layers[disc].count;
+	records = malloc(total * sizeof(uint64_t));
+	if (records == NULL) {
+		fprintf(stderr, "rvsolve: error: no memory available\n");
+		return EXIT_FAILURE;
+	}
+	for (disc = first, n = 0; disc <= (int) (size * size); disc++) {
+		memcpy(records + n, layers[disc].keys, layers[disc].count * sizeof(uint64_t));
+		n += layers[disc].count;
+		free(layers[disc].keys);
+	}
+	qsort(records, total, sizeof(uint64_t), compare_keys);
+	if (solvedb_write(argv[optind], size, records, total) != 0) {
+		fprintf(stderr, "rvsolve: error: cannot write '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	free(records);
+	getrusage(RUSAGE_SELF, &usage_stats);
+
+	printf("%zux%zu: %zu positions from %d roots with %d discs on\n", size, size, total, roots, first);
+	printf("enumeration %.2f s, solve %.2f s with %d threads\n", enumerated, solved, threads);
+	printf("peak memory %.1f MB, table %zu bytes\n", usage_stats.ru_maxrss / 1024.0,
+		SOLVEDB_HEADER_SIZE + total * 8);
+	board = bb_init(size);
+	if (solvedb_open(argv[optind]) == 0 && solvedb_probe(board.black, board.white, size, &v)) {
+		printf("start position: %+d for the first player\n", v);
+	}
+	solvedb_close();
+	return EXIT_SUCCESS;
+}
+
+static int cmd_check(int argc, char *argv[]) {
+	state_t state;
+	uint8_t header[SOLVEDB_HEADER_SIZE];
+	uint64_t record;
+	int opt, positions = CHECK_POSITIONS, i, v, score, errors = 0;
+	size_t count;
+	FILE *f;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		if (opt == 'n') {
+			positions = atoi(optarg);
+		} else {
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage();
+		return EXIT_FAILURE;
+	}
+	f = fopen(argv[optind], "rb");
+	if (f == NULL || solvedb_open(argv[optind]) != 0 || fread(header, sizeof(header), 1, f) != 1) {
+		fprintf(stderr, "rvsolve: error: cannot open '%s'\n", argv[optind]);
+		return EXIT_FAILURE;
+	}
+	size = header[5];
+	count = solvedb_count();
+	srand(2);
+	for (i = 0; i < positions; i++) {
+		fseek(f, SOLVEDB_HEADER_SIZE + (((size_t) rand() << 31 | rand()) % count) * 8, SEEK_SET);
+		if (fread(&record, 8, 1, f) != 1)
+			break;
+		state.board.size = size;
+		state.player = BLACK_STONE;
+		solvedb_decode(record >> SOLVEDB_VALUE_BITS, size, &state.board.black, &state.board.white);
+		tt_clear();
+		ai_solve(state, &score);
+		if (!solvedb_probe(state.board.black, state.board.white, size, &v) || v != score)
+			errors++;
+	}
+	fclose(f);
+	solvedb_close();
+	printf("%d positions checked, %d mismatches\n", i, errors);
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (tt_init(TT_DEFAULT_BITS) != 0) {
+		fprintf(stderr, "No memory available\n");
+		return EXIT_FAILURE;
+	}
+	if (argc >= 2 && strcmp(argv[1], "build") == 0) {
+		return cmd_build(argc - 1, argv + 1);
+	} else if (argc >= 2 && strcmp(argv[1], "check") == 0) {
+		return cmd_check(argc - 1, argv + 1);
+	}
+	usage();
+	return EXIT_FAILURE;
+}